@@ -304,6 +304,7 @@ endfunction()
 # Adds a unit test case
 #
 # quassel_add_test(TestName
+#                  [BENCHMARK]
 #                  [LIBRARIES lib1 lib2...]
 # )
 #
@@ -315,13 +316,16 @@ endfunction()
 #
 # Additional libraries can be given using the LIBRARIES argument.
 #
+# Benchmarks are marked with the BENCHMARK option. They are built along with the tests, but not
+# registered with CTest, because they take a while and their results only matter when measuring.
+#
 # Test cases should include testglobal.h, which transitively includes the GTest/GMock headers and
 # exports the main function.
 #
 # The compiled test case binary is located in the unit/ directory in the build directory.
 #
 function(quassel_add_test _target)
-    set(options )
+    set(options BENCHMARK)
     set(oneValueArgs )
     set(multiValueArgs LIBRARIES)
     cmake_parse_arguments(ARG "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
@@ -351,11 +355,13 @@ function(quassel_add_test _target)
     )
     target_link_libraries(${_target} PUBLIC ${ARG_LIBRARIES})
 
-    add_test(
-        NAME ${_target}
-        COMMAND $<TARGET_FILE:${_target}>
-        WORKING_DIRECTORY "${CMAKE_BINARY_DIR}"
-    )
+    if (NOT ARG_BENCHMARK)
+        add_test(
+            NAME ${_target}
+            COMMAND $<TARGET_FILE:${_target}>
+            WORKING_DIRECTORY "${CMAKE_BINARY_DIR}"
+        )
+    endif()
 endfunction()
 
 ###################################################################################################
@@ -90,7 +90,10 @@ void GlobalUnreadBacklogRequester::requestInitialBacklog()
     }
     backlogManager->emitMessagesRequested(
         QObject::tr("Requesting up to %1 of all unread backlog messages (plus additional %2)").arg(_limit).arg(_additional));
-    backlogManager->requestBacklogAll(oldestUnreadMessage, -1, _limit, _additional);
+    if (Client::isCoreFeatureEnabled(Quassel::Feature::BacklogStreaming))
+        backlogManager->requestBacklogAllChunked(oldestUnreadMessage, -1, _limit, _additional);
+    else
+        backlogManager->requestBacklogAll(oldestUnreadMessage, -1, _limit, _additional);
 }
 
 // ========================================
@@ -6,6 +6,7 @@
 #include <QAbstractItemView>
 
 #include "client.h"
+#include "ircchannel.h"
 #include "networkmodel.h"
 #include "quassel.h"
 
@@ -17,6 +18,10 @@ BufferModel::BufferModel(NetworkModel* parent)
     if (Quassel::isOptionSet("debugbufferswitches")) {
         connect(_selectionModelSynchronizer.selectionModel(), &QItemSelectionModel::currentChanged, this, &BufferModel::debug_currentChanged);
     }
+    connect(_selectionModelSynchronizer.selectionModel(),
+            &QItemSelectionModel::currentChanged,
+            this,
+            &BufferModel::requestCurrentChannelMembers);
     connect(Client::instance(), &Client::networkCreated, this, &BufferModel::newNetwork);
     connect(this, &QAbstractItemModel::rowsInserted, this, &BufferModel::newBuffers);
 }
@@ -38,6 +43,7 @@ void BufferModel::newNetwork(NetworkId id)
     const Network* net = Client::network(id);
     Q_ASSERT(net);
     connect(net, &Network::connectionStateSet, this, &BufferModel::networkConnectionChanged);
+    connect(net, &SyncableObject::initDone, this, &BufferModel::requestCurrentChannelMembers);
 }
 
 void BufferModel::networkConnectionChanged(Network::ConnectionState state)
@@ -115,6 +121,14 @@ void BufferModel::debug_currentChanged(QModelIndex current, QModelIndex previous
              << "Buffer:" << current.data(NetworkModel::BufferIdRole).value<BufferId>();
 }
 
+void BufferModel::requestCurrentChannelMembers()
+{
+    // With lazy channel membership, members are only synced for channels that are actually shown
+    auto* ircChannel = qobject_cast<IrcChannel*>(currentIndex().data(NetworkModel::IrcChannelRole).value<QObject*>());
+    if (ircChannel)
+        ircChannel->requestMembers();
+}
+
 void BufferModel::newBuffers(const QModelIndex& parent, int start, int end)
 {
     if (parent.data(NetworkModel::ItemTypeRole) != NetworkModel::NetworkItemType)
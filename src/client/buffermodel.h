@@ -50,6 +50,7 @@ private slots:
     void debug_currentChanged(QModelIndex current, QModelIndex previous);
     void newNetwork(NetworkId id);
     void networkConnectionChanged(Network::ConnectionState state);
+    void requestCurrentChannelMembers();
     void newBuffers(const QModelIndex& parent, int start, int end);
 
 private:
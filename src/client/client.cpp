@@ -73,6 +73,7 @@ Client::Client(std::unique_ptr<AbstractUi> ui, QObject* parent)
     SignalProxy* p = signalProxy();
 
     p->attachSlot(SIGNAL(displayMsg(Message)), this, &Client::recvMessage);
+    p->attachSlot(SIGNAL(displayMsgs(QVariantList)), this, &Client::recvMessages);
     p->attachSlot(SIGNAL(displayStatusMsg(QString, QString)), this, &Client::recvStatusMsg);
 
     p->attachSlot(SIGNAL(bufferInfoUpdated(BufferInfo)), _networkModel, &NetworkModel::bufferUpdated);
@@ -535,6 +536,15 @@ void Client::recvMessage(const Message& msg)
     messageProcessor()->process(msg_);
 }
 
+void Client::recvMessages(const QVariantList& msgs)
+{
+    MessageList msgs_;
+    msgs_.reserve(msgs.size());
+    for (const QVariant& v : msgs)
+        msgs_ << v.value<Message>();
+    messageProcessor()->process(msgs_);
+}
+
 void Client::setBufferLastSeenMsg(BufferId id, const MsgId& msgId)
 {
     if (bufferSyncer())
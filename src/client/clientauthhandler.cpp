@@ -145,6 +145,8 @@ void ClientAuthHandler::onSocketConnected()
         quint32 magic = QuasselProtocol::magic;
         magic |= QuasselProtocol::Encryption;
         magic |= QuasselProtocol::Compression;
+        if (Compressor::isAvailable(Compressor::Zstd))
+            magic |= QuasselProtocol::ZstdCompression;
 
         stream << magic;
 
@@ -170,6 +172,7 @@ void ClientAuthHandler::onSocketConnected()
                                          this,
                                          socket(),
                                          Compressor::NoCompression,
+                                         Compressor::Zlib,
                                          this);
     // Only needed for the legacy peer, as all others check the protocol version before instantiation
     connect(peer, &RemotePeer::protocolVersionMismatch, this, &ClientAuthHandler::onProtocolVersionMismatch);
@@ -197,12 +200,17 @@ void ClientAuthHandler::onReadyRead()
     _connectionFeatures = static_cast<quint8>(reply >> 24);
 
     Compressor::CompressionLevel level;
-    if (_connectionFeatures & QuasselProtocol::Compression)
+    Compressor::Algorithm algorithm = Compressor::Zlib;
+    if (_connectionFeatures & QuasselProtocol::ZstdCompression) {
+        level = Compressor::BestCompression;
+        algorithm = Compressor::Zstd;
+    }
+    else if (_connectionFeatures & QuasselProtocol::Compression)
         level = Compressor::BestCompression;
     else
         level = Compressor::NoCompression;
 
-    RemotePeer* peer = PeerFactory::createPeer(PeerFactory::ProtoDescriptor(type, protoFeatures), this, socket(), level, this);
+    RemotePeer* peer = PeerFactory::createPeer(PeerFactory::ProtoDescriptor(type, protoFeatures), this, socket(), level, algorithm, this);
     if (!peer) {
         qWarning() << "No valid protocol supported for this core!";
         emit errorPopup(tr("<b>Incompatible Quassel Core!</b><br>"
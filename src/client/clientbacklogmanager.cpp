@@ -71,6 +71,56 @@ void ClientBacklogManager::receiveBacklogAll(MsgId first, MsgId last, int limit,
     dispatchMessages(msglist);
 }
 
+void ClientBacklogManager::receiveBacklogAllChunk(MsgId first, MsgId last, int limit, int additional, QVariantList msgs, bool complete)
+{
+    Q_UNUSED(first)
+    Q_UNUSED(last)
+    Q_UNUSED(limit)
+    Q_UNUSED(additional)
+
+    MessageList msglist;
+    for (const QVariant& v : msgs) {
+        Message msg = v.value<Message>();
+        msg.setFlags(msg.flags() | Message::Backlog);
+        msglist << msg;
+    }
+
+    // Chunks are displayed as they arrive, so the first messages show up before the whole backlog is transferred.
+    // The request is only reported as processed once the core sent the final chunk.
+    if (!msglist.isEmpty()) {
+        clock_t start_t = clock();
+        Client::messageProcessor()->process(msglist);
+        _chunkedProcessingTime += clock() - start_t;
+        _chunkedMessageCount += msglist.count();
+    }
+
+    if (complete) {
+        if (_chunkedMessageCount > 0) {
+            emit messagesProcessed(
+                tr("Processed %1 messages in %2 seconds.").arg(_chunkedMessageCount).arg((float)_chunkedProcessingTime / CLOCKS_PER_SEC));
+        }
+        _chunkedMessageCount = 0;
+        _chunkedProcessingTime = 0;
+    }
+}
+
+void ClientBacklogManager::receiveBacklogSearch(BufferId bufferId, const QString& query, int limit, MsgId last, QVariantList msgs)
+{
+    Q_UNUSED(limit)
+    Q_UNUSED(last)
+
+    MessageList msglist;
+    for (const QVariant& v : msgs) {
+        Message msg = v.value<Message>();
+        msg.setFlags(msg.flags() | Message::Backlog);
+        msglist << msg;
+    }
+
+    // Search results are not fed into the message processor, as they would otherwise show up as regular
+    // backlog in the chat views; consumers display them on their own.
+    emit searchResultsReceived(bufferId, query, msglist);
+}
+
 void ClientBacklogManager::requestInitialBacklog()
 {
     if (_initBacklogRequested) {
@@ -168,4 +218,6 @@ void ClientBacklogManager::reset()
     _requester = nullptr;
     _initBacklogRequested = false;
     _buffersRequested.clear();
+    _chunkedMessageCount = 0;
+    _chunkedProcessingTime = 0;
 }
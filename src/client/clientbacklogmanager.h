@@ -5,6 +5,8 @@
 
 #include "client-export.h"
 
+#include <ctime>
+
 #include "backlogmanager.h"
 #include "message.h"
 
@@ -26,6 +28,8 @@ public slots:
     QVariantList requestBacklog(BufferId bufferId, MsgId first = -1, MsgId last = -1, int limit = -1, int additional = 0) override;
     void receiveBacklog(BufferId bufferId, MsgId first, MsgId last, int limit, int additional, QVariantList msgs) override;
     void receiveBacklogAll(MsgId first, MsgId last, int limit, int additional, QVariantList msgs) override;
+    void receiveBacklogAllChunk(MsgId first, MsgId last, int limit, int additional, QVariantList msgs, bool complete) override;
+    void receiveBacklogSearch(BufferId bufferId, const QString& query, int limit, MsgId last, QVariantList msgs) override;
 
     void requestInitialBacklog();
 
@@ -37,6 +41,9 @@ signals:
     void messagesRequested(const QString&) const;
     void messagesProcessed(const QString&) const;
 
+    //! Emitted when the core answered a backlog search; results are ordered by relevance
+    void searchResultsReceived(BufferId bufferId, const QString& query, const MessageList& messages) const;
+
     void updateProgress(int, int);
 
 private:
@@ -48,6 +55,10 @@ private:
     BacklogRequester* _requester{nullptr};
     bool _initBacklogRequested{false};
     QSet<BufferId> _buffersRequested;
+
+    // Totals of a chunked backlog request, reported once its final chunk arrived
+    int _chunkedMessageCount{0};
+    clock_t _chunkedProcessingTime{0};
 };
 
 // inlines
@@ -349,6 +349,13 @@ void CoreConnection::connectToCurrentAccount()
         return;
     }
 
+    // Cached object states are kept across reconnects, so objects that didn't change don't need to be resent
+    if (currentAccount().accountId() != _initDataCacheAccount) {
+        Client::signalProxy()->clearInitDataCache();
+        _initDataCacheAccount = currentAccount().accountId();
+    }
+    Client::signalProxy()->setInitDataCacheEnabled(true);
+
     _authHandler = new ClientAuthHandler(currentAccount(), this);
 
     connect(_authHandler, &ClientAuthHandler::disconnected, this, &CoreConnection::coreSocketDisconnected);
@@ -143,6 +143,7 @@ private:
     bool _resetting{false};
 
     CoreAccount _account;
+    AccountId _initDataCacheAccount;  ///< Account the client's InitData cache belongs to
     CoreAccountModel* accountModel() const;
 
     QPointer<QNetworkInformation> _qNetworkInformation;
@@ -752,6 +752,7 @@ void ChannelBufferItem::attachIrcChannel(IrcChannel* ircChannel)
     connect(ircChannel, &IrcChannel::ircUserModesSet, this, &ChannelBufferItem::userModeChanged);
     connect(ircChannel, &IrcChannel::ircUserModeAdded, this, &ChannelBufferItem::userModeChanged);
     connect(ircChannel, &IrcChannel::ircUserModeRemoved, this, &ChannelBufferItem::userModeChanged);
+    connect(ircChannel, &IrcChannel::userCountSet, this, [this]() { emit dataChanged(2); });
 
     if (!ircChannel->ircUsers().isEmpty())
         join(ircChannel->ircUsers());
@@ -195,7 +195,7 @@ public:
     QString toolTip(int column) const override;
 
     inline QString topic() const override { return (bool)_ircChannel ? _ircChannel->topic() : QString(); }
-    inline int nickCount() const override { return (bool)_ircChannel ? _ircChannel->ircUsers().count() : 0; }
+    inline int nickCount() const override { return (bool)_ircChannel ? _ircChannel->userCount() : 0; }
 
     void attachIrcChannel(IrcChannel* ircChannel);
 
@@ -32,3 +32,14 @@ QVariantList BacklogManager::requestBacklogAllFiltered(MsgId first, MsgId last,
     REQUEST(ARG(first), ARG(last), ARG(limit), ARG(additional), ARG(type), ARG(flags))
     return QVariantList();
 }
+
+void BacklogManager::requestBacklogAllChunked(MsgId first, MsgId last, int limit, int additional, int chunkSize)
+{
+    REQUEST(ARG(first), ARG(last), ARG(limit), ARG(additional), ARG(chunkSize))
+}
+
+QVariantList BacklogManager::requestBacklogSearch(BufferId bufferId, const QString& query, int limit, MsgId last)
+{
+    REQUEST(ARG(bufferId), ARG(query), ARG(limit), ARG(last))
+    return QVariantList();
+}
@@ -35,6 +35,36 @@ public slots:
     inline virtual void receiveBacklogAll(MsgId, MsgId, int, int, QVariantList) {};
     inline virtual void receiveBacklogAllFiltered(MsgId, MsgId, int, int, int, int, QVariantList) {};
 
+    /**
+     * Requests the backlog of all buffers, delivered in a series of bounded chunks.
+     *
+     * Works like requestBacklogAll(), but instead of a single reply the core pages through the backlog
+     * and answers with a sequence of receiveBacklogAllChunk() calls, newest messages first. The last
+     * chunk of a request has its complete flag set. Requires the BacklogStreaming feature on the core side.
+     *
+     * @param first      If != -1, only return messages with a MsgId >= first
+     * @param last       If != -1, only return messages with a MsgId < last
+     * @param limit      Maximum number of messages, or -1 for no limit
+     * @param additional Number of messages to append that are older than the requested range
+     * @param chunkSize  Maximum number of messages per chunk, or -1 for the core's default
+     */
+    virtual void requestBacklogAllChunked(MsgId first = -1, MsgId last = -1, int limit = -1, int additional = 0, int chunkSize = -1);
+    inline virtual void receiveBacklogAllChunk(MsgId, MsgId, int, int, QVariantList, bool) {};
+
+    /**
+     * Searches the backlog for messages matching the given full-text query.
+     *
+     * Requires the BacklogSearch feature on the core side.
+     *
+     * @param bufferId The buffer to search in; if invalid, all buffers of the user are searched
+     * @param query    Search terms; all terms need to be contained in a message for it to match
+     * @param limit    Maximum number of results, or -1 for no limit
+     * @param last     If != -1, only return messages with a MsgId < last
+     * @returns The matching messages, best matches first
+     */
+    virtual QVariantList requestBacklogSearch(BufferId bufferId, const QString& query, int limit = -1, MsgId last = -1);
+    inline virtual void receiveBacklogSearch(BufferId, const QString&, int, MsgId, QVariantList) {};
+
 signals:
     void backlogRequested(BufferId, MsgId, MsgId, int, int);
     void backlogAllRequested(MsgId, MsgId, int, int);
@@ -43,7 +43,7 @@ bool BufferSyncer::setLastSeenMsg(BufferId buffer, const MsgId& msgId)
     const MsgId oldLastSeenMsg = lastSeenMsg(buffer);
     if (!oldLastSeenMsg.isValid() || oldLastSeenMsg < msgId) {
         _lastSeenMsg[buffer] = msgId;
-        SYNC(ARG(buffer), ARG(msgId))
+        SYNC_COALESCED(ARG(buffer), ARG(msgId))
         emit lastSeenMsgSet(buffer, msgId);
         return true;
     }
@@ -46,6 +46,8 @@ public:
     QSet<BufferId> removedBuffers() const;
     QSet<BufferId> temporarilyRemovedBuffers() const;
 
+    bool allowsConcurrentInitData() const override { return true; }
+
 public slots:
     QVariantList initBufferList() const;
     void initSetBufferList(const QVariantList& buffers);
@@ -6,13 +6,18 @@
 #include <QTcpSocket>
 #include <QTimer>
 
+#ifdef HAVE_ZSTD
+#    include <zstd.h>
+#endif
+
 const int maxBufferSize = 64 * 1024 * 1024;  // protect us from zip bombs
 const int ioBufferSize = 64 * 1024;          // chunk size for inflate/deflate; should not be too large as we preallocate that space!
 
-Compressor::Compressor(QTcpSocket* socket, Compressor::CompressionLevel level, QObject* parent)
+Compressor::Compressor(QTcpSocket* socket, Compressor::CompressionLevel level, Compressor::Algorithm algorithm, QObject* parent)
     : QObject(parent)
     , _socket(socket)
     , _level(level)
+    , _algorithm(algorithm)
     , _inflater(nullptr)
     , _deflater(nullptr)
 {
@@ -45,10 +50,32 @@ Compressor::~Compressor()
         deflateEnd(_deflater);
         delete _deflater;
     }
+#ifdef HAVE_ZSTD
+    ZSTD_freeDCtx(_zstdInflater);
+    ZSTD_freeCCtx(_zstdDeflater);
+#endif
+}
+
+bool Compressor::isAvailable(Compressor::Algorithm algorithm)
+{
+    switch (algorithm) {
+    case Zlib:
+        return true;
+    case Zstd:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
 }
 
 bool Compressor::initStreams()
 {
+    if (_algorithm == Zstd)
+        return initZstdStreams();
+
     int zlevel;
     switch (compressionLevel()) {
     case BestCompression:
@@ -83,30 +110,93 @@ bool Compressor::initStreams()
     return true;
 }
 
+bool Compressor::initZstdStreams()
+{
+#ifdef HAVE_ZSTD
+    int zlevel;
+    switch (compressionLevel()) {
+    case BestCompression:
+        // Higher levels cost a lot more CPU and memory per connection, but gain little on protocol data
+        zlevel = 6;
+        break;
+    case BestSpeed:
+        zlevel = 1;
+        break;
+    default:
+        zlevel = ZSTD_CLEVEL_DEFAULT;
+    }
+
+    _zstdInflater = ZSTD_createDCtx();
+    if (!_zstdInflater) {
+        qWarning() << "Could not initialize the zstd decompression stream!";
+        return false;
+    }
+
+    _zstdDeflater = ZSTD_createCCtx();
+    if (!_zstdDeflater || ZSTD_isError(ZSTD_CCtx_setParameter(_zstdDeflater, ZSTD_c_compressionLevel, zlevel))) {
+        qWarning() << "Could not initialize the zstd compression stream!";
+        return false;
+    }
+
+    _inputBuffer.reserve(ioBufferSize);
+    _outputBuffer.resize(ioBufferSize);
+
+    qDebug() << "Enabling zstd compression...";
+
+    return true;
+#else
+    qWarning() << "Cannot enable zstd compression, support was not compiled in!";
+    return false;
+#endif
+}
+
 qint64 Compressor::bytesAvailable() const
 {
-    return _readBuffer.size();
+    return _readBuffer.size() - _readOffset;
 }
 
 qint64 Compressor::read(char* data, qint64 maxSize)
 {
     if (maxSize <= 0)
-        maxSize = _readBuffer.size();
+        maxSize = bytesAvailable();
 
-    qint64 n = qMin(maxSize, (qint64)_readBuffer.size());
-    memcpy(data, _readBuffer.constData(), n);
+    qint64 n = qMin(maxSize, bytesAvailable());
+    memcpy(data, _readBuffer.constData() + _readOffset, n);
+    consume(n);
+    return n;
+}
 
-    // TODO: don't copy for every read
-    if (n == _readBuffer.size())
-        _readBuffer.clear();
-    else
-        _readBuffer = _readBuffer.mid(n);
+QByteArray Compressor::readView(qint64 size)
+{
+    if (size <= 0 || size > bytesAvailable())
+        return {};
+
+    QByteArray view = QByteArray::fromRawData(_readBuffer.constData() + _readOffset, size);
+    consume(size);
+    return view;
+}
+
+void Compressor::consume(qint64 size)
+{
+    // Consumed data stays in place until the next readData(), so views handed out by readView() remain valid until then
+    _readOffset += size;
+    if (_readOffset == _readBuffer.size()) {
+        _readBuffer.resize(0);  // keeps the capacity
+        _readOffset = 0;
+    }
 
     // If there's still data left in the socket buffer, make sure to schedule a read
     if (_socket->bytesAvailable())
         QTimer::singleShot(0, this, &Compressor::readData);
+}
 
-    return n;
+void Compressor::compactReadBuffer()
+{
+    // Every byte is moved at most once this way, no matter how small the reads are
+    if (_readOffset > 0 && _readOffset >= bytesAvailable()) {
+        _readBuffer.remove(0, _readOffset);
+        _readOffset = 0;
+    }
 }
 
 // The usual usage pattern is to write a blocksize first, followed by the actual data.
@@ -130,11 +220,14 @@ void Compressor::readData()
     if (_socket->state() != QAbstractSocket::ConnectedState)
         return;
 
-    if (!_socket->bytesAvailable() || _readBuffer.size() >= maxBufferSize)
+    if (!_socket->bytesAvailable() || bytesAvailable() >= maxBufferSize)
         return;
 
+    // Views handed out by readView() must not be used anymore once we're back in the event loop
+    compactReadBuffer();
+
     if (compressionLevel() == NoCompression) {
-        _readBuffer.append(_socket->read(maxBufferSize - _readBuffer.size()));
+        _readBuffer.append(_socket->read(maxBufferSize - bytesAvailable()));
         emit readyRead();
         return;
     }
@@ -145,43 +238,38 @@ void Compressor::readData()
     // considering that otherwise (using an intermediate buffer) we'd copy around data for every single message.
     // TODO: Benchmark if it would still make sense to squeeze the buffer from time to time (e.g. after initial sync)!
 
-    while (_socket->bytesAvailable() && _readBuffer.size() + ioBufferSize < maxBufferSize && _inputBuffer.size() < ioBufferSize) {
+    // A full output buffer means that the decompressor may still hold data for us, even if the socket is drained
+    bool outputPending = false;
+    while ((outputPending || (_socket->bytesAvailable() && _inputBuffer.size() < ioBufferSize))
+           && bytesAvailable() + ioBufferSize < maxBufferSize) {
         _readBuffer.resize(_readBuffer.size() + ioBufferSize);
         _inputBuffer.append(_socket->read(ioBufferSize - _inputBuffer.size()));
 
-        _inflater->next_in = reinterpret_cast<unsigned char*>(_inputBuffer.data());
-        _inflater->avail_in = _inputBuffer.size();
-        _inflater->next_out = reinterpret_cast<unsigned char*>(_readBuffer.data() + _readBuffer.size() - ioBufferSize);
-        _inflater->avail_out = ioBufferSize;
-
-        const unsigned char* orig_out = _inflater->next_out;  // so we see if we have actually produced any output
-
-        int status = inflate(_inflater, Z_SYNC_FLUSH);  // get as much data as possible
+        int consumed = 0;
+        int produced = 0;
+        char* out = _readBuffer.data() + _readBuffer.size() - ioBufferSize;
+        StreamStatus status = _algorithm == Zstd ? inflateZstd(consumed, out, ioBufferSize, produced)
+                                                 : inflateZlib(consumed, out, ioBufferSize, produced);
 
         // adjust input and output buffers
-        _readBuffer.resize(_inflater->next_out - reinterpret_cast<unsigned char*>(_readBuffer.data()));
-        if (_inflater->avail_in > 0)
-            memmove(_inputBuffer.data(), _inflater->next_in, _inflater->avail_in);
-        _inputBuffer.resize(_inflater->avail_in);
+        _readBuffer.resize(_readBuffer.size() - ioBufferSize + produced);
+        _inputBuffer.remove(0, consumed);
+        outputPending = produced == ioBufferSize;
 
-        if (_inflater->next_out != orig_out)
+        if (produced > 0)
             emit readyRead();
 
         switch (status) {
-        case Z_NEED_DICT:
-        case Z_DATA_ERROR:
-        case Z_MEM_ERROR:
-        case Z_STREAM_ERROR:
-            qWarning() << "Error while decompressing stream:" << status;
+        case StreamStatus::Failed:
             emit error(StreamError);
             return;
-        case Z_BUF_ERROR:
+        case StreamStatus::NeedInput:
             // means that we need more input to continue, so this is not an actual error
             return;
-        case Z_STREAM_END:
-            qWarning() << "Reached end of zlib stream!";  // this should really never happen
+        case StreamStatus::Ended:
+            qWarning() << "Reached end of compressed stream!";  // this should really never happen
             return;
-        default:
+        case StreamStatus::Continue:
             // just try to get more out of the stream
             break;
         }
@@ -189,6 +277,61 @@ void Compressor::readData()
     // qDebug() << "inflate in:" << _inflater->total_in << "out:" << _inflater->total_out << "ratio:" << (double)_inflater->total_in/_inflater->total_out;
 }
 
+Compressor::StreamStatus Compressor::inflateZlib(int& consumed, char* out, int outSize, int& produced)
+{
+    _inflater->next_in = reinterpret_cast<unsigned char*>(_inputBuffer.data());
+    _inflater->avail_in = _inputBuffer.size();
+    _inflater->next_out = reinterpret_cast<unsigned char*>(out);
+    _inflater->avail_out = outSize;
+
+    int status = inflate(_inflater, Z_SYNC_FLUSH);  // get as much data as possible
+
+    consumed = _inputBuffer.size() - _inflater->avail_in;
+    produced = outSize - _inflater->avail_out;
+
+    switch (status) {
+    case Z_NEED_DICT:
+    case Z_DATA_ERROR:
+    case Z_MEM_ERROR:
+    case Z_STREAM_ERROR:
+        qWarning() << "Error while decompressing stream:" << status;
+        return StreamStatus::Failed;
+    case Z_BUF_ERROR:
+        return StreamStatus::NeedInput;
+    case Z_STREAM_END:
+        return StreamStatus::Ended;
+    default:
+        return StreamStatus::Continue;
+    }
+}
+
+Compressor::StreamStatus Compressor::inflateZstd(int& consumed, char* out, int outSize, int& produced)
+{
+#ifdef HAVE_ZSTD
+    ZSTD_inBuffer input{_inputBuffer.constData(), static_cast<size_t>(_inputBuffer.size()), 0};
+    ZSTD_outBuffer output{out, static_cast<size_t>(outSize), 0};
+
+    size_t status = ZSTD_decompressStream(_zstdInflater, &output, &input);
+
+    consumed = input.pos;
+    produced = output.pos;
+
+    if (ZSTD_isError(status)) {
+        qWarning() << "Error while decompressing stream:" << ZSTD_getErrorName(status);
+        return StreamStatus::Failed;
+    }
+    // zstd reports no error if it can't make progress, unlike zlib
+    if (!consumed && !produced)
+        return StreamStatus::NeedInput;
+    return StreamStatus::Continue;
+#else
+    Q_UNUSED(out)
+    Q_UNUSED(outSize)
+    consumed = produced = 0;
+    return StreamStatus::Failed;
+#endif
+}
+
 void Compressor::writeData()
 {
     if (compressionLevel() == NoCompression) {
@@ -197,6 +340,17 @@ void Compressor::writeData()
         return;
     }
 
+    bool ok = _algorithm == Zstd ? writeZstd() : writeZlib();
+    if (!ok)
+        return;
+
+    _writeBuffer.resize(0);
+
+    // qDebug() << "deflate in:" << _deflater->total_in << "out:" << _deflater->total_out << "ratio:" << (double)_deflater->total_out/_deflater->total_in;
+}
+
+bool Compressor::writeZlib()
+{
     _deflater->next_in = reinterpret_cast<unsigned char*>(_writeBuffer.data());
     _deflater->avail_in = _writeBuffer.size();
 
@@ -208,27 +362,59 @@ void Compressor::writeData()
         if (status != Z_OK && status != Z_BUF_ERROR) {
             qWarning() << "Error while compressing stream:" << status;
             emit error(StreamError);
-            return;
+            return false;
         }
 
         if (_deflater->avail_out == static_cast<unsigned int>(ioBufferSize))
             continue;  // nothing to write here
 
-        if (!_socket->write(_outputBuffer.constData(), ioBufferSize - _deflater->avail_out)) {
-            qWarning() << "Error while writing to socket:" << _socket->errorString();
-            emit error(DeviceError);
-            return;
-        }
+        if (!writeToSocket(_outputBuffer.constData(), ioBufferSize - _deflater->avail_out))
+            return false;
     } while (_deflater->avail_out == 0);  // the output buffer being full is the only reason we should have to loop here!
 
     if (_deflater->avail_in > 0) {
         qWarning() << "Oops, something weird happened: data still remaining in write buffer!";
         emit error(StreamError);
+        return false;
     }
+    return true;
+}
 
-    _writeBuffer.resize(0);
+bool Compressor::writeZstd()
+{
+#ifdef HAVE_ZSTD
+    ZSTD_inBuffer input{_writeBuffer.constData(), static_cast<size_t>(_writeBuffer.size()), 0};
 
-    // qDebug() << "deflate in:" << _deflater->total_in << "out:" << _deflater->total_out << "ratio:" << (double)_deflater->total_out/_deflater->total_in;
+    size_t remaining;
+    do {
+        ZSTD_outBuffer output{_outputBuffer.data(), static_cast<size_t>(ioBufferSize), 0};
+        // Flushing ends the current block, so the peer can decode everything we've written so far
+        remaining = ZSTD_compressStream2(_zstdDeflater, &output, &input, ZSTD_e_flush);
+        if (ZSTD_isError(remaining)) {
+            qWarning() << "Error while compressing stream:" << ZSTD_getErrorName(remaining);
+            emit error(StreamError);
+            return false;
+        }
+
+        if (output.pos > 0 && !writeToSocket(_outputBuffer.constData(), output.pos))
+            return false;
+    } while (remaining > 0);  // zstd tells us if it could not flush everything into the output buffer
+
+    return true;
+#else
+    emit error(StreamError);
+    return false;
+#endif
+}
+
+bool Compressor::writeToSocket(const char* data, qint64 size)
+{
+    if (!_socket->write(data, size)) {
+        qWarning() << "Error while writing to socket:" << _socket->errorString();
+        emit error(DeviceError);
+        return false;
+    }
+    return true;
 }
 
 void Compressor::flush()
@@ -9,6 +9,9 @@
 
 class QTcpSocket;
 
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+
 class Compressor : public QObject
 {
     Q_OBJECT
@@ -22,6 +25,12 @@ public:
         BestSpeed
     };
 
+    enum Algorithm
+    {
+        Zlib,
+        Zstd
+    };
+
     enum Error
     {
         NoError,
@@ -35,14 +44,29 @@ public:
         Flush
     };
 
-    Compressor(QTcpSocket* socket, CompressionLevel level, QObject* parent = nullptr);
+    Compressor(QTcpSocket* socket, CompressionLevel level, Algorithm algorithm, QObject* parent = nullptr);
     ~Compressor() override;
 
+    /// @returns Whether support for the given algorithm was compiled in
+    static bool isAvailable(Algorithm algorithm);
+
     CompressionLevel compressionLevel() const { return _level; }
+    Algorithm algorithm() const { return _algorithm; }
 
     qint64 bytesAvailable() const;
 
     qint64 read(char* data, qint64 maxSize);
+
+    /**
+     * Reads data without copying it.
+     *
+     * The returned QByteArray points directly into the read buffer. It is only valid until control
+     * returns to the event loop, so it must be consumed (or explicitly copied) right away.
+     *
+     * @param size Number of bytes to read; at most bytesAvailable()
+     * @returns A view on the data, or an empty QByteArray if not enough data is available
+     */
+    QByteArray readView(qint64 size);
     qint64 write(const char* data, qint64 count, WriteBufferHint flush = Flush);
 
     void flush();
@@ -55,14 +79,34 @@ private slots:
     void readData();
 
 private:
+    /// Result of decompressing a chunk of input
+    enum class StreamStatus
+    {
+        Continue,   ///< More output may be available
+        NeedInput,  ///< No progress possible without more input
+        Ended,      ///< The peer finished the stream
+        Failed      ///< The stream is corrupt
+    };
+
     bool initStreams();
+    bool initZstdStreams();
+    void consume(qint64 size);
+    void compactReadBuffer();
     void writeData();
+    bool writeZlib();
+    bool writeZstd();
+    bool writeToSocket(const char* data, qint64 size);
+
+    StreamStatus inflateZlib(int& consumed, char* out, int outSize, int& produced);
+    StreamStatus inflateZstd(int& consumed, char* out, int outSize, int& produced);
 
 private:
     QTcpSocket* _socket;
     CompressionLevel _level;
+    Algorithm _algorithm;
 
     QByteArray _readBuffer;
+    qint64 _readOffset{0};  ///< Start of the unread data in _readBuffer
     QByteArray _writeBuffer;
 
     QByteArray _inputBuffer;
@@ -70,4 +114,7 @@ private:
 
     z_streamp _inflater;
     z_streamp _deflater;
+
+    ZSTD_DCtx_s* _zstdInflater{nullptr};
+    ZSTD_CCtx_s* _zstdDeflater{nullptr};
 };
@@ -1,6 +1,11 @@
 // SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <array>
+#include <atomic>
+#include <new>
+#include <vector>
+
 #include "ctcpevent.h"
 #include "ircevent.h"
 #include "messageevent.h"
@@ -8,6 +13,101 @@
 #include "peer.h"
 #include "signalproxy.h"
 
+namespace {
+
+/// Allocations are grouped into size classes with this granularity
+constexpr std::size_t poolGranularity{16};
+/// Events larger than this aren't pooled
+constexpr std::size_t maxPooledSize{512};
+/// Maximum number of freed allocations kept per size class and thread
+constexpr std::size_t maxPooledPerClass{256};
+
+std::atomic<quint64> liveEvents{0};
+std::atomic<quint64> pooledEvents{0};
+
+/**
+ * Keeps freed event allocations for reuse, grouped by size class.
+ *
+ * Allocations come from the global heap, so an event may be freed to the pool of another thread than the one it was
+ * allocated in.
+ */
+class EventPool
+{
+public:
+    ~EventPool()
+    {
+        for (auto& freeList : _freeLists) {
+            pooledEvents -= freeList.size();
+            for (void* ptr : freeList) {
+                ::operator delete(ptr);
+            }
+        }
+    }
+
+    void* allocate(std::size_t size)
+    {
+        if (size > maxPooledSize) {
+            return ::operator new(size);
+        }
+        auto& freeList = _freeLists[sizeClass(size)];
+        if (freeList.empty()) {
+            return ::operator new((sizeClass(size) + 1) * poolGranularity);
+        }
+        void* ptr = freeList.back();
+        freeList.pop_back();
+        --pooledEvents;
+        return ptr;
+    }
+
+    void release(void* ptr, std::size_t size)
+    {
+        if (size <= maxPooledSize) {
+            auto& freeList = _freeLists[sizeClass(size)];
+            if (freeList.size() < maxPooledPerClass) {
+                freeList.push_back(ptr);
+                ++pooledEvents;
+                return;
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+private:
+    static std::size_t sizeClass(std::size_t size) { return (size + poolGranularity - 1) / poolGranularity - 1; }
+
+    std::array<std::vector<void*>, maxPooledSize / poolGranularity> _freeLists;
+};
+
+thread_local EventPool eventPool;
+
+}  // namespace
+
+void* Event::operator new(std::size_t size)
+{
+    void* ptr = eventPool.allocate(size);
+    ++liveEvents;
+    return ptr;
+}
+
+void Event::operator delete(void* ptr, std::size_t size) noexcept
+{
+    if (!ptr) {
+        return;
+    }
+    --liveEvents;
+    eventPool.release(ptr, size);
+}
+
+quint64 Event::liveCount()
+{
+    return liveEvents;
+}
+
+quint64 Event::pooledCount()
+{
+    return pooledEvents;
+}
+
 Event::Event(EventManager::EventType type)
     : _type(type)
 {
@@ -5,6 +5,8 @@
 
 #include "common-export.h"
 
+#include <cstddef>
+
 #include <QDateTime>
 #include <QDebug>
 
@@ -18,6 +20,16 @@ public:
     explicit Event(EventManager::EventType type = EventManager::Invalid);
     virtual ~Event() = default;
 
+    // Events are created and destroyed for every line received from IRC, so their memory is recycled through a
+    // per-thread pool. In the core, every session runs in its own thread, which makes that a per-session pool.
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size) noexcept;
+
+    //! @return the number of currently allocated events, across all threads
+    static quint64 liveCount();
+    //! @return the number of freed event allocations kept for reuse, across all threads
+    static quint64 pooledCount();
+
     inline EventManager::EventType type() const { return _type; }
 
     inline void setFlag(EventManager::EventFlag flag) { _flags |= flag; }
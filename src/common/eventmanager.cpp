@@ -3,9 +3,14 @@
 
 #include "eventmanager.h"
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include <QCoreApplication>
 #include <QDebug>
 #include <QEvent>
+#include <QVarLengthArray>
 
 #include "event.h"
 #include "ircevent.h"
@@ -16,12 +21,12 @@
 class QueuedQuasselEvent : public QEvent
 {
 public:
-    QueuedQuasselEvent(Event* event)
+    QueuedQuasselEvent(QList<Event*> events)
         : QEvent(QEvent::User)
-        , event(event)
+        , events(std::move(events))
     {
     }
-    Event* event;
+    QList<Event*> events;
 };
 
 // ============================================================
@@ -55,6 +60,40 @@ EventManager::EventType EventManager::eventGroupByName(const QString& name)
     return type == Invalid ? Invalid : static_cast<EventType>(type & EventGroupMask);
 }
 
+EventManager::EventType EventManager::ircEventTypeByCommand(QByteArrayView command)
+{
+    using CommandTable = std::vector<std::pair<QByteArray, EventType>>;
+    auto lessThan = [](QByteArrayView a, QByteArrayView b) { return a.compare(b, Qt::CaseInsensitive) < 0; };
+
+    // Built once from the IrcEvent* enum keys and sorted by command, so lookups don't need to allocate
+    static const CommandTable commandTable = [&lessThan]() {
+        const QByteArray prefix{"IrcEvent"};
+        // Don't go through eventEnum(), which isn't safe to call from several session threads at once
+        const QMetaEnum metaEnum = staticMetaObject.enumerator(staticMetaObject.indexOfEnumerator("EventType"));
+        CommandTable table;
+        for (int i = 0; i < metaEnum.keyCount(); ++i) {
+            const QByteArray key{metaEnum.key(i)};
+            const auto type = static_cast<EventType>(metaEnum.value(i));
+            // Skip event types that don't correspond to an IRC command
+            if (!key.startsWith(prefix) || type == IrcEvent || type == IrcEventRawPrivmsg || type == IrcEventRawNotice
+                || type == IrcEventUnknown || (type & ~IrcEventNumericMask) == IrcEventNumeric) {
+                continue;
+            }
+            table.emplace_back(key.mid(prefix.size()).toUpper(), type);
+        }
+        std::sort(table.begin(), table.end(), [&lessThan](const auto& a, const auto& b) { return lessThan(a.first, b.first); });
+        return table;
+    }();
+
+    auto it = std::lower_bound(commandTable.begin(), commandTable.end(), command, [&lessThan](const auto& entry, QByteArrayView cmd) {
+        return lessThan(entry.first, cmd);
+    });
+    if (it == commandTable.end() || it->first.compare(command, Qt::CaseInsensitive) != 0) {
+        return Invalid;
+    }
+    return it->second;
+}
+
 QString EventManager::enumName(EventType type)
 {
     return eventEnum().valueToKey(type);
@@ -124,6 +163,7 @@ int EventManager::findEventType(const QString& methodSignature_, const QString&
 
 void EventManager::registerObject(QObject* object, Priority priority, const QString& methodPrefix, const QString& filterPrefix)
 {
+    _handlerChains.clear();
     for (int i = object->metaObject()->methodOffset(); i < object->metaObject()->methodCount(); i++) {
         QString methodSignature = object->metaObject()->method(i).methodSignature();
         int eventType = findEventType(methodSignature, methodPrefix);
@@ -163,6 +203,7 @@ void EventManager::registerEventHandler(QList<EventType> events, QObject* object
         qWarning() << Q_FUNC_INFO << QString("Slot %1 not found in object %2").arg(slot).arg(object->objectName());
         return;
     }
+    _handlerChains.clear();
     Handler handler(object, methodIndex, priority);
     foreach (EventType event, events) {
         if (isFilter) {
@@ -179,7 +220,7 @@ void EventManager::registerEventHandler(QList<EventType> events, QObject* object
 void EventManager::postEvent(Event* event)
 {
     if (sender() && sender()->thread() != this->thread()) {
-        auto* queuedEvent = new QueuedQuasselEvent(event);
+        auto* queuedEvent = new QueuedQuasselEvent({event});
         QCoreApplication::postEvent(this, queuedEvent);
     }
     else {
@@ -191,11 +232,29 @@ void EventManager::postEvent(Event* event)
     }
 }
 
+void EventManager::postEvents(const QList<Event*>& events)
+{
+    if (sender() && sender()->thread() != this->thread()) {
+        auto* queuedEvent = new QueuedQuasselEvent(events);
+        QCoreApplication::postEvent(this, queuedEvent);
+    }
+    else {
+        for (Event* event : events) {
+            if (_eventQueue.isEmpty())
+                // we're currently not processing events
+                processEvent(event);
+            else
+                _eventQueue.append(event);
+        }
+    }
+}
+
 void EventManager::customEvent(QEvent* event)
 {
     if (event->type() == QEvent::User) {
         auto* queuedEvent = static_cast<QueuedQuasselEvent*>(event);
-        processEvent(queuedEvent->event);
+        for (Event* e : queuedEvent->events)
+            processEvent(e);
         event->accept();
     }
 }
@@ -215,69 +274,93 @@ void EventManager::dispatchEvent(Event* event)
 {
     // qDebug() << "Dispatching" << event;
 
-    // we try handlers from specialized to generic by masking the enum
-
-    // build a list sorted by priorities that contains all eligible handlers
-    QList<Handler> handlers;
-    QHash<QObject*, Handler> filters;
-    QSet<QObject*> ignored;
     uint type = event->type();
 
-    bool checkDupes = false;
-
     // special handling for numeric IrcEvents
     if ((type & ~IrcEventNumericMask) == IrcEventNumeric) {
         auto* numEvent = static_cast<::IrcEventNumeric*>(event);
         if (!numEvent)
             qWarning() << "Invalid event type for IrcEventNumeric!";
-        else {
-            int num = numEvent->number();
-            if (num > 0) {
-                insertHandlers(registeredHandlers().value(type + num), handlers, false);
-                insertFilters(registeredFilters().value(type + num), filters);
-                checkDupes = true;
-            }
-        }
+        else if (numEvent->number() > 0)
+            type += numEvent->number();
     }
 
-    // exact type
-    insertHandlers(registeredHandlers().value(type), handlers, checkDupes);
-    insertFilters(registeredFilters().value(type), filters);
-
-    // check if we have a generic handler for the event group
-    if ((type & EventGroupMask) != type) {
-        insertHandlers(registeredHandlers().value(type & EventGroupMask), handlers, true);
-        insertFilters(registeredFilters().value(type & EventGroupMask), filters);
-    }
+    // Handlers might register further handlers, so hold on to a (shallow) copy of the chain
+    const HandlerChain chain = handlerChain(type);
 
     // now dispatch the event
-    QList<Handler>::const_iterator it;
-    for (it = handlers.begin(); it != handlers.end() && !event->isStopped(); ++it) {
-        QObject* obj = it->object;
+    QVarLengthArray<QObject*, 4> ignored;
+    for (auto it = chain.begin(); it != chain.end() && !event->isStopped(); ++it) {
+        QObject* obj = it->handler.object;
 
-        if (ignored.contains(obj))  // object has filtered the event
+        if (std::find(ignored.cbegin(), ignored.cend(), obj) != ignored.cend())  // object has filtered the event
             continue;
 
-        if (filters.contains(obj)) {  // we have a filter, so let's check if we want to deliver the event
-            Handler filter = filters.value(obj);
+        if (it->filter.object) {  // we have a filter, so let's check if we want to deliver the event
             bool result = false;
             void* param[] = {&result, &event};
-            obj->qt_metacall(QMetaObject::InvokeMetaMethod, filter.methodIndex, param);
+            obj->qt_metacall(QMetaObject::InvokeMetaMethod, it->filter.methodIndex, param);
             if (!result) {
-                ignored.insert(obj);
+                ignored.append(obj);
                 continue;  // mmmh, event filter told us to not accept
             }
         }
 
         // finally, deliverance!
         void* param[] = {nullptr, &event};
-        obj->qt_metacall(QMetaObject::InvokeMetaMethod, it->methodIndex, param);
+        obj->qt_metacall(QMetaObject::InvokeMetaMethod, it->handler.methodIndex, param);
     }
 
     // that's it
     delete event;
 }
 
+const EventManager::HandlerChain& EventManager::handlerChain(uint type)
+{
+    auto cached = _handlerChains.constFind(type);
+    if (cached != _handlerChains.constEnd())
+        return *cached;
+
+    // we try handlers from specialized to generic by masking the enum
+
+    // build a list sorted by priorities that contains all eligible handlers
+    QList<Handler> handlers;
+    QHash<QObject*, Handler> filters;
+
+    bool checkDupes = false;
+
+    // numeric IrcEvents come with the number already added to the type
+    uint exactType = type;
+    if ((type & ~IrcEventNumericMask) == IrcEventNumeric && type != IrcEventNumeric) {
+        insertHandlers(registeredHandlers().value(type), handlers, false);
+        insertFilters(registeredFilters().value(type), filters);
+        checkDupes = true;
+        exactType = IrcEventNumeric;
+    }
+
+    // exact type
+    insertHandlers(registeredHandlers().value(exactType), handlers, checkDupes);
+    insertFilters(registeredFilters().value(exactType), filters);
+
+    // check if we have a generic handler for the event group
+    if ((exactType & EventGroupMask) != exactType) {
+        insertHandlers(registeredHandlers().value(exactType & EventGroupMask), handlers, true);
+        insertFilters(registeredFilters().value(exactType & EventGroupMask), filters);
+    }
+
+    HandlerChain chain;
+    chain.reserve(handlers.size());
+    for (const Handler& handler : handlers) {
+        ChainLink link;
+        link.handler = handler;
+        auto filter = filters.constFind(handler.object);
+        if (filter != filters.constEnd())
+            link.filter = *filter;
+        chain.append(link);
+    }
+    return *_handlerChains.insert(type, chain);
+}
+
 void EventManager::insertHandlers(const QList<Handler>& newHandlers, QList<Handler>& existing, bool checkDupes)
 {
     foreach (const Handler& handler, newHandlers) {
@@ -5,6 +5,7 @@
 
 #include "common-export.h"
 
+#include <QByteArrayView>
 #include <QMetaEnum>
 
 #include "types.h"
@@ -114,6 +115,12 @@ public:
 
     static EventType eventTypeByName(const QString& name);
     static EventType eventGroupByName(const QString& name);
+    /**
+     * Looks up the event type for a named IRC command
+     * @param command Raw command, compared case-insensitively
+     * @return Matching IrcEvent* type, or Invalid if the command is not known
+     */
+    static EventType ircEventTypeByCommand(QByteArrayView command);
     static QString enumName(EventType type);
     static QString enumName(int type);  // for sanity tests
 
@@ -138,6 +145,15 @@ public slots:
      */
     void postEvent(Event* event);
 
+    //! Send a batch of events to the registered handlers
+    /**
+      Events are processed in order, as if they had been posted one by one, but a batch coming from another thread is
+      delivered in a single event loop iteration.
+      The EventManager takes ownership of the events and will delete them once they're processed.
+      @param events The events to be dispatched
+     */
+    void postEvents(const QList<Event*>& events);
+
 protected:
     virtual Network* networkById(NetworkId id) const = 0;
     void customEvent(QEvent* event) override;
@@ -159,6 +175,15 @@ private:
 
     using HandlerHash = QHash<uint, QList<Handler>>;
 
+    //! A handler along with the filter of its object, if any
+    struct ChainLink
+    {
+        Handler handler;
+        Handler filter;  ///< Has no object if the handler's object doesn't filter this event type
+    };
+
+    using HandlerChain = QList<ChainLink>;
+
     inline const HandlerHash& registeredHandlers() const { return _registeredHandlers; }
     inline HandlerHash& registeredHandlers() { return _registeredHandlers; }
 
@@ -175,11 +200,15 @@ private:
     void processEvent(Event* event);
     void dispatchEvent(Event* event);
 
+    //! Returns the priority-sorted handlers for the given (numeric-adjusted) event type, building them if needed
+    const HandlerChain& handlerChain(uint type);
+
     //! @return the EventType enum
     static QMetaEnum eventEnum();
 
     HandlerHash _registeredHandlers;
     HandlerHash _registeredFilters;
+    QHash<uint, HandlerChain> _handlerChains;  ///< Cached by handlerChain(), cleared whenever handlers are registered
     QList<Event*> _eventQueue;
     static QMetaEnum _enum;
 };
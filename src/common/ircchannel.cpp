@@ -10,6 +10,7 @@
 
 #include "ircuser.h"
 #include "network.h"
+#include "peer.h"
 #include "util.h"
 
 IrcChannel::IrcChannel(const QString& channelname, Network* network)
@@ -66,6 +67,14 @@ QString IrcChannel::userModes(const QString& nick) const
     return userModes(network()->ircUser(nick));
 }
 
+void IrcChannel::bumpRevision(quint64 revision)
+{
+    // IrcChannels are part of their network's InitData
+    SyncableObject::bumpRevision(revision);
+    if (network())
+        network()->bumpRevision(revision);
+}
+
 void IrcChannel::setCodecForEncoding(const QString& codecName)
 {
     QStringConverter::Encoding encoding = QStringConverter::encodingForName(codecName.toUtf8().constData()).value_or(QStringConverter::Utf8);
@@ -193,6 +202,10 @@ void IrcChannel::joinIrcUsers(const QList<IrcUser*>& users, const QStringList& m
 
 void IrcChannel::joinIrcUsers(const QStringList& nicks, const QStringList& modes)
 {
+    // Without the members, we don't know which of them are new; the core keeps us updated via setUserCount() instead
+    if (!_membersSynced)
+        return;
+
     QList<IrcUser*> users;
     foreach (QString nick, nicks)
         users << network()->newIrcUser(nick);
@@ -252,6 +265,9 @@ void IrcChannel::setUserModes(IrcUser* ircuser, const QString& modes)
 
 void IrcChannel::setUserModes(const QString& nick, const QString& modes)
 {
+    // The core sends mode changes to all clients, including those that don't know the members
+    if (!_membersSynced)
+        return;
     setUserModes(network()->ircUser(nick), modes);
 }
 
@@ -272,6 +288,8 @@ void IrcChannel::addUserMode(IrcUser* ircuser, const QString& mode)
 
 void IrcChannel::addUserMode(const QString& nick, const QString& mode)
 {
+    if (!_membersSynced)
+        return;
     addUserMode(network()->ircUser(nick), mode);
 }
 
@@ -292,6 +310,8 @@ void IrcChannel::removeUserMode(IrcUser* ircuser, const QString& mode)
 
 void IrcChannel::removeUserMode(const QString& nick, const QString& mode)
 {
+    if (!_membersSynced)
+        return;
     removeUserMode(network()->ircUser(nick), mode);
 }
 
@@ -307,6 +327,45 @@ QVariantMap IrcChannel::initUserModes() const
     return usermodes;
 }
 
+void IrcChannel::initSetUserCount(int userCount)
+{
+    // Only sent instead of the user modes, so the members need to be requested separately
+    _userCount = userCount;
+    _membersSynced = false;
+}
+
+void IrcChannel::requestMembers()
+{
+    if (_membersSynced || _membersRequested)
+        return;
+    _membersRequested = true;
+    network()->requestChannelMembers(name());
+}
+
+void IrcChannel::setMembers(const QList<IrcUser*>& users, const QStringList& modes)
+{
+    _membersSynced = true;
+    _membersRequested = false;
+    joinIrcUsers(users, modes);
+}
+
+void IrcChannel::addMemberPeer(const Peer* peer)
+{
+    _memberPeers.insert(peer->id());
+}
+
+void IrcChannel::removeMemberPeer(int peerId)
+{
+    _memberPeers.remove(peerId);
+}
+
+void IrcChannel::setUserCount(int userCount)
+{
+    _userCount = userCount;
+    SYNC(ARG(userCount))
+    emit userCountSet(userCount);
+}
+
 void IrcChannel::initSetUserModes(const QVariantMap& usermodes)
 {
     QList<IrcUser*> users;
@@ -41,6 +41,48 @@ public:
 
     inline QList<IrcUser*> ircUsers() const { return _userModes.keys(); }
 
+    /**
+     * Provides the number of users in the channel.
+     *
+     * With lazy channel membership, the number of users is known before the members themselves have been synced.
+     *
+     * @returns The number of users in the channel
+     */
+    inline int userCount() const { return _membersSynced ? _userModes.count() : _userCount; }
+
+    /// @returns Whether the channel's members are known, which is only not the case with lazy channel membership
+    inline bool membersSynced() const { return _membersSynced; }
+
+    /**
+     * Requests the channel's members from the core, unless they're known or have been requested already.
+     */
+    void requestMembers();
+
+    /**
+     * Sets the channel's members as requested via requestMembers().
+     *
+     * @param users The channel's users
+     * @param modes The user modes, matching @a users by index
+     */
+    void setMembers(const QList<IrcUser*>& users, const QStringList& modes);
+
+    /**
+     * Remembers that a client with lazy channel membership has been sent the channel's members.
+     *
+     * @param peer The client's peer
+     */
+    void addMemberPeer(const Peer* peer);
+
+    /**
+     * Forgets a client that has been sent the channel's members, e.g. because it disconnected.
+     *
+     * @param peerId The ID of the client's peer
+     */
+    void removeMemberPeer(int peerId);
+
+    /// @returns The IDs of the clients with lazy channel membership that have been sent the channel's members
+    inline const QSet<int>& memberPeers() const { return _memberPeers; }
+
     QString userModes(IrcUser* ircuser) const;
     QString userModes(const QString& nick) const;
 
@@ -59,6 +101,8 @@ public:
     QString decodeString(const QByteArray& text) const;
     QByteArray encodeString(const QString& string) const;
 
+    void bumpRevision(quint64 revision) override;
+
 public slots:
     void setTopic(const QString& topic);
     void setPassword(const QString& password);
@@ -83,6 +127,13 @@ public slots:
     void addChannelMode(const QChar& mode, const QString& value);
     void removeChannelMode(const QChar& mode, const QString& value);
 
+    /**
+     * Sets the number of users, for clients that don't know the channel's members.
+     *
+     * @param userCount The number of users in the channel
+     */
+    void setUserCount(int userCount);
+
     // init geters
     QVariantMap initUserModes() const;
     QVariantMap initChanModes() const;
@@ -90,6 +141,7 @@ public slots:
     // init seters
     void initSetUserModes(const QVariantMap& usermodes);
     void initSetChanModes(const QVariantMap& chanModes);
+    void initSetUserCount(int userCount);
 
 signals:
     void topicSet(const QString& topic);  // needed by NetworkModel
@@ -108,6 +160,7 @@ signals:
     void ircUserModeAdded(IrcUser* ircuser, QString mode);
     void ircUserModeRemoved(IrcUser* ircuser, QString mode);
     void ircUserModesSet(IrcUser* ircuser, QString modes);
+    void userCountSet(int userCount);
 
     void parted();  // convenience signal emitted before channels destruction
 
@@ -123,6 +176,10 @@ private:
     bool _encrypted;
 
     QHash<IrcUser*, QString> _userModes;
+    int _userCount{0};
+    bool _membersSynced{true};
+    bool _membersRequested{false};
+    QSet<int> _memberPeers;  ///< See memberPeers()
 
     Network* _network;
 
@@ -3,7 +3,9 @@
 
 #include "ircdecoder.h"
 
+#include <QAnyStringView>
 #include <QDebug>
+#include <QUtf8StringView>
 
 #include "irctag.h"
 
@@ -83,89 +85,182 @@ void IrcDecoder::skipEmptyParts(const QByteArray& raw, int& start)
     }
 }
 
-QHash<IrcTagKey, QString> IrcDecoder::parseTags(const std::function<QString(const QByteArray&)>& decode, const QByteArray& raw, int& start)
+int IrcDecoder::fragmentEnd(QByteArrayView raw, int start)
 {
-    QHash<IrcTagKey, QString> tags = {};
-    QString rawTagStr = decode(extractFragment(raw, start, -1, '@'));
+    qsizetype end = raw.indexOf(' ', start);
+    return end == -1 ? raw.size() : end;
+}
+
+void IrcDecoder::parseTags(IrcMessageView& view, int& start)
+{
+    const QByteArrayView raw{view._raw};
+    if (start >= raw.size() || raw[start] != '@') {
+        return;
+    }
+    const int end = fragmentEnd(raw, start);
+    // Restrict searches to the tag fragment
+    const QByteArrayView rawTags = raw.first(end);
+
     // Tags are delimited with ; according to spec
-    QList<QString> rawTags = rawTagStr.split(';');
-    for (const QString& rawTag : rawTags) {
-        if (rawTag.isEmpty()) {
-            continue;
+    int pos = start + 1;
+    while (pos < end) {
+        int tagEnd = rawTags.indexOf(';', pos);
+        if (tagEnd == -1) {
+            tagEnd = end;
         }
+        if (tagEnd > pos) {
+            IrcMessageView::Tag tag;
+            const QByteArrayView rawTag = rawTags.first(tagEnd);
+            int keyStart = pos;
+            int keyEnd = rawTag.indexOf('=', pos);
+            if (keyEnd == -1) {
+                keyEnd = tagEnd;
+            }
+            else {
+                tag.value = {keyEnd + 1, tagEnd - keyEnd - 1};
+            }
 
-        QString rawKey;
-        QString rawValue;
-        int index = rawTag.indexOf('=');
-        if (index == -1 || index == rawTag.length()) {
-            rawKey = rawTag;
-        }
-        else {
-            rawKey = rawTag.left(index);
-            rawValue = rawTag.mid(index + 1);
-        }
+            tag.clientTag = raw[keyStart] == '+';
+            if (tag.clientTag) {
+                keyStart++;
+            }
 
-        IrcTagKey key{};
-        key.clientTag = rawKey.startsWith('+');
-        if (key.clientTag) {
-            rawKey.remove(0, 1);
+            int splitIndex = rawTag.first(keyEnd).lastIndexOf('/');
+            if (splitIndex > keyStart && splitIndex + 1 < keyEnd) {
+                tag.vendor = {keyStart, splitIndex - keyStart};
+                tag.key = {splitIndex + 1, keyEnd - splitIndex - 1};
+            }
+            else {
+                tag.key = {keyStart, keyEnd - keyStart};
+            }
+            view._tags.append(tag);
         }
+        pos = tagEnd + 1;
+    }
+    start = end;
+}
 
-        int splitIndex = rawKey.lastIndexOf('/');
-        if (splitIndex > 0 && splitIndex + 1 < rawKey.length()) {
-            key.key = rawKey.mid(splitIndex + 1);
-            key.vendor = rawKey.left(splitIndex);
+IrcMessageView IrcDecoder::parseView(const QByteArray& raw)
+{
+    IrcMessageView view;
+    view._raw = raw;
+
+    int start = 0;
+    skipEmptyParts(raw, start);
+    parseTags(view, start);
+    skipEmptyParts(raw, start);
+    if (start < raw.length() && raw[start] == ':') {
+        int end = fragmentEnd(raw, start);
+        view._prefix = {start + 1, end - start - 1};
+        start = end;
+    }
+    skipEmptyParts(raw, start);
+    int end = fragmentEnd(raw, start);
+    view._command = {start, end - start};
+    start = end;
+    skipEmptyParts(raw, start);
+    while (start != raw.length()) {
+        if (raw[start] == ':') {
+            // Skip the prefix, the trailing parameter spans the remainder of the message
+            start++;
+            end = raw.length();
         }
         else {
-            key.key = rawKey;
+            end = fragmentEnd(raw, start);
         }
-        tags[key] = parseTagValue(rawValue);
+        view._params.append({start, end - start});
+        start = end;
+        skipEmptyParts(raw, start);
     }
-    return tags;
+    return view;
 }
 
-QString IrcDecoder::parsePrefix(const std::function<QString(const QByteArray&)>& decode, const QByteArray& raw, int& start)
+void IrcDecoder::parseMessage(const std::function<QString(const QByteArray&)>& decode,
+                              const QByteArray& rawMsg,
+                              QHash<IrcTagKey, QString>& tags,
+                              QString& prefix,
+                              QString& command,
+                              QList<QByteArray>& parameters)
 {
-    return decode(extractFragment(raw, start, -1, ':'));
+    IrcMessageView view = parseView(rawMsg);
+    tags = view.tags(decode);
+    prefix = view.decodedPrefix(decode);
+    command = view.decodedCommand(decode);
+    parameters = view.params();
 }
 
-QString IrcDecoder::parseCommand(const std::function<QString(const QByteArray&)>& decode, const QByteArray& raw, int& start)
+namespace {
+
+/// Wraps a fragment of a message for passing it to a decoder, without copying it
+QByteArray rawFragment(QByteArrayView fragment)
 {
-    return decode(extractFragment(raw, start, -1));
+    return QByteArray::fromRawData(fragment.data(), fragment.size());
 }
 
-QByteArray IrcDecoder::parseParameter(const QByteArray& raw, int& start)
+QUtf8StringView utf8View(QByteArrayView fragment)
 {
-    if (start < raw.length() && raw[start] == ':') {
-        // Skip the prefix
-        start++;
-        return extractFragment(raw, start, raw.size());
+    return {fragment.data(), fragment.size()};
+}
+
+}  // namespace
+
+QString IrcMessageView::decodedPrefix(const Decoder& decode) const
+{
+    return decode(rawFragment(prefix()));
+}
+
+QString IrcMessageView::decodedCommand(const Decoder& decode) const
+{
+    return decode(rawFragment(command()));
+}
+
+QByteArray IrcMessageView::rawParam(int index) const
+{
+    return rawFragment(param(index));
+}
+
+QList<QByteArray> IrcMessageView::params() const
+{
+    QList<QByteArray> result;
+    result.reserve(_params.size());
+    for (const Fragment& f : _params) {
+        result.append(fragment(f).toByteArray());
     }
-    else {
-        return extractFragment(raw, start);
+    return result;
+}
+
+int IrcMessageView::indexOfTag(const IrcTagKey& key) const
+{
+    for (int i = _tags.size() - 1; i >= 0; --i) {
+        const Tag& tag = _tags[i];
+        if (tag.clientTag == key.clientTag && QAnyStringView::compare(key.key, utf8View(fragment(tag.key))) == 0
+            && QAnyStringView::compare(key.vendor, utf8View(fragment(tag.vendor))) == 0) {
+            return i;
+        }
     }
+    return -1;
 }
 
-void IrcDecoder::parseMessage(const std::function<QString(const QByteArray&)>& decode,
-                              const QByteArray& rawMsg,
-                              QHash<IrcTagKey, QString>& tags,
-                              QString& prefix,
-                              QString& command,
-                              QList<QByteArray>& parameters)
+QString IrcMessageView::tagValue(const IrcTagKey& key, const Decoder& decode) const
 {
-    int start = 0;
-    skipEmptyParts(rawMsg, start);
-    tags = parseTags(decode, rawMsg, start);
-    skipEmptyParts(rawMsg, start);
-    prefix = parsePrefix(decode, rawMsg, start);
-    skipEmptyParts(rawMsg, start);
-    command = parseCommand(decode, rawMsg, start);
-    skipEmptyParts(rawMsg, start);
-    QList<QByteArray> params;
-    while (start != rawMsg.length()) {
-        QByteArray param = parseParameter(rawMsg, start);
-        skipEmptyParts(rawMsg, start);
-        params.append(param);
+    int index = indexOfTag(key);
+    if (index == -1) {
+        return {};
+    }
+    return IrcDecoder::parseTagValue(decode(rawFragment(fragment(_tags[index].value))));
+}
+
+QHash<IrcTagKey, QString> IrcMessageView::tags(const Decoder& decode) const
+{
+    QHash<IrcTagKey, QString> result;
+    for (const Tag& tag : _tags) {
+        IrcTagKey key{};
+        key.clientTag = tag.clientTag;
+        if (tag.vendor.length > 0) {
+            key.vendor = decode(rawFragment(fragment(tag.vendor)));
+        }
+        key.key = decode(rawFragment(fragment(tag.key)));
+        result[key] = IrcDecoder::parseTagValue(decode(rawFragment(fragment(tag.value))));
     }
-    parameters = params;
+    return result;
 }
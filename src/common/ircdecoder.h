@@ -7,11 +7,103 @@
 
 #include <functional>
 
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVarLengthArray>
+
 #include "irctag.h"
 
+/**
+ * A parsed IRC message that refers to the fragments of the raw message rather than copying them.
+ *
+ * Parsing only records offsets into the raw message, so it doesn't allocate for common messages. Fields are decoded
+ * when they are accessed, which means fields nobody reads never get converted to QString.
+ */
+class COMMON_EXPORT IrcMessageView
+{
+public:
+    using Decoder = std::function<QString(const QByteArray&)>;
+
+    /// @returns The raw message this view refers to
+    const QByteArray& raw() const { return _raw; }
+
+    /// @returns The prefix without the leading colon, or an empty view if the message has no prefix
+    QByteArrayView prefix() const { return fragment(_prefix); }
+    /// @returns The named command or numeric RPL
+    QByteArrayView command() const { return fragment(_command); }
+    QString decodedPrefix(const Decoder& decode) const;
+    QString decodedCommand(const Decoder& decode) const;
+
+    int paramCount() const { return _params.size(); }
+    /// @returns The parameter at the given index, without the leading colon of a trailing parameter
+    QByteArrayView param(int index) const { return fragment(_params.at(index)); }
+    /**
+     * Wraps a parameter for passing it to a decoder, without copying it
+     * @param index Index of the parameter
+     * @return Byte array referring to raw(), which must not outlive this view
+     */
+    QByteArray rawParam(int index) const;
+    /// @returns Copies of all parameters
+    QList<QByteArray> params() const;
+
+    int tagCount() const { return _tags.size(); }
+    bool hasTag(const IrcTagKey& key) const { return indexOfTag(key) != -1; }
+    /**
+     * Decodes the value of a message tag, including unescaping
+     * @param key Key of the tag
+     * @param decode Decoder to be used for decoding the value
+     * @return Decoded value, or a null string if the tag is not present
+     */
+    QString tagValue(const IrcTagKey& key, const Decoder& decode) const;
+    /**
+     * Decodes all message tags
+     * @param decode Decoder to be used for decoding keys and values
+     * @return Map of IRCv3 message tags
+     */
+    QHash<IrcTagKey, QString> tags(const Decoder& decode) const;
+
+private:
+    friend class IrcDecoder;
+
+    struct Fragment
+    {
+        int start{0};
+        int length{0};
+    };
+
+    struct Tag
+    {
+        Fragment vendor;
+        Fragment key;
+        Fragment value;
+        bool clientTag{false};
+    };
+
+    QByteArrayView fragment(const Fragment& f) const { return QByteArrayView{_raw}.sliced(f.start, f.length); }
+    /// @returns The index of the last tag with the given key, as later tags override earlier ones
+    int indexOfTag(const IrcTagKey& key) const;
+
+    QByteArray _raw;
+    Fragment _prefix;
+    Fragment _command;
+    // RFC 1459 allows for 15 parameters, and most messages carry only a few tags
+    QVarLengthArray<Tag, 8> _tags;
+    QVarLengthArray<Fragment, 15> _params;
+};
+
 class COMMON_EXPORT IrcDecoder
 {
 public:
+    /**
+     * Parses an IRC message without copying or decoding any of its fields
+     * @param raw Raw Message
+     * @return View on the fragments of the message
+     */
+    static IrcMessageView parseView(const QByteArray& raw);
+
     /**
      * Parses an IRC message
      * @param decode Decoder to be used for decoding the message
@@ -47,6 +139,8 @@ public:
     static void skipEmptyParts(const QByteArray& raw, int& start);
 
 private:
+    friend class IrcMessageView;
+
     /**
      * Parses an encoded IRCv3 message tag value
      * @param value encoded IRCv3 message tag value
@@ -54,35 +148,16 @@ private:
      */
     static QString parseTagValue(const QString& value);
     /**
-     * Parses IRCv3 message tags given a message
-     * @param net Decoder to be used for decoding the message
-     * @param raw Raw Message
-     * @param start Current index into the message, will be advanced automatically
-     * @return Parsed message tags
-     */
-    static QHash<IrcTagKey, QString> parseTags(const std::function<QString(const QByteArray&)>& decode, const QByteArray& raw, int& start);
-    /**
-     * Parses an IRC prefix, if available
-     * @param net Decoder to be used for decoding the message
-     * @param raw Raw Message
+     * Parses IRCv3 message tags into the given view
+     * @param view View to store the tag fragments in
      * @param start Current index into the message, will be advanced automatically
-     * @return Parsed prefix or empty string
      */
-    static QString parsePrefix(const std::function<QString(const QByteArray&)>& decode, const QByteArray& raw, int& start);
+    static void parseTags(IrcMessageView& view, int& start);
     /**
-     * Parses an IRC named command or numeric RPL
-     * @param net Decoder to be used for decoding the message
+     * Finds the end of the space-delimited fragment starting at the given index
      * @param raw Raw Message
-     * @param start Current index into the message, will be advanced automatically
-     * @return Parsed command
-     */
-    static QString parseCommand(const std::function<QString(const QByteArray&)>& decode, const QByteArray& raw, int& start);
-    /**
-     * Parses an IRC parameter
-     * @param net Decoder to be used for decoding the message
-     * @param raw Raw Message
-     * @param start Current index into the message, will be advanced automatically
-     * @return Parsed parameter
+     * @param start Start of the fragment
+     * @return Index of the next space character, or the end of the message
      */
-    static QByteArray parseParameter(const QByteArray& raw, int& start);
+    static int fragmentEnd(QByteArrayView raw, int start);
 };
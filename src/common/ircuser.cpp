@@ -9,6 +9,7 @@
 
 #include "ircchannel.h"
 #include "network.h"
+#include "peer.h"
 #include "signalproxy.h"
 #include "util.h"
 
@@ -133,7 +134,7 @@ void IrcUser::setAway(bool away)
     if (away != _away) {
         _away = away;
         markAwayChanged();
-        SYNC(ARG(away))
+        SYNC_COALESCED(ARG(away))
         emit awaySet(away);
     }
 }
@@ -152,7 +153,7 @@ void IrcUser::setIdleTime(const QDateTime& idleTime)
     if (idleTime.isValid() && _idleTime != idleTime) {
         _idleTime = idleTime;
         _idleTimeSet = QDateTime::currentDateTime();
-        SYNC(ARG(idleTime))
+        SYNC_COALESCED(ARG(idleTime))
     }
 }
 
@@ -190,7 +191,7 @@ void IrcUser::setLastAwayMessageTime(const QDateTime& lastAwayMessageTime)
 {
     if (lastAwayMessageTime.toUTC() > _lastAwayMessageTime) {
         _lastAwayMessageTime = lastAwayMessageTime.toUTC();
-        SYNC(ARG(lastAwayMessageTime))
+        SYNC_COALESCED(ARG(lastAwayMessageTime))
     }
 }
 
@@ -235,6 +236,29 @@ void IrcUser::setEncrypted(bool encrypted)
     SYNC(ARG(encrypted))
 }
 
+void IrcUser::bumpRevision(quint64 revision)
+{
+    // IrcUsers are part of their network's InitData
+    SyncableObject::bumpRevision(revision);
+    if (network())
+        network()->bumpRevision(revision);
+}
+
+void IrcUser::withholdFrom(const Peer* peer)
+{
+    _withheldFrom.insert(peer->id());
+}
+
+void IrcUser::releaseTo(int peerId)
+{
+    _withheldFrom.remove(peerId);
+}
+
+bool IrcUser::isSyncedTo(const Peer* peer) const
+{
+    return !_withheldFrom.contains(peer->id());
+}
+
 void IrcUser::updateObjectName()
 {
     setObjectName(QString::number(network()->networkId().toInt()) + "/" + _nick);
@@ -73,6 +73,26 @@ public:
 
     QStringList channels() const;
 
+    void bumpRevision(quint64 revision) override;
+
+    /**
+     * Stops sending sync calls of the user to a peer that hasn't been sent the user.
+     *
+     * Clients with lazy channel membership only get the IrcUsers of channels they request the members of.
+     *
+     * @param peer The peer the user was left out for
+     */
+    void withholdFrom(const Peer* peer);
+
+    /**
+     * Resumes sending sync calls of the user to a peer that has been sent the user by now.
+     *
+     * @param peerId The ID of the peer
+     */
+    void releaseTo(int peerId);
+
+    bool isSyncedTo(const Peer* peer) const override;
+
     // user-specific encodings
     inline const QStringEncoder& codecForEncoding() const { return _encoder; }
     inline const QStringDecoder& codecForDecoding() const { return _decoder; }
@@ -225,6 +245,7 @@ private:
     // QSet<QString> _channels;
     QSet<IrcChannel*> _channels;
     QString _userModes;
+    QSet<int> _withheldFrom;  ///< IDs of the peers sync calls are withheld from, see withholdFrom()
 
     Network* _network;
 
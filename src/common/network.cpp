@@ -9,6 +9,7 @@
 
 #include "ircchannel.h"
 #include "ircuser.h"
+#include "peer.h"
 #include "util.h"
 
 const QStringConverter::Encoding Network::_defaultEncoding = QStringConverter::Utf8;
@@ -116,7 +117,7 @@ void Network::setLatency(int latency)
 {
     if (_latency != latency) {
         _latency = latency;
-        SYNC(ARG(latency))
+        SYNC_COALESCED(ARG(latency))
     }
 }
 
@@ -809,21 +810,41 @@ QVariantMap Network::initIrcUsersAndChannels() const
 {
     QVariantMap usersAndChannels;
 
+    // Clients supporting lazy channel membership only get the number of users for each channel, and request the members
+    // of channels they actually show. This leaves out the bulk of the state of big networks.
+    Peer* peer = SignalProxy::current() ? SignalProxy::current()->targetPeer() : nullptr;
+    bool lazyMembers = peer && peer->hasFeature(Quassel::Feature::LazyChannelMembers);
+
     QVariantMap users;
     foreach (IrcUser* user, _ircUsers) {
+        if (lazyMembers && !user->channels().isEmpty() && user != me()) {
+            // The client doesn't know the user, so it can't process sync calls for it either
+            user->withholdFrom(peer);
+            continue;
+        }
         users[user->nick()] = user->toVariantMap();
     }
     usersAndChannels["IrcUsers"] = users;
 
     QVariantMap channels;
     foreach (IrcChannel* channel, _ircChannels) {
-        channels[channel->name()] = channel->toVariantMap();
+        QVariantMap channelData = channel->toVariantMap();
+        if (lazyMembers) {
+            channelData.remove("UserModes");
+            channelData["UserCount"] = channel->userCount();
+        }
+        channels[channel->name()] = channelData;
     }
     usersAndChannels["IrcChannels"] = channels;
 
     return usersAndChannels;
 }
 
+bool Network::allowsCachedInitData(const Peer* peer) const
+{
+    return !peer->hasFeature(Quassel::Feature::LazyChannelMembers);
+}
+
 void Network::initSetIrcUsersAndChannels(const QVariantMap& usersAndChannels)
 {
     QVariantMap users = usersAndChannels["IrcUsers"].toMap();
@@ -837,6 +858,30 @@ void Network::initSetIrcUsersAndChannels(const QVariantMap& usersAndChannels)
     }
 }
 
+void Network::setChannelMembers(const QString& channel, const QVariantMap& members)
+{
+    IrcChannel* ircChannel = this->ircChannel(channel);
+    if (!ircChannel) {
+        qWarning() << "Received members for unknown channel" << channel << "on network" << networkName();
+        return;
+    }
+
+    QVariantMap users = members["IrcUsers"].toMap();
+    QVariantMap userModes = members["UserModes"].toMap();
+    QList<IrcUser*> ircUsers;
+    QStringList modes;
+    for (auto iter = userModes.cbegin(); iter != userModes.cend(); ++iter) {
+        IrcUser* user = ircUser(iter.key());
+        if (!user)
+            user = newIrcUser(iter.key(), users[iter.key()].toMap());
+        if (!user)
+            continue;
+        ircUsers << user;
+        modes << iter.value().toString();
+    }
+    ircChannel->setMembers(ircUsers, modes);
+}
+
 IrcUser* Network::updateNickFromMask(const QString& mask)
 {
     QString nick = nickFromMask(mask);
@@ -136,6 +136,12 @@ public:
     Network(const NetworkId& networkid, QObject* parent = nullptr);
     ~Network() override;
 
+    // The InitData of big networks is expensive to serialize, and consists of plain data only
+    bool allowsConcurrentInitData() const override { return true; }
+
+    // With lazy channel membership, building the InitData determines which IrcUsers the client knows
+    bool allowsCachedInitData(const Peer* peer) const override;
+
     inline NetworkId networkId() const { return _networkId; }
 
     inline SignalProxy* proxy() const { return _proxy; }
@@ -575,6 +581,21 @@ public slots:
     virtual inline void requestDisconnect() const { REQUEST(NO_ARG) }
     virtual inline void requestSetNetworkInfo(const NetworkInfo& info) { REQUEST(ARG(info)) }
 
+    /**
+     * Requests the members of a channel, for networks that were synced with lazy channel membership.
+     *
+     * @param channel The channel's name
+     */
+    virtual inline void requestChannelMembers(const QString& channel) const { REQUEST(ARG(channel)) }
+
+    /**
+     * Sets the members of a channel, as requested via requestChannelMembers().
+     *
+     * @param channel The channel's name
+     * @param members Map containing the IrcUsers' states ("IrcUsers") and the user modes ("UserModes") by nick
+     */
+    void setChannelMembers(const QString& channel, const QVariantMap& members);
+
     void emitConnectionError(const QString&);
 
 protected slots:
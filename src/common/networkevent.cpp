@@ -42,6 +42,7 @@ NetworkDataEvent::NetworkDataEvent(EventManager::EventType type, QVariantMap& ma
     : NetworkEvent(type, map, network)
 {
     _data = map.take("data").toByteArray();
+    _length = _data.size();
 }
 
 void NetworkDataEvent::toVariantMap(QVariantMap& map) const
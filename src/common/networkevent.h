@@ -5,6 +5,8 @@
 
 #include <utility>
 
+#include <QByteArray>
+#include <QByteArrayView>
 #include <QStringList>
 #include <QVariantList>
 
@@ -73,11 +75,34 @@ public:
     explicit NetworkDataEvent(EventManager::EventType type, Network* network, QByteArray data)
         : NetworkEvent(type, network)
         , _data(std::move(data))
+        , _length(_data.size())
     {
     }
 
-    inline QByteArray data() const { return _data; }
-    inline void setData(const QByteArray& data) { _data = data; }
+    /**
+     * Creates an event for a part of a larger buffer, without copying it.
+     *
+     * @param buffer The buffer, which is shared with the event
+     * @param offset Start of the event's data within the buffer
+     * @param length Length of the event's data
+     */
+    explicit NetworkDataEvent(EventManager::EventType type, Network* network, QByteArray buffer, qsizetype offset, qsizetype length)
+        : NetworkEvent(type, network)
+        , _data(std::move(buffer))
+        , _offset(offset)
+        , _length(length)
+    {
+    }
+
+    inline QByteArray data() const { return _data.mid(_offset, _length); }
+    /// @returns The data without copying it, valid for as long as the event exists
+    inline QByteArrayView dataView() const { return QByteArrayView{_data}.sliced(_offset, _length); }
+    inline void setData(const QByteArray& data)
+    {
+        _data = data;
+        _offset = 0;
+        _length = data.size();
+    }
 
 protected:
     explicit NetworkDataEvent(EventManager::EventType type, QVariantMap& map, Network* network);
@@ -92,6 +117,8 @@ protected:
 
 private:
     QByteArray _data;
+    qsizetype _offset{0};
+    qsizetype _length{0};
 
     friend class NetworkEvent;
 };
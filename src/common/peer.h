@@ -5,8 +5,11 @@
 
 #include "common-export.h"
 
+#include <functional>
+
 #include <QAbstractSocket>
 #include <QDataStream>
+#include <QFuture>
 #include <QPointer>
 
 #include "authhandler.h"
@@ -54,6 +57,40 @@ public:
     virtual QString address() const = 0;
     virtual quint16 port() const = 0;
 
+    /* Pre-encoding of sigproxy messages
+     *
+     * When the same message goes out to many peers, SignalProxy encodes it only once for all peers that would
+     * serialize it identically (see encodesLike()), and hands the resulting frame to each of them via dispatchEncoded().
+     * Peers that don't support this return an empty QByteArray from encode(), and get the message dispatched as usual.
+     */
+    virtual QByteArray encode(const QuasselProtocol::SyncMessage&) const { return {}; }
+    virtual QByteArray encode(const QuasselProtocol::RpcCall&) const { return {}; }
+    virtual QByteArray encode(const QuasselProtocol::InitRequest&) const { return {}; }
+    virtual QByteArray encode(const QuasselProtocol::InitData&) const { return {}; }
+    virtual void dispatchEncoded(const QByteArray&, QuasselProtocol::Priority) {}
+
+    /**
+     * Provides a function that encodes the given InitData like encode() does, and that can be run in any thread.
+     *
+     * @returns The encoder, or an empty function if the peer doesn't support concurrent encoding
+     */
+    virtual std::function<QByteArray()> concurrentEncoder(const QuasselProtocol::InitData&) const { return {}; }
+
+    /**
+     * Sends a message that is still being encoded.
+     *
+     * Messages sent after this one are held back until it is ready, so the order of messages is preserved.
+     */
+    virtual void dispatchEncoded(QFuture<QByteArray>, QuasselProtocol::Priority) {}
+
+    /**
+     * Checks if the given peer would encode sigproxy messages exactly like this one.
+     *
+     * @param other The peer to compare with
+     * @returns Whether messages encoded by @a other can be sent to this peer via dispatchEncoded()
+     */
+    virtual bool encodesLike(const Peer* other) const { return other == this; }
+
 public slots:
     /* Handshake messages */
     virtual void dispatch(const QuasselProtocol::RegisterClient&) = 0;
@@ -3,35 +3,49 @@
 
 #include "peerfactory.h"
 
+#include "protocols/compact/compactpeer.h"
 #include "protocols/datastream/datastreampeer.h"
 #include "protocols/legacy/legacypeer.h"
 
 PeerFactory::ProtoList PeerFactory::supportedProtocols()
 {
     ProtoList result;
+    result.append(ProtoDescriptor(QuasselProtocol::CompactProtocol, CompactPeer::supportedFeatures()));
     result.append(ProtoDescriptor(QuasselProtocol::DataStreamProtocol, DataStreamPeer::supportedFeatures()));
     result.append(ProtoDescriptor(QuasselProtocol::LegacyProtocol, 0));
     return result;
 }
 
-RemotePeer* PeerFactory::createPeer(
-    const ProtoDescriptor& protocol, AuthHandler* authHandler, QTcpSocket* socket, Compressor::CompressionLevel level, QObject* parent)
+RemotePeer* PeerFactory::createPeer(const ProtoDescriptor& protocol,
+                                    AuthHandler* authHandler,
+                                    QTcpSocket* socket,
+                                    Compressor::CompressionLevel level,
+                                    Compressor::Algorithm algorithm,
+                                    QObject* parent)
 {
-    return createPeer(ProtoList() << protocol, authHandler, socket, level, parent);
+    return createPeer(ProtoList() << protocol, authHandler, socket, level, algorithm, parent);
 }
 
-RemotePeer* PeerFactory::createPeer(
-    const ProtoList& protocols, AuthHandler* authHandler, QTcpSocket* socket, Compressor::CompressionLevel level, QObject* parent)
+RemotePeer* PeerFactory::createPeer(const ProtoList& protocols,
+                                    AuthHandler* authHandler,
+                                    QTcpSocket* socket,
+                                    Compressor::CompressionLevel level,
+                                    Compressor::Algorithm algorithm,
+                                    QObject* parent)
 {
     foreach (const ProtoDescriptor& protodesc, protocols) {
         QuasselProtocol::Type proto = protodesc.first;
         quint16 features = protodesc.second;
         switch (proto) {
         case QuasselProtocol::LegacyProtocol:
-            return new LegacyPeer(authHandler, socket, level, parent);
+            return new LegacyPeer(authHandler, socket, level, algorithm, parent);
+        case QuasselProtocol::CompactProtocol:
+            if (CompactPeer::acceptsFeatures(features))
+                return new CompactPeer(authHandler, socket, features, level, algorithm, parent);
+            break;
         case QuasselProtocol::DataStreamProtocol:
             if (DataStreamPeer::acceptsFeatures(features))
-                return new DataStreamPeer(authHandler, socket, features, level, parent);
+                return new DataStreamPeer(authHandler, socket, features, level, algorithm, parent);
             break;
         default:
             break;
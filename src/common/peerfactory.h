@@ -29,10 +29,12 @@ public:
                                   AuthHandler* authHandler,
                                   QTcpSocket* socket,
                                   Compressor::CompressionLevel level,
+                                  Compressor::Algorithm algorithm,
                                   QObject* parent = nullptr);
     static RemotePeer* createPeer(const ProtoList& protocols,
                                   AuthHandler* authHandler,
                                   QTcpSocket* socket,
                                   Compressor::CompressionLevel level,
+                                  Compressor::Algorithm algorithm,
                                   QObject* parent = nullptr);
 };
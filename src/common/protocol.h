@@ -21,13 +21,15 @@ enum Type
 {
     InternalProtocol = 0x00,
     LegacyProtocol = 0x01,
-    DataStreamProtocol = 0x02
+    DataStreamProtocol = 0x02,
+    CompactProtocol = 0x03
 };
 
 enum Feature
 {
     Encryption = 0x01,
-    Compression = 0x02
+    Compression = 0x02,
+    ZstdCompression = 0x04  ///< Preferred over Compression (zlib) if both sides support it
 };
 
 enum class Handler
@@ -36,11 +38,20 @@ enum class Handler
     AuthHandler
 };
 
+/// Priority classes of outgoing messages, deciding when they are written to peers that can't keep up
+enum class Priority
+{
+    Control,   ///< Handshake and heartbeats, written immediately
+    Realtime,  ///< Regular sigproxy traffic like new messages and state changes, written immediately
+    Bulk       ///< Large replies like backlog, deferred while the socket has too much data pending
+};
+
 /*** Handshake, handled by AuthHandler ***/
 
 struct HandshakeMessage
 {
     inline Handler handler() const { return Handler::AuthHandler; }
+    inline Priority priority() const { return Priority::Control; }
 };
 
 struct RegisterClient : public HandshakeMessage
@@ -178,6 +189,7 @@ struct SessionState : public HandshakeMessage
 struct SignalProxyMessage
 {
     inline Handler handler() const { return Handler::SignalProxy; }
+    inline Priority priority() const { return Priority::Realtime; }
 };
 
 struct SyncMessage : public SignalProxyMessage
@@ -191,6 +203,12 @@ struct SyncMessage : public SignalProxyMessage
     {
     }
 
+    /// Backlog replies can be huge, and are less urgent than anything else
+    inline Priority priority() const
+    {
+        return className == "BacklogManager" && slotName.startsWith("receive") ? Priority::Bulk : Priority::Realtime;
+    }
+
     QByteArray className;
     QString objectName;
     QByteArray slotName;
@@ -213,14 +231,16 @@ struct RpcCall : public SignalProxyMessage
 struct InitRequest : public SignalProxyMessage
 {
     InitRequest() = default;
-    InitRequest(QByteArray className, QString objectName)
+    InitRequest(QByteArray className, QString objectName, QByteArray revision = {})
         : className(std::move(className))
         , objectName(std::move(objectName))
+        , revision(std::move(revision))
     {
     }
 
     QByteArray className;
     QString objectName;
+    QByteArray revision;  ///< Revision of the state the requester has cached, if any (requires SyncRevisions)
 };
 
 struct InitData : public SignalProxyMessage
@@ -247,6 +267,8 @@ struct HeartBeat
     {
     }
 
+    inline Priority priority() const { return Priority::Control; }
+
     QDateTime timestamp;
 };
 
@@ -257,6 +279,8 @@ struct HeartBeatReply
     {
     }
 
+    inline Priority priority() const { return Priority::Control; }
+
     QDateTime timestamp;
 };
 
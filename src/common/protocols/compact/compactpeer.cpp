@@ -0,0 +1,673 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "compactpeer.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+
+#include "bufferinfo.h"
+#include "message.h"
+#include "quassel.h"
+#include "types.h"
+
+#include "serializers/serializers.h"
+
+using namespace QuasselProtocol;
+
+namespace {
+
+/// Type tags preceding each parameter
+enum class ParamType : quint8
+{
+    Invalid = 0,
+    False,
+    True,
+    Int,
+    UInt,
+    LongLong,
+    ULongLong,
+    String,
+    ByteArray,
+    StringList,
+    BufferId,
+    NetworkId,
+    IdentityId,
+    MsgId,
+    BufferInfo,
+    Message,
+    VariantList,
+    VariantMap,
+    Variant  ///< Any other type, serialized like in the DataStream protocol
+};
+
+/// Name references; values from NameReference onwards refer to interned name (value - NameReference)
+enum NameRef : quint8
+{
+    NameDefinition = 0,  ///< The name follows, and is interned with the next free ID
+    NameLiteral,         ///< The name follows, without being interned
+    NameReference
+};
+
+/// Limit for nested lists and maps, protecting the stack from malicious peers
+constexpr int maxNestingDepth{32};
+
+void writeVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+void writeSigned(QByteArray& out, qint64 value)
+{
+    // Zigzag encoding, so small negative values (like invalid IDs) stay short
+    writeVarint(out, (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63));
+}
+
+void writeBytes(QByteArray& out, const QByteArray& bytes)
+{
+    // The length is offset by one, so null values survive the round trip
+    if (bytes.isNull()) {
+        writeVarint(out, 0);
+        return;
+    }
+    writeVarint(out, static_cast<quint64>(bytes.size()) + 1);
+    out.append(bytes);
+}
+
+void writeString(QByteArray& out, const QString& string)
+{
+    if (string.isNull()) {
+        writeVarint(out, 0);
+        return;
+    }
+    QByteArray utf8 = string.toUtf8();
+    writeVarint(out, static_cast<quint64>(utf8.size()) + 1);
+    out.append(utf8);
+}
+
+void writeBufferInfo(QByteArray& out, const BufferInfo& info)
+{
+    writeSigned(out, info.bufferId().toInt());
+    writeSigned(out, info.networkId().toInt());
+    writeVarint(out, info.type());
+    writeVarint(out, info.groupId());
+    writeString(out, info.bufferName());
+}
+
+void writeIrcMessage(QByteArray& out, const Message& msg)
+{
+    writeSigned(out, msg.msgId().toQint64());
+    writeSigned(out, msg.timestamp().toMSecsSinceEpoch());
+    writeVarint(out, msg.type());
+    writeVarint(out, static_cast<quint32>(msg.flags()));
+    writeBufferInfo(out, msg.bufferInfo());
+    writeString(out, msg.sender());
+    writeString(out, msg.senderPrefixes());
+    writeString(out, msg.realName());
+    writeString(out, msg.avatarUrl());
+    writeString(out, msg.contents());
+}
+
+void writeParam(QByteArray& out, const QVariant& value)
+{
+    auto writeType = [&out](ParamType type) { out.append(static_cast<char>(type)); };
+
+    switch (value.userType()) {
+    case QMetaType::UnknownType:
+        writeType(ParamType::Invalid);
+        return;
+    case QMetaType::Bool:
+        writeType(value.toBool() ? ParamType::True : ParamType::False);
+        return;
+    case QMetaType::Int:
+        writeType(ParamType::Int);
+        writeSigned(out, value.toInt());
+        return;
+    case QMetaType::UInt:
+        writeType(ParamType::UInt);
+        writeVarint(out, value.toUInt());
+        return;
+    case QMetaType::LongLong:
+        writeType(ParamType::LongLong);
+        writeSigned(out, value.toLongLong());
+        return;
+    case QMetaType::ULongLong:
+        writeType(ParamType::ULongLong);
+        writeVarint(out, value.toULongLong());
+        return;
+    case QMetaType::QString:
+        writeType(ParamType::String);
+        writeString(out, value.toString());
+        return;
+    case QMetaType::QByteArray:
+        writeType(ParamType::ByteArray);
+        writeBytes(out, value.toByteArray());
+        return;
+    case QMetaType::QStringList: {
+        const QStringList list = value.toStringList();
+        writeType(ParamType::StringList);
+        writeVarint(out, list.size());
+        for (const QString& string : list)
+            writeString(out, string);
+        return;
+    }
+    case QMetaType::QVariantList: {
+        const QVariantList list = value.toList();
+        writeType(ParamType::VariantList);
+        writeVarint(out, list.size());
+        for (const QVariant& item : list)
+            writeParam(out, item);
+        return;
+    }
+    case QMetaType::QVariantMap: {
+        const QVariantMap map = value.toMap();
+        writeType(ParamType::VariantMap);
+        writeVarint(out, map.size());
+        for (auto it = map.cbegin(); it != map.cend(); ++it) {
+            writeString(out, it.key());
+            writeParam(out, it.value());
+        }
+        return;
+    }
+    default:
+        break;
+    }
+
+    int type = value.userType();
+    if (type == qMetaTypeId<::BufferId>()) {
+        writeType(ParamType::BufferId);
+        writeSigned(out, value.value<::BufferId>().toInt());
+    }
+    else if (type == qMetaTypeId<::NetworkId>()) {
+        writeType(ParamType::NetworkId);
+        writeSigned(out, value.value<::NetworkId>().toInt());
+    }
+    else if (type == qMetaTypeId<::IdentityId>()) {
+        writeType(ParamType::IdentityId);
+        writeSigned(out, value.value<::IdentityId>().toInt());
+    }
+    else if (type == qMetaTypeId<::MsgId>()) {
+        writeType(ParamType::MsgId);
+        writeSigned(out, value.value<::MsgId>().toQint64());
+    }
+    else if (type == qMetaTypeId<::BufferInfo>()) {
+        writeType(ParamType::BufferInfo);
+        writeBufferInfo(out, value.value<::BufferInfo>());
+    }
+    else if (type == qMetaTypeId<::Message>()) {
+        writeType(ParamType::Message);
+        writeIrcMessage(out, value.value<::Message>());
+    }
+    else {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_4_2);
+        stream << value;
+        writeType(ParamType::Variant);
+        writeBytes(out, data);
+    }
+}
+
+void writeLiteralName(QByteArray& out, const QByteArray& name)
+{
+    writeVarint(out, NameLiteral);
+    writeBytes(out, name);
+}
+
+void writeParams(QByteArray& out, const QVariantList& params)
+{
+    writeVarint(out, params.size());
+    for (const QVariant& param : params)
+        writeParam(out, param);
+}
+
+}  // namespace
+
+/**
+ * Decodes compact frames.
+ *
+ * All methods return false if the data is truncated or invalid, in which case the reader's state is undefined.
+ */
+class CompactPeer::Reader
+{
+public:
+    Reader(const QByteArray& data, Quassel::Features features)
+        : _pos{data.constData()}
+        , _end{data.constData() + data.size()}
+        , _features{std::move(features)}
+    {
+    }
+
+    bool atEnd() const { return _pos == _end; }
+
+    /// @returns The data that hasn't been read yet
+    QByteArrayView remaining() const { return QByteArrayView{_pos, _end}; }
+
+    bool readByte(quint8& value)
+    {
+        if (_pos == _end)
+            return false;
+        value = static_cast<quint8>(*_pos++);
+        return true;
+    }
+
+    bool readVarint(quint64& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            quint8 byte;
+            if (!readByte(byte))
+                return false;
+            value |= static_cast<quint64>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    bool readSigned(qint64& value)
+    {
+        quint64 raw;
+        if (!readVarint(raw))
+            return false;
+        value = static_cast<qint64>(raw >> 1) ^ -static_cast<qint64>(raw & 1);
+        return true;
+    }
+
+    bool readBytes(QByteArray& value)
+    {
+        quint64 size;
+        if (!readLength(size))
+            return false;
+        value = size ? QByteArray{_pos, static_cast<int>(size - 1)} : QByteArray{};
+        _pos += size ? size - 1 : 0;
+        return true;
+    }
+
+    bool readString(QString& value)
+    {
+        quint64 size;
+        if (!readLength(size))
+            return false;
+        value = size ? QString::fromUtf8(_pos, static_cast<int>(size - 1)) : QString{};
+        _pos += size ? size - 1 : 0;
+        return true;
+    }
+
+    bool readParams(QVariantList& params, int depth = 0)
+    {
+        quint64 count;
+        // Every parameter takes at least one byte
+        if (!readVarint(count) || count > static_cast<quint64>(_end - _pos))
+            return false;
+        params.reserve(static_cast<int>(count));
+        for (quint64 i = 0; i < count; ++i) {
+            QVariant param;
+            if (!readParam(param, depth))
+                return false;
+            params << std::move(param);
+        }
+        return true;
+    }
+
+private:
+    /// Reads a length prefix as written by writeBytes() and writeString(), checking it against the remaining data
+    bool readLength(quint64& size) { return readVarint(size) && (size == 0 || size - 1 <= static_cast<quint64>(_end - _pos)); }
+
+    template<typename Id>
+    bool readId(QVariant& value)
+    {
+        qint64 id;
+        if (!readSigned(id))
+            return false;
+        value = QVariant::fromValue(Id(static_cast<int>(id)));
+        return true;
+    }
+
+    bool readBufferInfo(BufferInfo& info)
+    {
+        qint64 bufferId, networkId;
+        quint64 type, groupId;
+        QString name;
+        if (!readSigned(bufferId) || !readSigned(networkId) || !readVarint(type) || !readVarint(groupId) || !readString(name))
+            return false;
+        info = BufferInfo{static_cast<int>(bufferId),
+                          static_cast<int>(networkId),
+                          static_cast<BufferInfo::Type>(type),
+                          static_cast<uint>(groupId),
+                          std::move(name)};
+        return true;
+    }
+
+    bool readMessage(Message& msg)
+    {
+        qint64 msgId, timestamp;
+        quint64 type, flags;
+        BufferInfo bufferInfo;
+        QString sender, senderPrefixes, realName, avatarUrl, contents;
+        if (!readSigned(msgId) || !readSigned(timestamp) || !readVarint(type) || !readVarint(flags) || !readBufferInfo(bufferInfo)
+            || !readString(sender) || !readString(senderPrefixes) || !readString(realName) || !readString(avatarUrl)
+            || !readString(contents))
+            return false;
+        msg = Message{QDateTime::fromMSecsSinceEpoch(timestamp),
+                      std::move(bufferInfo),
+                      static_cast<Message::Type>(type),
+                      std::move(contents),
+                      std::move(sender),
+                      std::move(senderPrefixes),
+                      std::move(realName),
+                      std::move(avatarUrl),
+                      Message::Flags(static_cast<int>(flags))};
+        msg.setMsgId(msgId);
+        return true;
+    }
+
+    bool readParam(QVariant& value, int depth)
+    {
+        quint8 type;
+        if (!readByte(type))
+            return false;
+
+        switch (static_cast<ParamType>(type)) {
+        case ParamType::Invalid:
+            value = QVariant{};
+            return true;
+        case ParamType::False:
+        case ParamType::True:
+            value = static_cast<ParamType>(type) == ParamType::True;
+            return true;
+        case ParamType::Int: {
+            qint64 number;
+            if (!readSigned(number))
+                return false;
+            value = static_cast<int>(number);
+            return true;
+        }
+        case ParamType::UInt: {
+            quint64 number;
+            if (!readVarint(number))
+                return false;
+            value = static_cast<uint>(number);
+            return true;
+        }
+        case ParamType::LongLong: {
+            qint64 number;
+            if (!readSigned(number))
+                return false;
+            value = static_cast<qlonglong>(number);
+            return true;
+        }
+        case ParamType::ULongLong: {
+            quint64 number;
+            if (!readVarint(number))
+                return false;
+            value = static_cast<qulonglong>(number);
+            return true;
+        }
+        case ParamType::String: {
+            QString string;
+            if (!readString(string))
+                return false;
+            value = std::move(string);
+            return true;
+        }
+        case ParamType::ByteArray: {
+            QByteArray bytes;
+            if (!readBytes(bytes))
+                return false;
+            value = std::move(bytes);
+            return true;
+        }
+        case ParamType::StringList: {
+            quint64 count;
+            if (!readVarint(count) || count > static_cast<quint64>(_end - _pos))
+                return false;
+            QStringList list;
+            list.reserve(static_cast<int>(count));
+            for (quint64 i = 0; i < count; ++i) {
+                QString string;
+                if (!readString(string))
+                    return false;
+                list << std::move(string);
+            }
+            value = std::move(list);
+            return true;
+        }
+        case ParamType::BufferId:
+            return readId<::BufferId>(value);
+        case ParamType::NetworkId:
+            return readId<::NetworkId>(value);
+        case ParamType::IdentityId:
+            return readId<::IdentityId>(value);
+        case ParamType::MsgId: {
+            qint64 id;
+            if (!readSigned(id))
+                return false;
+            value = QVariant::fromValue(::MsgId{id});
+            return true;
+        }
+        case ParamType::BufferInfo: {
+            ::BufferInfo info;
+            if (!readBufferInfo(info))
+                return false;
+            value = QVariant::fromValue(info);
+            return true;
+        }
+        case ParamType::Message: {
+            ::Message msg;
+            if (!readMessage(msg))
+                return false;
+            value = QVariant::fromValue(msg);
+            return true;
+        }
+        case ParamType::VariantList: {
+            QVariantList list;
+            if (depth >= maxNestingDepth || !readParams(list, depth + 1))
+                return false;
+            value = std::move(list);
+            return true;
+        }
+        case ParamType::VariantMap: {
+            quint64 count;
+            if (depth >= maxNestingDepth || !readVarint(count) || count > static_cast<quint64>(_end - _pos))
+                return false;
+            QVariantMap map;
+            for (quint64 i = 0; i < count; ++i) {
+                QString key;
+                QVariant item;
+                if (!readString(key) || !readParam(item, depth + 1))
+                    return false;
+                map.insert(key, item);
+            }
+            value = std::move(map);
+            return true;
+        }
+        case ParamType::Variant: {
+            QByteArray data;
+            if (!readBytes(data))
+                return false;
+            QDataStream stream(data);
+            stream.setVersion(QDataStream::Qt_4_2);
+            return Serializers::deserialize(stream, _features, value) && stream.atEnd();
+        }
+        }
+        return false;
+    }
+
+private:
+    const char* _pos;
+    const char* _end;
+    Quassel::Features _features;
+};
+
+CompactPeer::CompactPeer(::AuthHandler* authHandler,
+                         QTcpSocket* socket,
+                         quint16 features,
+                         Compressor::CompressionLevel level,
+                         Compressor::Algorithm algorithm,
+                         QObject* parent)
+    : DataStreamPeer(authHandler, socket, features, level, algorithm, parent)
+{
+}
+
+quint16 CompactPeer::supportedFeatures()
+{
+    return 0;
+}
+
+bool CompactPeer::acceptsFeatures(quint16 peerFeatures)
+{
+    Q_UNUSED(peerFeatures);
+    return true;
+}
+
+void CompactPeer::processMessage(const QByteArray& msg)
+{
+    // DataStream frames start with the most significant byte of the list size, which never matches a frame type
+    quint8 frameType = msg.isEmpty() ? 0 : static_cast<quint8>(msg.at(0));
+    if (signalProxy() && (frameType == SyncFrame || frameType == RpcFrame))
+        handleCompactMessage(msg);
+    else
+        DataStreamPeer::processMessage(msg);
+}
+
+void CompactPeer::handleCompactMessage(const QByteArray& msg)
+{
+    Reader in{msg, features()};
+    quint8 frameType;
+    in.readByte(frameType);
+
+    bool valid = false;
+    if (frameType == SyncFrame) {
+        QByteArray className, objectName, slotName;
+        QVariantList params;
+        valid = readName(in, className) && readName(in, objectName) && readName(in, slotName) && in.readParams(params) && in.atEnd();
+        if (valid)
+            handle(QuasselProtocol::SyncMessage(className, QString::fromUtf8(objectName), slotName, std::move(params)));
+    }
+    else {
+        QByteArray signalName;
+        QVariantList params;
+        valid = readName(in, signalName) && in.readParams(params) && in.atEnd();
+        if (valid)
+            handle(QuasselProtocol::RpcCall(signalName, std::move(params)));
+    }
+
+    if (!valid)
+        close("Peer sent corrupt data, closing down!");
+}
+
+void CompactPeer::writeName(QByteArray& out, const QByteArray& name, Priority priority)
+{
+    auto it = _sentNames.constFind(name);
+    if (it != _sentNames.cend()) {
+        writeVarint(out, NameReference + static_cast<quint64>(*it));
+        return;
+    }
+
+    // Names are assigned consecutive IDs on both ends, so definitions don't need to carry the ID.
+    // Bulk frames may be overtaken by later frames, so they must not define names others could refer to.
+    if (priority != Priority::Bulk && _sentNames.size() < maxInternedNames) {
+        _sentNames.insert(name, _sentNames.size());
+        writeVarint(out, NameDefinition);
+    }
+    else {
+        writeVarint(out, NameLiteral);
+    }
+    writeBytes(out, name);
+}
+
+bool CompactPeer::readName(Reader& in, QByteArray& name)
+{
+    quint64 ref;
+    if (!in.readVarint(ref))
+        return false;
+
+    if (ref >= NameReference) {
+        ref -= NameReference;
+        if (ref >= static_cast<quint64>(_receivedNames.size()))
+            return false;
+        name = _receivedNames[static_cast<int>(ref)];
+        return true;
+    }
+
+    if (!in.readBytes(name))
+        return false;
+    if (ref == NameDefinition) {
+        if (_receivedNames.size() >= maxInternedNames)
+            return false;
+        _receivedNames.append(name);
+    }
+    return true;
+}
+
+QByteArray CompactPeer::encode(const QuasselProtocol::SyncMessage& msg) const
+{
+    QByteArray frame;
+    frame.append(static_cast<char>(SyncFrame));
+    writeLiteralName(frame, msg.className);
+    writeLiteralName(frame, msg.objectName.toUtf8());
+    writeLiteralName(frame, msg.slotName);
+    writeParams(frame, msg.params);
+    return frame;
+}
+
+QByteArray CompactPeer::encode(const QuasselProtocol::RpcCall& msg) const
+{
+    QByteArray frame;
+    frame.append(static_cast<char>(RpcFrame));
+    writeLiteralName(frame, msg.signalName);
+    writeParams(frame, msg.params);
+    return frame;
+}
+
+void CompactPeer::dispatchEncoded(const QByteArray& msg, Priority priority)
+{
+    quint8 frameType = msg.isEmpty() ? 0 : static_cast<quint8>(msg.at(0));
+    if (frameType != SyncFrame && frameType != RpcFrame) {
+        DataStreamPeer::dispatchEncoded(msg, priority);
+        return;
+    }
+
+    // Only the names need to be rewritten, the parameters are copied over as they are
+    Reader in{msg, features()};
+    in.readByte(frameType);
+    QByteArray frame;
+    frame.append(static_cast<char>(frameType));
+    for (int i = frameType == SyncFrame ? 3 : 1; i > 0; --i) {
+        quint64 ref;
+        QByteArray name;
+        if (!in.readVarint(ref) || ref != NameLiteral || !in.readBytes(name)) {
+            qWarning() << Q_FUNC_INFO << "Received frame that wasn't encoded by encode(), dropping it!";
+            return;
+        }
+        writeName(frame, name, priority);
+    }
+    frame.append(in.remaining());
+    RemotePeer::writeMessage(frame, priority);
+}
+
+void CompactPeer::dispatch(const QuasselProtocol::SyncMessage& msg)
+{
+    QByteArray frame;
+    frame.append(static_cast<char>(SyncFrame));
+    writeName(frame, msg.className, msg.priority());
+    writeName(frame, msg.objectName.toUtf8(), msg.priority());
+    writeName(frame, msg.slotName, msg.priority());
+    writeParams(frame, msg.params);
+    RemotePeer::writeMessage(frame, msg.priority());
+}
+
+void CompactPeer::dispatch(const QuasselProtocol::RpcCall& msg)
+{
+    QByteArray frame;
+    frame.append(static_cast<char>(RpcFrame));
+    writeName(frame, msg.signalName, msg.priority());
+    writeParams(frame, msg.params);
+    RemotePeer::writeMessage(frame, msg.priority());
+}
@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <QHash>
+#include <QVector>
+
+#include "../datastream/datastreampeer.h"
+
+/**
+ * A variant of the DataStream protocol with a compact encoding for sync and RPC calls.
+ *
+ * Handshake, InitRequest, InitData and heartbeats are exchanged exactly like in the DataStream protocol.
+ * SyncMessages and RpcCalls, which make up most of the traffic of a running session, are written in a
+ * compact format instead:
+ *  - Class, object, slot and signal names are interned: they are sent once per connection, and referred to
+ *    by a numeric ID afterwards.
+ *  - Parameters are encoded according to their type, using variable-length integers, UTF-8 strings and
+ *    field-wise encoding for Message and BufferInfo. Types without a compact encoding fall back to the
+ *    DataStream serialization.
+ *
+ * Compact frames start with a tag byte that can't occur at the start of a DataStream frame, so both kinds
+ * of frames can be mixed on the same connection.
+ */
+class CompactPeer : public DataStreamPeer
+{
+    Q_OBJECT
+
+public:
+    CompactPeer(AuthHandler* authHandler,
+                QTcpSocket* socket,
+                quint16 features,
+                Compressor::CompressionLevel level,
+                Compressor::Algorithm algorithm,
+                QObject* parent = nullptr);
+
+    QuasselProtocol::Type protocol() const override { return QuasselProtocol::CompactProtocol; }
+    QString protocolName() const override { return "the Compact protocol"; }
+
+    static quint16 supportedFeatures();
+    static bool acceptsFeatures(quint16 peerFeatures);
+
+    void dispatch(const QuasselProtocol::SyncMessage& msg) override;
+    void dispatch(const QuasselProtocol::RpcCall& msg) override;
+
+    // Shared frames carry their names literally, dispatchEncoded() replaces them with the names interned for this connection
+    QByteArray encode(const QuasselProtocol::SyncMessage& msg) const override;
+    QByteArray encode(const QuasselProtocol::RpcCall& msg) const override;
+    void dispatchEncoded(const QByteArray& msg, QuasselProtocol::Priority priority) override;
+
+    using DataStreamPeer::dispatch;
+    using DataStreamPeer::dispatchEncoded;
+
+protected:
+    void processMessage(const QByteArray& msg) override;
+
+private:
+    class Reader;
+
+    /// Tags identifying compact frames
+    enum FrameType : quint8
+    {
+        SyncFrame = 0xc1,
+        RpcFrame = 0xc2
+    };
+
+    /// Maximum number of names interned per connection and direction
+    static constexpr int maxInternedNames{8192};
+
+    void writeName(QByteArray& out, const QByteArray& name, QuasselProtocol::Priority priority);
+    bool readName(Reader& in, QByteArray& name);
+
+    void handleCompactMessage(const QByteArray& msg);
+
+    QHash<QByteArray, quint32> _sentNames;
+    QVector<QByteArray> _receivedNames;
+};
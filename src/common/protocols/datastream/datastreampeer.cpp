@@ -14,9 +14,13 @@
 
 using namespace QuasselProtocol;
 
-DataStreamPeer::DataStreamPeer(
-    ::AuthHandler* authHandler, QTcpSocket* socket, quint16 features, Compressor::CompressionLevel level, QObject* parent)
-    : RemotePeer(authHandler, socket, level, parent)
+DataStreamPeer::DataStreamPeer(::AuthHandler* authHandler,
+                               QTcpSocket* socket,
+                               quint16 features,
+                               Compressor::CompressionLevel level,
+                               Compressor::Algorithm algorithm,
+                               QObject* parent)
+    : RemotePeer(authHandler, socket, level, algorithm, parent)
 {
     Q_UNUSED(features);
 }
@@ -69,13 +73,17 @@ void DataStreamPeer::writeMessage(const QVariantMap& handshakeMsg)
 }
 
 void DataStreamPeer::writeMessage(const QVariantList& sigProxyMsg)
+{
+    writeMessage(serialize(sigProxyMsg));
+}
+
+QByteArray DataStreamPeer::serialize(const QVariantList& sigProxyMsg)
 {
     QByteArray data;
     QDataStream msgStream(&data, QIODevice::WriteOnly);
     msgStream.setVersion(QDataStream::Qt_4_2);
     msgStream << sigProxyMsg;
-
-    writeMessage(data);
+    return data;
 }
 
 /*** Handshake messages ***/
@@ -316,13 +324,14 @@ void DataStreamPeer::handlePackedFunc(const QVariantList& packedFunc)
         break;
     }
     case InitRequest: {
-        if (params.count() != 2) {
+        if (params.count() != 2 && params.count() != 3) {
             qWarning() << Q_FUNC_INFO << "Received invalid InitRequest:" << params;
             return;
         }
         QByteArray className = params[0].toByteArray();
         QString objectName = QString::fromUtf8(params[1].toByteArray());
-        handle(QuasselProtocol::InitRequest(className, objectName));
+        QByteArray revision = params.value(2).toByteArray();
+        handle(QuasselProtocol::InitRequest(className, objectName, revision));
         break;
     }
     case InitData: {
@@ -359,22 +368,36 @@ void DataStreamPeer::handlePackedFunc(const QVariantList& packedFunc)
     }
 }
 
-void DataStreamPeer::dispatch(const QuasselProtocol::SyncMessage& msg)
+QByteArray DataStreamPeer::encode(const QuasselProtocol::SyncMessage& msg) const
 {
-    dispatchPackedFunc(QVariantList() << (qint16)Sync << msg.className << msg.objectName.toUtf8() << msg.slotName << msg.params);
+    return serialize(QVariantList() << (qint16)Sync << msg.className << msg.objectName.toUtf8() << msg.slotName << msg.params);
 }
 
-void DataStreamPeer::dispatch(const QuasselProtocol::RpcCall& msg)
+QByteArray DataStreamPeer::encode(const QuasselProtocol::RpcCall& msg) const
 {
-    dispatchPackedFunc(QVariantList() << (qint16)RpcCall << msg.signalName << msg.params);
+    return serialize(QVariantList() << (qint16)RpcCall << msg.signalName << msg.params);
 }
 
-void DataStreamPeer::dispatch(const QuasselProtocol::InitRequest& msg)
+QByteArray DataStreamPeer::encode(const QuasselProtocol::InitRequest& msg) const
 {
-    dispatchPackedFunc(QVariantList() << (qint16)InitRequest << msg.className << msg.objectName.toUtf8());
+    QVariantList packedFunc = QVariantList() << (qint16)InitRequest << msg.className << msg.objectName.toUtf8();
+    if (!msg.revision.isEmpty() && hasFeature(Quassel::Feature::SyncRevisions))
+        packedFunc << msg.revision;
+    return serialize(packedFunc);
 }
 
-void DataStreamPeer::dispatch(const QuasselProtocol::InitData& msg)
+QByteArray DataStreamPeer::encode(const QuasselProtocol::InitData& msg) const
+{
+    return serializeInitData(msg);
+}
+
+std::function<QByteArray()> DataStreamPeer::concurrentEncoder(const QuasselProtocol::InitData& msg) const
+{
+    // Serializing InitData doesn't depend on the peer's state, so the peer may even be gone by the time this runs
+    return [msg]() { return serializeInitData(msg); };
+}
+
+QByteArray DataStreamPeer::serializeInitData(const QuasselProtocol::InitData& msg)
 {
     QVariantList initData;
     QVariantMap::const_iterator it = msg.initData.begin();
@@ -382,7 +405,27 @@ void DataStreamPeer::dispatch(const QuasselProtocol::InitData& msg)
         initData << it.key().toUtf8() << it.value();
         ++it;
     }
-    dispatchPackedFunc(QVariantList() << (qint16)InitData << msg.className << msg.objectName.toUtf8() << initData);
+    return serialize(QVariantList() << (qint16)InitData << msg.className << msg.objectName.toUtf8() << initData);
+}
+
+void DataStreamPeer::dispatch(const QuasselProtocol::SyncMessage& msg)
+{
+    writeMessage(encode(msg), msg.priority());
+}
+
+void DataStreamPeer::dispatch(const QuasselProtocol::RpcCall& msg)
+{
+    writeMessage(encode(msg), msg.priority());
+}
+
+void DataStreamPeer::dispatch(const QuasselProtocol::InitRequest& msg)
+{
+    writeMessage(encode(msg), msg.priority());
+}
+
+void DataStreamPeer::dispatch(const QuasselProtocol::InitData& msg)
+{
+    writeMessage(encode(msg), msg.priority());
 }
 
 void DataStreamPeer::dispatch(const QuasselProtocol::HeartBeat& msg)
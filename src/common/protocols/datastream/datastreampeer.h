@@ -23,7 +23,12 @@ public:
         HeartBeatReply
     };
 
-    DataStreamPeer(AuthHandler* authHandler, QTcpSocket* socket, quint16 features, Compressor::CompressionLevel level, QObject* parent = nullptr);
+    DataStreamPeer(AuthHandler* authHandler,
+                   QTcpSocket* socket,
+                   quint16 features,
+                   Compressor::CompressionLevel level,
+                   Compressor::Algorithm algorithm,
+                   QObject* parent = nullptr);
 
     QuasselProtocol::Type protocol() const override { return QuasselProtocol::DataStreamProtocol; }
     QString protocolName() const override { return "the DataStream protocol"; }
@@ -51,14 +56,24 @@ public:
     void dispatch(const QuasselProtocol::HeartBeat& msg) override;
     void dispatch(const QuasselProtocol::HeartBeatReply& msg) override;
 
+    QByteArray encode(const QuasselProtocol::SyncMessage& msg) const override;
+    QByteArray encode(const QuasselProtocol::RpcCall& msg) const override;
+    QByteArray encode(const QuasselProtocol::InitRequest& msg) const override;
+    QByteArray encode(const QuasselProtocol::InitData& msg) const override;
+    std::function<QByteArray()> concurrentEncoder(const QuasselProtocol::InitData& msg) const override;
+
 signals:
     void protocolError(const QString& errorString);
 
+protected:
+    void processMessage(const QByteArray& msg) override;
+
 private:
     using RemotePeer::writeMessage;
     void writeMessage(const QVariantMap& handshakeMsg);
     void writeMessage(const QVariantList& sigProxyMsg);
-    void processMessage(const QByteArray& msg) override;
+    static QByteArray serialize(const QVariantList& sigProxyMsg);
+    static QByteArray serializeInitData(const QuasselProtocol::InitData& msg);
 
     void handleHandshakeMessage(const QVariantList& mapData);
     void handlePackedFunc(const QVariantList& packedFunc);
@@ -18,8 +18,9 @@ const uint clientNeedsProtocol = protocolVersion;
 
 using namespace QuasselProtocol;
 
-LegacyPeer::LegacyPeer(::AuthHandler* authHandler, QTcpSocket* socket, Compressor::CompressionLevel level, QObject* parent)
-    : RemotePeer(authHandler, socket, level, parent)
+LegacyPeer::LegacyPeer(
+    ::AuthHandler* authHandler, QTcpSocket* socket, Compressor::CompressionLevel level, Compressor::Algorithm algorithm, QObject* parent)
+    : RemotePeer(authHandler, socket, level, algorithm, parent)
     , _useCompression(false)
 {
 }
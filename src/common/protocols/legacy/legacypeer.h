@@ -21,7 +21,11 @@ public:
         HeartBeatReply
     };
 
-    LegacyPeer(AuthHandler* authHandler, QTcpSocket* socket, Compressor::CompressionLevel level, QObject* parent = nullptr);
+    LegacyPeer(AuthHandler* authHandler,
+               QTcpSocket* socket,
+               Compressor::CompressionLevel level,
+               Compressor::Algorithm algorithm,
+               QObject* parent = nullptr);
 
     QuasselProtocol::Type protocol() const override { return QuasselProtocol::LegacyProtocol; }
     QString protocolName() const override { return "the legacy protocol"; }
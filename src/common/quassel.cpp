@@ -344,6 +344,10 @@ void Quassel::setupCliParser()
                     {"change-userpass",
                      tr("Starts an interactive session to change the password of the user identified by <username>."),
                      tr("username")},
+                    {"compact-storage",
+                     tr("Prepares the storage backend to return space freed by backlog retention to the operating system, then "
+                        "exits. Only needed once for SQLite databases created by older versions; rewrites the whole database and "
+                        "needs as much free disk space as it takes.")},
                     {"strict-ident", tr("Use users' quasselcore username as ident reply. Ignores each user's configured ident setting.")},
                     {"ident-daemon", tr("Enable internal ident daemon.")},
                     {"ident-port",
@@ -360,6 +364,23 @@ void Quassel::setupCliParser()
                     {"require-ssl", tr("Require SSL for remote (non-loopback) client connections.")},
                     {"ssl-cert", tr("Specify the path to the SSL certificate."), tr("path"), "configdir/quasselCert.pem"},
                     {"ssl-key", tr("Specify the path to the SSL key."), tr("path"), "ssl-cert-path"},
+                    {"storage-commit-latency",
+                     tr("Time in milliseconds new messages may be held back so they can be stored together with those of other "
+                        "sessions. Use 0 to store them right away."),
+                     tr("ms"),
+                     "10"},
+                    {"backlog-max-age",
+                     tr("Delete messages older than this many days from the backlog. Users can override this; 0 keeps them forever."),
+                     tr("days"),
+                     "0"},
+                    {"backlog-max-rows",
+                     tr("Keep at most this many messages per buffer in the backlog. Users can override this; 0 means unlimited."),
+                     tr("count"),
+                     "0"},
+                    {"backlog-retention-interval", tr("Time in minutes between runs of the backlog retention job."), tr("minutes"), "60"},
+                    {"backlog-compression",
+                     tr("Store message texts compressed in the backlog. Existing messages are compressed in the background. Only "
+                        "supported by the SQLite backend.")},
                     {"metrics-daemon", tr("Enable metrics API.")},
                     {"metrics-port",
                      tr("The port quasselcore will listen at for metrics requests. Only meaningful with --metrics-daemon."),
@@ -709,3 +730,8 @@ QStringList Quassel::Features::unknownFeatures() const
 {
     return _unknownFeatures;
 }
+
+bool Quassel::Features::operator==(const Features& other) const
+{
+    return _features == other._features;
+}
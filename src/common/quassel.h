@@ -128,6 +128,11 @@ public:
         SyncedCoreInfo,       ///< CoreInfo dynamically updated using signals
         LoadBacklogForwards,  ///< Allow loading backlog in ascending order, old to new
         SkipIrcCaps,          ///< Control what IRCv3 capabilities are skipped during negotiation
+        BacklogSearch,        ///< BacklogManager supports indexed full-text search of the backlog
+        BacklogStreaming,     ///< BacklogManager can deliver backlog in bounded chunks
+        BatchedMessages,      ///< New messages are sent in batches via displayMsgs()
+        SyncRevisions,        ///< InitData of objects unchanged since the client last received it can be skipped
+        LazyChannelMembers,   ///< Channel members are only synced for channels the client requests them for
     };
     Q_ENUM(Feature)
 
@@ -318,6 +323,15 @@ public:
      */
     QStringList unknownFeatures() const;
 
+    /**
+     * Compares the enabled features of two Features instances.
+     *
+     * @note Unknown features are not considered, since they don't have any effect.
+     * @returns Whether both instances have the same set of features enabled
+     */
+    bool operator==(const Features& other) const;
+    bool operator!=(const Features& other) const { return !(*this == other); }
+
 private:
     std::vector<bool> _features;
     QStringList _unknownFeatures;
@@ -18,10 +18,11 @@ using namespace QuasselProtocol;
 const quint32 maxMessageSize = 64 * 1024
                                * 1024;  // This is uncompressed size. 64 MB should be enough for any sort of initData or backlog chunk
 
-RemotePeer::RemotePeer(::AuthHandler* authHandler, QTcpSocket* socket, Compressor::CompressionLevel level, QObject* parent)
+RemotePeer::RemotePeer(
+    ::AuthHandler* authHandler, QTcpSocket* socket, Compressor::CompressionLevel level, Compressor::Algorithm algorithm, QObject* parent)
     : Peer(authHandler, parent)
     , _socket(socket)
-    , _compressor(new Compressor(socket, level, this))
+    , _compressor(new Compressor(socket, level, algorithm, this))
     , _signalProxy(nullptr)
     , _proxyLine({})
     , _useProxyLine(false)
@@ -34,16 +35,19 @@ RemotePeer::RemotePeer(::AuthHandler* authHandler, QTcpSocket* socket, Compresso
     connect(socket, &QAbstractSocket::stateChanged, this, &RemotePeer::onSocketStateChanged);
     connect(socket, &QAbstractSocket::errorOccurred, this, &RemotePeer::onSocketError);
     connect(socket, &QAbstractSocket::disconnected, this, &Peer::disconnected);
+    connect(socket, &QIODevice::bytesWritten, this, &RemotePeer::onBytesWritten);
 
     auto* sslSocket = qobject_cast<QSslSocket*>(socket);
     if (sslSocket) {
         connect(sslSocket, &QSslSocket::encrypted, this, [this]() { emit secureStateChanged(true); });
+        connect(sslSocket, &QSslSocket::encryptedBytesWritten, this, &RemotePeer::onBytesWritten);
     }
 
     connect(_compressor, &Compressor::readyRead, this, &RemotePeer::onReadyRead);
     connect(_compressor, &Compressor::error, this, &RemotePeer::onCompressionError);
 
     connect(_heartBeatTimer, &QTimer::timeout, this, &RemotePeer::sendHeartBeat);
+    connect(&_encodeWatcher, &QFutureWatcherBase::finished, this, &RemotePeer::writePendingMessages);
 }
 
 void RemotePeer::onSocketStateChanged(QAbstractSocket::SocketState state)
@@ -225,9 +229,9 @@ bool RemotePeer::readMessage(QByteArray& msg)
 
     emit transferProgress(_msgSize, _msgSize);
 
-    msg.resize(_msgSize);
-    qint64 bytesRead = _compressor->read(msg.data(), _msgSize);
-    if (bytesRead != _msgSize) {
+    // Hand out the frame without copying it; it is processed right away in onReadyRead()
+    msg = _compressor->readView(_msgSize);
+    if (msg.size() != _msgSize) {
         close("Premature end of data stream!");
         return false;
     }
@@ -236,13 +240,105 @@ bool RemotePeer::readMessage(QByteArray& msg)
     return true;
 }
 
-void RemotePeer::writeMessage(const QByteArray& msg)
+void RemotePeer::writeMessage(const QByteArray& msg, Priority priority)
+{
+    if (!_pendingMessages.empty()) {
+        _pendingMessages.push_back({msg, priority, false, {}});
+        return;
+    }
+
+    writeOrQueueMessage(msg, priority);
+}
+
+void RemotePeer::writeOrQueueMessage(const QByteArray& msg, Priority priority)
+{
+    if (priority == Priority::Bulk && (!_bulkQueue.empty() || pendingBytes() > sendHighWaterMark)) {
+        if (_bulkQueueSize + msg.size() > maxQueuedBytes) {
+            _bulkQueue.clear();
+            _bulkQueueSize = 0;
+            emit sendQueueChanged(_bulkQueueSize);
+            close("Peer is not reading the data sent to it!");
+            return;
+        }
+        _bulkQueue.push_back(msg);
+        _bulkQueueSize += msg.size();
+        emit sendQueueChanged(_bulkQueueSize);
+        return;
+    }
+
+    writeFrame(msg);
+}
+
+void RemotePeer::writeFrame(const QByteArray& msg)
 {
     auto size = qToBigEndian<quint32>(msg.size());
     _compressor->write((const char*)&size, 4, Compressor::NoFlush);
     _compressor->write(msg.constData(), msg.size());
 }
 
+void RemotePeer::dispatchEncoded(const QByteArray& msg, Priority priority)
+{
+    writeMessage(msg, priority);
+}
+
+void RemotePeer::dispatchEncoded(QFuture<QByteArray> msg, Priority priority)
+{
+    _pendingMessages.push_back({{}, priority, true, std::move(msg)});
+    if (_pendingMessages.size() == 1)
+        writePendingMessages();
+}
+
+void RemotePeer::writePendingMessages()
+{
+    while (!_pendingMessages.empty()) {
+        PendingMessage& pending = _pendingMessages.front();
+        if (pending.encoding) {
+            if (!pending.future.isFinished()) {
+                _encodeWatcher.setFuture(pending.future);
+                return;
+            }
+            pending.msg = pending.future.result();
+        }
+        QByteArray msg = std::move(pending.msg);
+        Priority priority = pending.priority;
+        _pendingMessages.pop_front();
+        writeOrQueueMessage(msg, priority);
+    }
+}
+
+qint64 RemotePeer::queuedBytes() const
+{
+    return _bulkQueueSize;
+}
+
+qint64 RemotePeer::pendingBytes() const
+{
+    auto* sslSocket = qobject_cast<QSslSocket*>(socket());
+    return socket()->bytesToWrite() + (sslSocket ? sslSocket->encryptedBytesToWrite() : 0);
+}
+
+void RemotePeer::onBytesWritten()
+{
+    if (_bulkQueue.empty() || pendingBytes() > sendLowWaterMark)
+        return;
+
+    while (!_bulkQueue.empty() && pendingBytes() <= sendHighWaterMark) {
+        QByteArray msg = std::move(_bulkQueue.front());
+        _bulkQueue.pop_front();
+        _bulkQueueSize -= msg.size();
+        writeFrame(msg);
+    }
+    emit sendQueueChanged(_bulkQueueSize);
+}
+
+bool RemotePeer::encodesLike(const Peer* other) const
+{
+    // Serialization of some types depends on the negotiated features, so only identical peers can share frames
+    auto* remotePeer = qobject_cast<const RemotePeer*>(other);
+    return remotePeer && remotePeer->protocol() == protocol() && remotePeer->enabledFeatures() == enabledFeatures()
+           && remotePeer->features() == features();
+}
+
 void RemotePeer::handle(const HeartBeat& heartBeat)
 {
     dispatch(HeartBeatReply(heartBeat.timestamp));
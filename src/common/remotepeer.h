@@ -5,7 +5,10 @@
 
 #include "common-export.h"
 
+#include <deque>
+
 #include <QDateTime>
+#include <QFutureWatcher>
 
 #include "compressor.h"
 #include "peer.h"
@@ -26,7 +29,11 @@ public:
     using Peer::dispatch;
     using Peer::handle;
 
-    RemotePeer(AuthHandler* authHandler, QTcpSocket* socket, Compressor::CompressionLevel level, QObject* parent = nullptr);
+    RemotePeer(AuthHandler* authHandler,
+               QTcpSocket* socket,
+               Compressor::CompressionLevel level,
+               Compressor::Algorithm algorithm,
+               QObject* parent = nullptr);
 
     void setSignalProxy(SignalProxy* proxy) override;
 
@@ -46,11 +53,25 @@ public:
 
     int lag() const override;
 
+    void dispatchEncoded(const QByteArray& msg, QuasselProtocol::Priority priority) override;
+    void dispatchEncoded(QFuture<QByteArray> msg, QuasselProtocol::Priority priority) override;
+    bool encodesLike(const Peer* other) const override;
+
     bool compressionEnabled() const;
     void setCompressionEnabled(bool enabled);
 
     QTcpSocket* socket() const;
 
+    /// @returns The size of the bulk messages held back until the socket has caught up, in bytes
+    qint64 queuedBytes() const;
+
+    /// Bulk messages are held back while more than this many bytes are waiting in the socket...
+    static constexpr qint64 sendHighWaterMark{1024 * 1024};
+    /// ... and resumed once the socket got rid of most of them, so urgent messages don't get stuck behind bulk data
+    static constexpr qint64 sendLowWaterMark{256 * 1024};
+    /// Peers that let more bulk messages than this pile up are disconnected, rather than growing the queue without bounds
+    static constexpr qint64 maxQueuedBytes{256 * 1024 * 1024};
+
 public slots:
     void close(const QString& reason = QString()) override;
 
@@ -62,10 +83,21 @@ signals:
     // Only used by LegacyPeer
     void protocolVersionMismatch(int actual, int expected);
 
+    void sendQueueChanged(qint64 queuedBytes);
+
 protected:
     SignalProxy* signalProxy() const override;
 
-    void writeMessage(const QByteArray& msg);
+    /**
+     * Writes a message to the peer.
+     *
+     * Bulk messages are queued while the socket has too much data pending, so they don't delay more urgent ones.
+     *
+     * @param msg      The serialized message
+     * @param priority The message's priority class
+     */
+    void writeMessage(const QByteArray& msg, QuasselProtocol::Priority priority = QuasselProtocol::Priority::Realtime);
+    // msg refers to the receive buffer without owning it, so it must be fully deserialized before returning
     virtual void processMessage(const QByteArray& msg) = 0;
 
     // These protocol messages get handled internally and won't reach SignalProxy
@@ -81,12 +113,19 @@ protected slots:
 private slots:
     void onReadyRead();
     void onCompressionError(Compressor::Error error);
+    void onBytesWritten();
+    void writePendingMessages();
 
     void sendHeartBeat();
     void changeHeartBeatInterval(int secs);
 
 private:
     bool readMessage(QByteArray& msg);
+    void writeOrQueueMessage(const QByteArray& msg, QuasselProtocol::Priority priority);
+    void writeFrame(const QByteArray& msg);
+
+    /// @returns The number of bytes written to the socket, but not sent yet
+    qint64 pendingBytes() const;
 
 private:
     QTcpSocket* _socket;
@@ -98,4 +137,17 @@ private:
     int _heartBeatCount;
     int _lag;
     quint32 _msgSize;
+    std::deque<QByteArray> _bulkQueue;
+    qint64 _bulkQueueSize{0};
+
+    /// A message waiting for a preceding message that is still being encoded
+    struct PendingMessage
+    {
+        QByteArray msg;
+        QuasselProtocol::Priority priority;
+        bool encoding;               ///< Whether the message itself is still being encoded
+        QFuture<QByteArray> future;  ///< The message, if it is still being encoded
+    };
+    std::deque<PendingMessage> _pendingMessages;
+    QFutureWatcher<QByteArray> _encodeWatcher;
 };
@@ -4,15 +4,20 @@
 #include "signalproxy.h"
 
 #include <algorithm>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include <QCoreApplication>
 #include <QHostAddress>
 #include <QMetaMethod>
 #include <QMetaProperty>
+#include <QPromise>
 #include <QRegularExpression>
 #include <QSslSocket>
 #include <QThread>
+#include <QThreadPool>
+#include <QUuid>
 
 #include "peer.h"
 #include "protocol.h"
@@ -33,13 +38,24 @@ public:
     Peer* peer;
 };
 
+namespace {
+
+/// Time (in ms) during which coalescable sync calls are held back
+constexpr int coalesceWindow{100};
+
+}  // namespace
+
 // ==================================================
 //  SignalProxy
 // ==================================================
 
 namespace {
 thread_local SignalProxy* _current{nullptr};
-}
+
+// InitData entries for passing revisions along with an object's state
+constexpr char revisionKey[] = "__revision__";
+constexpr char unchangedKey[] = "__unchanged__";
+}  // namespace
 
 SignalProxy::SignalProxy(QObject* parent)
     : QObject(parent)
@@ -104,10 +120,16 @@ void SignalProxy::init()
     setMaxHeartBeatCount(2);
     _secure = false;
     _current = this;
+    _coalesceTimer.setSingleShot(true);
+    _coalesceTimer.setInterval(coalesceWindow);
+    connect(&_coalesceTimer, &QTimer::timeout, this, [this]() { flushCoalescedSyncs(); });
     updateSecureState();
 }
 
-void SignalProxy::initServer() {}
+void SignalProxy::initServer()
+{
+    _revisionEpoch = QUuid::createUuid().toByteArray(QUuid::WithoutBraces);
+}
 
 void SignalProxy::initClient()
 {
@@ -225,6 +247,9 @@ void SignalProxy::renameObject(const SyncableObject* obj, const QString& newname
     if (proxyMode() == Client)
         return;
 
+    // Pending calls still refer to the old name
+    flushCoalescedSyncs(obj);
+
     const QMetaObject* meta = obj->syncMetaObject();
     const QByteArray className(meta->className());
     objectRenamed(className, newname, oldname);
@@ -297,6 +322,8 @@ void SignalProxy::synchronize(SyncableObject* obj)
     _syncSlave[className][obj->objectName()] = obj;
 
     if (proxyMode() == Server) {
+        // Objects may be recreated under the same name, so they need to start out with a fresh revision
+        obj->bumpRevision(++_lastRevision);
         obj->setInitialized();
         emit objectInitialized(obj);
     }
@@ -322,6 +349,7 @@ void SignalProxy::stopSynchronize(SyncableObject* obj)
         }
         ++classIter;
     }
+    flushCoalescedSyncs(obj);
     obj->stopSynchronize(this);
 }
 
@@ -331,9 +359,7 @@ void SignalProxy::dispatchSignal(QByteArray sigName, QVariantList params)
     QByteArray normalizedSig = QMetaObject::normalizedSignature(sigName.constData());
     RpcCall rpcCall{normalizedSig, std::move(params)};
     if (_restrictMessageTarget) {
-        for (auto&& peer : _restrictedTargets) {
-            dispatch(peer, rpcCall);
-        }
+        dispatch(_restrictedTargets.values(), rpcCall);
     }
     else {
         dispatch(rpcCall);
@@ -343,8 +369,41 @@ void SignalProxy::dispatchSignal(QByteArray sigName, QVariantList params)
 template<class T>
 void SignalProxy::dispatch(const T& protoMessage)
 {
-    for (auto&& peer : _peerMap.values()) {
-        dispatch(peer, protoMessage);
+    dispatch(_peerMap.values(), protoMessage);
+}
+
+template<class T>
+void SignalProxy::dispatch(const QList<Peer*>& peers, const T& protoMessage)
+{
+    // Serializing a message is far more expensive than writing it, so encode it only once for each group of peers that
+    // would produce the same bytes. The encoded frames are implicitly shared, so peers just reference them.
+    std::vector<std::pair<Peer*, QByteArray>> encodings;
+    for (auto&& peer : peers) {
+        if (!peer || !peer->isOpen()) {
+            dispatch(peer, protoMessage);
+            continue;
+        }
+
+        auto it = std::find_if(encodings.cbegin(), encodings.cend(), [peer](auto&& encoding) {
+            return peer->encodesLike(encoding.first);
+        });
+        QByteArray data;
+        _targetPeer = peer;
+        if (it != encodings.cend()) {
+            data = it->second;
+        }
+        else {
+            // Serializers may depend on the target peer's features, so _targetPeer must be set while encoding
+            data = peer->encode(protoMessage);
+            if (!data.isEmpty())
+                encodings.emplace_back(peer, data);
+        }
+
+        if (!data.isEmpty())
+            peer->dispatchEncoded(data, protoMessage.priority());
+        else
+            peer->dispatch(protoMessage);
+        _targetPeer = nullptr;
     }
 }
 
@@ -438,10 +497,45 @@ void SignalProxy::handle(Peer* peer, const InitRequest& initRequest)
 
     SyncableObject* obj = _syncSlave[initRequest.className][initRequest.objectName];
     _targetPeer = peer;
-    peer->dispatch(InitData(initRequest.className, initRequest.objectName, initData(obj)));
+    if (peer->hasFeature(Quassel::Feature::SyncRevisions)) {
+        QByteArray currentRevision = revision(obj);
+        if (initRequest.revision == currentRevision && obj->allowsCachedInitData(peer)) {
+            // The peer has the current state cached already
+            QVariantMap unchanged{{revisionKey, currentRevision}, {unchangedKey, true}};
+            peer->dispatch(InitData(initRequest.className, initRequest.objectName, unchanged));
+        }
+        else {
+            QVariantMap properties = initData(obj);
+            properties[revisionKey] = currentRevision;
+            dispatchInitData(peer, obj, InitData(initRequest.className, initRequest.objectName, properties));
+        }
+    }
+    else {
+        dispatchInitData(peer, obj, InitData(initRequest.className, initRequest.objectName, initData(obj)));
+    }
     _targetPeer = nullptr;
 }
 
+void SignalProxy::dispatchInitData(Peer* peer, const SyncableObject* obj, const InitData& msg)
+{
+    // The InitData is a snapshot of the object's state, so serializing it doesn't need to block the session thread
+    std::function<QByteArray()> encoder;
+    if (obj->allowsConcurrentInitData())
+        encoder = peer->concurrentEncoder(msg);
+    if (!encoder) {
+        peer->dispatch(msg);
+        return;
+    }
+
+    auto promise = std::make_shared<QPromise<QByteArray>>();
+    peer->dispatchEncoded(promise->future(), msg.priority());
+    QThreadPool::globalInstance()->start([promise, encoder = std::move(encoder)]() {
+        promise->start();
+        promise->addResult(encoder());
+        promise->finish();
+    });
+}
+
 void SignalProxy::handle(Peer* peer, const InitData& initData)
 {
     Q_UNUSED(peer)
@@ -457,7 +551,25 @@ void SignalProxy::handle(Peer* peer, const InitData& initData)
     }
 
     SyncableObject* obj = _syncSlave[initData.className][initData.objectName];
-    setInitData(obj, initData.initData);
+    QVariantMap properties = initData.initData;
+    if (properties.contains(revisionKey)) {
+        QByteArray revision = properties.take(revisionKey).toByteArray();
+        if (properties.take(unchangedKey).toBool()) {
+            CachedInitData cached = _initDataCache.value(initData.className).value(initData.objectName);
+            if (cached.revision != revision) {
+                qWarning() << "SignalProxy::handleInitData() received unchanged revision for uncached Object:" << initData.className
+                           << initData.objectName;
+                _initDataCache[initData.className].remove(initData.objectName);
+                requestInit(obj);
+                return;
+            }
+            properties = cached.initData;
+        }
+        else if (_initDataCacheEnabled) {
+            _initDataCache[initData.className][initData.objectName] = {revision, properties};
+        }
+    }
+    setInitData(obj, properties);
 }
 
 bool SignalProxy::invokeSlot(QObject* receiver, int methodId, const QVariantList& params, QVariant& returnValue, Peer* peer)
@@ -530,7 +642,9 @@ void SignalProxy::requestInit(SyncableObject* obj)
     if (proxyMode() == Server || obj->isInitialized())
         return;
 
-    dispatch(InitRequest(obj->syncMetaObject()->className(), obj->objectName()));
+    QByteArray className = obj->syncMetaObject()->className();
+    QByteArray cachedRevision = _initDataCache.value(className).value(obj->objectName()).revision;
+    dispatch(InitRequest(className, obj->objectName(), cachedRevision));
 }
 
 QVariantMap SignalProxy::initData(SyncableObject* obj) const
@@ -543,6 +657,11 @@ QVariantMap SignalProxy::initData(SyncableObject* obj) const
     return initData;
 }
 
+QByteArray SignalProxy::revision(const SyncableObject* obj) const
+{
+    return _revisionEpoch + ':' + QByteArray::number(obj->revision());
+}
+
 void SignalProxy::setInitData(SyncableObject* obj, const QVariantMap& properties)
 {
     if (obj->isInitialized())
@@ -569,11 +688,19 @@ void SignalProxy::customEvent(QEvent* event)
     }
 }
 
-void SignalProxy::sync_call__(const SyncableObject* obj, SignalProxy::ProxyMode modeType, const char* funcname, va_list ap)
+void SignalProxy::sync_call__(const SyncableObject* obj, SignalProxy::ProxyMode modeType, const char* funcname, va_list ap, bool coalesce)
 {
     if (modeType != _proxyMode)
         return;
 
+    // Every change invalidates the state clients may have cached, whether or not any of them is connected right now
+    if (_proxyMode == Server)
+        const_cast<SyncableObject*>(obj)->bumpRevision(++_lastRevision);
+
+    // Don't bother marshalling the parameters if there is no one to send them to
+    if (!hasTargetPeers())
+        return;
+
     ExtendedMetaObject* eMeta = extendedMetaObject(obj);
 
     QVariantList params;
@@ -590,14 +717,80 @@ void SignalProxy::sync_call__(const SyncableObject* obj, SignalProxy::ProxyMode
         params << QVariant(QMetaType(argTypes[i]), va_arg(ap, const void*));
     }
 
+    SyncMessage syncMessage{eMeta->metaObject()->className(), obj->objectName(), QByteArray(funcname), std::move(params)};
+    // Calls sent to a restricted set of peers are not coalesced, as the set might differ when the window ends
+    if (coalesce && !_restrictMessageTarget) {
+        queueCoalescedSync(obj, std::move(syncMessage));
+        return;
+    }
+
+    // Keep the order of calls concerning the same object
+    flushCoalescedSyncs(obj);
+    QList<Peer*> peers;
     if (_restrictMessageTarget) {
-        for (auto peer : _restrictedTargets) {
-            if (peer != nullptr)
-                dispatch(peer, SyncMessage(eMeta->metaObject()->className(), obj->objectName(), QByteArray(funcname), params));
-        }
+        peers = _restrictedTargets.values();
+        peers.removeAll(nullptr);
     }
     else
-        dispatch(SyncMessage(eMeta->metaObject()->className(), obj->objectName(), QByteArray(funcname), params));
+        peers = _peerMap.values();
+    dispatch(syncTargets(obj, std::move(peers)), syncMessage);
+}
+
+QList<Peer*> SignalProxy::syncTargets(const SyncableObject* obj, QList<Peer*> peers) const
+{
+    // Closed peers are kept, dispatching to them gets them removed
+    peers.removeIf([obj](Peer* peer) { return peer && peer->isOpen() && !obj->isSyncedTo(peer); });
+    return peers;
+}
+
+void SignalProxy::queueCoalescedSync(const SyncableObject* obj, SyncMessage syncMessage)
+{
+    ++_coalescableSyncCount;
+
+    QList<SyncMessage>& pending = _coalescedSyncs[obj];
+    auto it = std::find_if(pending.begin(), pending.end(), [&syncMessage](const SyncMessage& other) {
+        if (other.slotName != syncMessage.slotName || other.params.size() != syncMessage.params.size())
+            return false;
+        for (int i = 0; i < syncMessage.params.size() - 1; ++i) {
+            if (other.params[i] != syncMessage.params[i])
+                return false;
+        }
+        return true;
+    });
+
+    if (it != pending.end()) {
+        *it = std::move(syncMessage);
+        ++_supersededSyncCount;
+    }
+    else {
+        pending.append(std::move(syncMessage));
+    }
+
+    if (!_coalesceTimer.isActive())
+        _coalesceTimer.start();
+}
+
+void SignalProxy::flushCoalescedSyncs(const SyncableObject* obj)
+{
+    if (_coalescedSyncs.isEmpty())
+        return;
+
+    QHash<const SyncableObject*, QList<SyncMessage>> pending;
+    if (obj) {
+        pending.insert(obj, _coalescedSyncs.take(obj));
+    }
+    else {
+        pending.swap(_coalescedSyncs);
+    }
+
+    if (_coalescedSyncs.isEmpty())
+        _coalesceTimer.stop();
+
+    for (auto it = pending.cbegin(); it != pending.cend(); ++it) {
+        QList<Peer*> peers = syncTargets(it.key(), _peerMap.values());
+        for (auto&& syncMessage : it.value())
+            dispatch(peers, syncMessage);
+    }
 }
 
 void SignalProxy::disconnectDevice(QIODevice* dev, const QString& reason)
@@ -627,6 +820,9 @@ void SignalProxy::dumpProxyStats()
     qDebug() << "          attached Slots:" << _attachedSlots.size();
     qDebug() << " number of synced Slaves:" << slaveCount;
     qDebug() << "number of Classes cached:" << _extendedMetaObjects.size();
+    qDebug() << "   coalescable sync calls:" << _coalescableSyncCount;
+    qDebug() << "    superseded sync calls:" << _supersededSyncCount << "(coalesce ratio:"
+             << (_coalescableSyncCount ? double(_supersededSyncCount) / _coalescableSyncCount : 0.0) << ")";
 }
 
 void SignalProxy::updateSecureState()
@@ -700,6 +896,18 @@ void SignalProxy::setTargetPeer(Peer* targetPeer)
     _targetPeer = targetPeer;
 }
 
+void SignalProxy::setInitDataCacheEnabled(bool enabled)
+{
+    _initDataCacheEnabled = enabled;
+    if (!enabled)
+        clearInitDataCache();
+}
+
+void SignalProxy::clearInitDataCache()
+{
+    _initDataCache.clear();
+}
+
 // ---- SlotObjectBase ---------------------------------------------------------------------------------------------------------------------
 
 SignalProxy::SlotObjectBase::SlotObjectBase(const QObject* context)
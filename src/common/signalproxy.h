@@ -17,6 +17,7 @@
 #include <QMetaMethod>
 #include <QSet>
 #include <QThread>
+#include <QTimer>
 
 #include "funchelpers.h"
 #include "protocol.h"
@@ -164,6 +165,7 @@ public:
     /**}@*/
 
     inline int peerCount() const { return _peerMap.size(); }
+    inline QList<Peer*> peers() const { return _peerMap.values(); }
     QVariantList peerData();
 
     Peer* peerById(int peerId);
@@ -180,9 +182,25 @@ public:
     Peer* targetPeer();
     void setTargetPeer(Peer* targetPeer);
 
+    /**
+     * Enables caching of the InitData received for synced objects (client only).
+     *
+     * If the core supports the SyncRevisions feature, InitData comes with a revision. When the client requests the
+     * state of an object it has cached (e.g. after reconnecting), it presents that revision, and the core only sends
+     * the state again if it has changed in the meantime.
+     *
+     * @param enabled Whether to cache received InitData
+     */
+    void setInitDataCacheEnabled(bool enabled);
+
+    /**
+     * Drops all cached InitData, e.g. when connecting to a different core.
+     */
+    void clearInitDataCache();
+
 protected:
     void customEvent(QEvent* event) override;
-    void sync_call__(const SyncableObject* obj, ProxyMode modeType, const char* funcname, va_list ap);
+    void sync_call__(const SyncableObject* obj, ProxyMode modeType, const char* funcname, va_list ap, bool coalesce = false);
     void renameObject(const SyncableObject* obj, const QString& newname, const QString& oldname);
 
 private slots:
@@ -238,9 +256,14 @@ private:
      */
     void dispatchSignal(QByteArray signalName, QVariantList params);
 
+    /// @returns Whether messages sent right now would reach any peer, taking restrictTargetPeers() into account
+    bool hasTargetPeers() const { return _restrictMessageTarget ? !_restrictedTargets.isEmpty() : !_peerMap.isEmpty(); }
+
     template<class T>
     void dispatch(const T& protoMessage);
     template<class T>
+    void dispatch(const QList<Peer*>& peers, const T& protoMessage);
+    template<class T>
     void dispatch(Peer* peer, const T& protoMessage);
 
     void handle(Peer* peer, const QuasselProtocol::SyncMessage& syncMessage);
@@ -259,8 +282,48 @@ private:
 
     void requestInit(SyncableObject* obj);
     QVariantMap initData(SyncableObject* obj) const;
+
+    /**
+     * Sends InitData to a peer, serializing it in a worker thread if both the object and the peer support that.
+     *
+     * @param peer The peer requesting the InitData
+     * @param obj  The object the InitData was taken from
+     * @param msg  The InitData
+     */
+    void dispatchInitData(Peer* peer, const SyncableObject* obj, const QuasselProtocol::InitData& msg);
     void setInitData(SyncableObject* obj, const QVariantMap& properties);
 
+    /// @returns The revision of the object's state as presented to clients, unique for the lifetime of this SignalProxy
+    QByteArray revision(const SyncableObject* obj) const;
+
+    /**
+     * Holds back a sync call marked as coalescable, superseding a pending call it makes obsolete.
+     *
+     * A pending call is superseded by a later call of the same slot on the same object whose arguments only differ
+     * in the last one, i.e. the value being set. Pending calls are sent when the coalescing window ends, or before
+     * any other call concerning the same object.
+     *
+     * @param obj         The synced object
+     * @param syncMessage The sync call
+     */
+    void queueCoalescedSync(const SyncableObject* obj, QuasselProtocol::SyncMessage syncMessage);
+
+    /**
+     * Sends pending coalesced sync calls.
+     *
+     * @param obj The object to send pending calls for, or nullptr for all objects
+     */
+    void flushCoalescedSyncs(const SyncableObject* obj = nullptr);
+
+    /**
+     * Removes the peers that don't know the given object from a list of sync call targets.
+     *
+     * @param obj   The synced object
+     * @param peers The peers the sync call would be sent to
+     * @returns The peers the sync call is sent to
+     */
+    QList<Peer*> syncTargets(const SyncableObject* obj, QList<Peer*> peers) const;
+
     static void disconnectDevice(QIODevice* dev, const QString& reason = QString());
 
 private:
@@ -289,6 +352,22 @@ private:
     Peer* _sourcePeer = nullptr;
     Peer* _targetPeer = nullptr;
 
+    struct CachedInitData
+    {
+        QByteArray revision;
+        QVariantMap initData;
+    };
+
+    quint64 _lastRevision = 0;
+    QByteArray _revisionEpoch;  ///< Distinguishes revisions of different SignalProxy instances, e.g. after a core restart
+    bool _initDataCacheEnabled = false;
+    QHash<QByteArray, QHash<QString, CachedInitData>> _initDataCache;
+
+    QHash<const SyncableObject*, QList<QuasselProtocol::SyncMessage>> _coalescedSyncs;  ///< Pending coalesced sync calls
+    QTimer _coalesceTimer;
+    quint64 _coalescableSyncCount = 0;  ///< Number of sync calls marked as coalescable
+    quint64 _supersededSyncCount = 0;   ///< Number of coalescable sync calls that were never sent
+
     friend class SyncableObject;
     friend class Peer;
 };
@@ -316,6 +395,8 @@ bool SignalProxy::attachSignal(const typename FunctionTraits<Signal>::ClassType*
 
     // Upon signal emission, marshall the signal's arguments into a QVariantList and dispatch an RpcCall message
     connect(sender, signal, this, [this, signalName = std::move(name)](auto&&... args) {
+        if (!this->hasTargetPeers())
+            return;
         this->dispatchSignal(std::move(signalName), {QVariant::fromValue(args)...});
     });
 
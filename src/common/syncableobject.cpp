@@ -161,6 +161,16 @@ void SyncableObject::sync_call__(SignalProxy::ProxyMode modeType, const char* fu
     }
 }
 
+void SyncableObject::coalesced_sync_call__(SignalProxy::ProxyMode modeType, const char* funcname, ...) const
+{
+    foreach (SignalProxy* proxy, _signalProxies) {
+        va_list ap;
+        va_start(ap, funcname);
+        proxy->sync_call__(this, modeType, funcname, ap, true);
+        va_end(ap);
+    }
+}
+
 void SyncableObject::synchronize(SignalProxy* proxy)
 {
     if (_signalProxies.contains(proxy))
@@ -28,6 +28,15 @@ private:
 #define SYNC(...) sync_call__(SignalProxy::Server, __func__, __VA_ARGS__);
 #define REQUEST(...) sync_call__(SignalProxy::Client, __func__, __VA_ARGS__);
 
+/**
+ * Like SYNC(), for idempotent setters that may be called many times per second.
+ *
+ * Such calls are held back for a short while, and superseded by later calls of the same slot on the same object
+ * whose arguments only differ in the last one, so only the latest value is sent. Use it only if the last argument is
+ * the value being set, and if the call doesn't need to be ordered with calls on other objects.
+ */
+#define SYNC_COALESCED(...) coalesced_sync_call__(SignalProxy::Server, __func__, __VA_ARGS__);
+
 #define SYNC_OTHER(x, ...) sync_call__(SignalProxy::Server, #x, __VA_ARGS__);
 #define REQUEST_OTHER(x, ...) sync_call__(SignalProxy::Client, #x, __VA_ARGS__);
 
@@ -68,6 +77,57 @@ public:
     inline void setAllowClientUpdates(bool allow) { _allowClientUpdates = allow; }
     inline bool allowClientUpdates() const { return _allowClientUpdates; }
 
+    /**
+     * Provides the revision of the object's state.
+     *
+     * On the core side, every sync call bumps the revision of the synced object, so clients can tell whether
+     * the state they cached has changed in the meantime.
+     *
+     * @returns The object's revision
+     */
+    inline quint64 revision() const { return _revision; }
+
+    /**
+     * Sets a new revision for the object's state.
+     *
+     * Objects whose state is part of another object's InitData need to bump that object's revision as well.
+     *
+     * @param revision The new revision
+     */
+    virtual void bumpRevision(quint64 revision) { _revision = revision; }
+
+    /**
+     * Tells whether the object's InitData may be serialized in a worker thread.
+     *
+     * This is only the case if the InitData consists of types whose serialization doesn't depend on the target peer,
+     * i.e. it must not contain Message or MsgId values.
+     *
+     * @returns Whether the object's InitData may be serialized concurrently
+     */
+    virtual bool allowsConcurrentInitData() const { return false; }
+
+    /**
+     * Tells whether sync calls of the object are sent to the given peer.
+     *
+     * Peers may not know every object, e.g. clients with lazy channel membership only know the IrcUsers of
+     * channels they requested the members of.
+     *
+     * @param peer The peer a sync call is about to be sent to
+     * @returns Whether the peer knows the object
+     */
+    virtual bool isSyncedTo(const Peer*) const { return true; }
+
+    /**
+     * Tells whether the given peer may restore the object from its cached InitData, if the object hasn't changed since.
+     *
+     * Objects whose InitData depends on the peer it is sent to must only be restored from the cache by peers that
+     * would receive the same InitData.
+     *
+     * @param peer The peer requesting the InitData
+     * @returns Whether the peer may use its cached InitData
+     */
+    virtual bool allowsCachedInitData(const Peer*) const { return true; }
+
 public slots:
     virtual void setInitialized();
     void requestUpdate(const QVariantMap& properties);
@@ -75,6 +135,7 @@ public slots:
 
 protected:
     void sync_call__(SignalProxy::ProxyMode modeType, const char* funcname, ...) const;
+    void coalesced_sync_call__(SignalProxy::ProxyMode modeType, const char* funcname, ...) const;
 
 signals:
     void initDone();
@@ -91,6 +152,7 @@ private:
     QString _objectName;
     bool _initialized{false};
     bool _allowClientUpdates{false};
+    quint64 _revision{0};
 
     QList<SignalProxy*> _signalProxies;
 
@@ -0,0 +1,6 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+DELETE FROM sender
+WHERE senderid > :firstsenderid AND senderid <= :lastsenderid
+    AND NOT EXISTS (SELECT 1 FROM backlog WHERE backlog.senderid = sender.senderid)
@@ -0,0 +1,13 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+INSERT INTO backlog (messageid, time, bufferid, type, flags, senderid, senderprefixes, message)
+SELECT messageid, time, bufferid, type, flags, senderid, senderprefixes, message
+FROM json_to_recordset($1::json) AS input (messageid bigint,
+                                           time timestamp,
+                                           bufferid integer,
+                                           type integer,
+                                           flags integer,
+                                           senderid bigint,
+                                           senderprefixes text,
+                                           message text)
@@ -0,0 +1,29 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+WITH input (sender, realname, avatarurl) AS (
+    SELECT DISTINCT sender, realname, avatarurl
+    FROM json_to_recordset($1::json) AS senders (sender text, realname text, avatarurl text)
+), existing AS (
+    SELECT sender.senderid, input.sender, input.realname, input.avatarurl
+    FROM input
+    JOIN sender ON sender.sender = input.sender
+        AND coalesce(sender.realname, '') = coalesce(input.realname, '')
+        AND coalesce(sender.avatarurl, '') = coalesce(input.avatarurl, '')
+), inserted AS (
+    INSERT INTO sender (sender, realname, avatarurl)
+    SELECT sender, realname, avatarurl
+    FROM input
+    WHERE NOT EXISTS (
+        SELECT 1
+        FROM existing
+        WHERE existing.sender = input.sender
+            AND existing.realname IS NOT DISTINCT FROM input.realname
+            AND existing.avatarurl IS NOT DISTINCT FROM input.avatarurl
+    )
+    ON CONFLICT DO NOTHING
+    RETURNING senderid, sender, realname, avatarurl
+)
+SELECT senderid, sender, realname, avatarurl FROM existing
+UNION ALL
+SELECT senderid, sender, realname, avatarurl FROM inserted
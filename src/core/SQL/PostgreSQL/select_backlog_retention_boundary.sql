@@ -0,0 +1,9 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+SELECT backlog.messageid
+FROM backlog
+JOIN buffer ON backlog.bufferid = buffer.bufferid
+WHERE backlog.bufferid = :bufferid AND buffer.userid = :userid
+ORDER BY backlog.messageid DESC
+LIMIT 1 OFFSET :offset
@@ -0,0 +1,5 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+SELECT nextval('backlog_messageid_seq')
+FROM generate_series(1, $1)
@@ -0,0 +1,11 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+SELECT messageid, bufferid, time,  type, flags, sender, senderprefixes, realname, avatarurl, message
+FROM backlog
+JOIN sender ON backlog.senderid = sender.senderid
+WHERE to_tsvector('simple', message) @@ plainto_tsquery('simple', :query)
+    AND backlog.bufferid IN (SELECT bufferid FROM buffer WHERE userid = :userid)
+    AND backlog.messageid < :lastmsg
+ORDER BY ts_rank(to_tsvector('simple', message), plainto_tsquery('simple', :query)) DESC, messageid DESC
+LIMIT :limit
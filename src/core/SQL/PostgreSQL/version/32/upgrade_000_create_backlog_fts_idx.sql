@@ -0,0 +1,4 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+CREATE INDEX backlog_message_fts_idx ON backlog USING GIN (to_tsvector('simple', message))
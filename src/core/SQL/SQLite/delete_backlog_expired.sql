@@ -0,0 +1,13 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+DELETE FROM backlog
+WHERE messageid IN (
+    SELECT backlog.messageid
+    FROM backlog
+    JOIN buffer ON backlog.bufferid = buffer.bufferid
+    WHERE backlog.bufferid = :bufferid AND buffer.userid = :userid
+        AND (backlog.time < :olderthan OR backlog.messageid < :before)
+    ORDER BY backlog.messageid
+    LIMIT :limit
+)
@@ -0,0 +1,4 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+INSERT INTO backlog_fts (backlog_fts, rowid, message) VALUES ('delete', :messageid, :message)
@@ -4,7 +4,7 @@
 /* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
 /* SPDX-License-Identifier: GPL-2.0-or-later */
 
-SELECT messageid, time, bufferid, type, flags, senderid, senderprefixes, message
+SELECT messageid, time, bufferid, type, flags, senderid, senderprefixes, message, messagedata
 FROM backlog
 WHERE messageid > ? AND messageid <= ?
 ORDER BY messageid ASC
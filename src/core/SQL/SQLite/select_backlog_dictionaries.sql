@@ -0,0 +1,6 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+SELECT dictionaryid, data
+FROM backlog_dictionary
+ORDER BY dictionaryid
@@ -0,0 +1,7 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+SELECT messageid, messagedata
+FROM backlog_fts_unindex
+ORDER BY messageid
+LIMIT :limit
@@ -0,0 +1,12 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+SELECT backlog.messageid, backlog.bufferid, backlog.time, backlog.type, backlog.flags, sender, senderprefixes, realname, avatarurl, backlog.message, backlog.messagedata
+FROM backlog_fts
+JOIN backlog ON backlog.messageid = backlog_fts.rowid
+JOIN sender ON backlog.senderid = sender.senderid
+WHERE backlog_fts MATCH :query
+    AND backlog.bufferid IN (SELECT bufferid FROM buffer WHERE userid = :userid)
+    AND backlog.messageid < :lastmsg
+ORDER BY bm25(backlog_fts), backlog.messageid DESC
+LIMIT :limit
@@ -4,7 +4,7 @@
 /* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
 /* SPDX-License-Identifier: GPL-2.0-or-later */
 
-SELECT messageid, time,  type, flags, sender, senderprefixes, realname, avatarurl, message
+SELECT messageid, time,  type, flags, sender, senderprefixes, realname, avatarurl, message, messagedata
 FROM backlog
 JOIN sender ON backlog.senderid = sender.senderid
 WHERE bufferid = :bufferid
@@ -0,0 +1,8 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+SELECT message
+FROM backlog
+WHERE message IS NOT NULL
+ORDER BY messageid DESC
+LIMIT :limit
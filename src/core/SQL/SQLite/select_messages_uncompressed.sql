@@ -0,0 +1,8 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+SELECT messageid, message
+FROM backlog
+WHERE messageid > :after AND message IS NOT NULL AND length(message) >= :minlength
+ORDER BY messageid
+LIMIT :limit
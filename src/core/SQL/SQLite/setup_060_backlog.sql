@@ -12,5 +12,6 @@ CREATE TABLE backlog (
 	flags INTEGER NOT NULL,
 	senderid INTEGER NOT NULL,
 	senderprefixes TEXT,
-	message TEXT
+	message TEXT,
+	messagedata BLOB
 )
@@ -0,0 +1,6 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+UPDATE backlog
+SET message = NULL, messagedata = :messagedata
+WHERE messageid = :messageid
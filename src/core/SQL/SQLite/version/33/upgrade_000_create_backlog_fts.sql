@@ -0,0 +1,8 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+CREATE VIRTUAL TABLE backlog_fts USING fts5(
+	message,
+	content = 'backlog',
+	content_rowid = 'messageid'
+)
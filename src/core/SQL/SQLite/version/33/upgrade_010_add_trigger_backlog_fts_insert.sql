@@ -0,0 +1,10 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+CREATE TRIGGER backlog_fts_trigger_insert
+AFTER INSERT
+ON backlog
+FOR EACH ROW
+    BEGIN
+        INSERT INTO backlog_fts (rowid, message) VALUES (new.messageid, new.message);
+    END
@@ -0,0 +1,5 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+ALTER TABLE backlog
+ADD COLUMN messagedata BLOB
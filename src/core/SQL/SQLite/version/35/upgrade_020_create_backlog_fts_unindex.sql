@@ -0,0 +1,7 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+CREATE TABLE backlog_fts_unindex (
+	messageid INTEGER NOT NULL PRIMARY KEY,
+	messagedata BLOB NOT NULL
+)
@@ -0,0 +1,11 @@
+/* SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org> */
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+CREATE TRIGGER backlog_fts_trigger_delete
+AFTER DELETE
+ON backlog
+FOR EACH ROW
+WHEN old.message IS NOT NULL
+    BEGIN
+        INSERT INTO backlog_fts (backlog_fts, rowid, message) VALUES ('delete', old.messageid, old.message);
+    END
@@ -13,6 +13,7 @@
 #include <QSqlQuery>
 #include <QThread>
 
+#include "metricsserver.h"
 #include "quassel.h"
 
 int AbstractSqlStorage::_nextConnectionId = 0;
@@ -418,6 +419,36 @@ void AbstractSqlStorage::connectionDestroyed()
     _connectionPool.remove(sender()->thread());
 }
 
+qint64 AbstractSqlStorage::cachedSenderId(const SenderData& sender)
+{
+    qint64 senderId = 0;
+    {
+        QMutexLocker locker(&_senderIdCacheMutex);
+        qint64* cachedId = _senderIdCache.object(sender);
+        if (cachedId)
+            senderId = *cachedId;
+    }
+    if (metricsServer()) {
+        metricsServer()->addSenderIdCacheLookup(senderId != 0);
+    }
+    return senderId;
+}
+
+void AbstractSqlStorage::cacheSenderIds(const QHash<SenderData, qint64>& senderIds)
+{
+    QMutexLocker locker(&_senderIdCacheMutex);
+    for (auto it = senderIds.constBegin(); it != senderIds.constEnd(); ++it) {
+        if (it.value() > 0)
+            _senderIdCache.insert(it.key(), new qint64{it.value()});
+    }
+}
+
+void AbstractSqlStorage::clearSenderIdCache()
+{
+    QMutexLocker locker(&_senderIdCacheMutex);
+    _senderIdCache.clear();
+}
+
 // ========================================
 //  AbstractSqlStorage::Connection
 // ========================================
@@ -6,6 +6,7 @@
 #include <memory>
 #include <vector>
 
+#include <QCache>
 #include <QHash>
 #include <QMutex>
 #include <QSqlDatabase>
@@ -19,6 +20,16 @@ class QThread;
 class AbstractSqlMigrationReader;
 class AbstractSqlMigrationWriter;
 
+struct SenderData
+{
+    QString sender;
+    QString realname;
+    QString avatarurl;
+
+    friend uint qHash(const SenderData& key);
+    friend bool operator==(const SenderData& a, const SenderData& b);
+};
+
 class AbstractSqlStorage : public Storage
 {
     Q_OBJECT
@@ -141,6 +152,36 @@ protected:
      */
     inline virtual bool initDbSession(QSqlDatabase& /* db */) { return true; }
 
+    /**
+     * Looks up the ID of a sender in the sender ID cache
+     *
+     * Every lookup is accounted for in the sender cache hit rate reported via the MetricsServer.
+     *
+     * @note This method is threadsafe.
+     *
+     * @param sender  The sender to look up
+     * @return The cached sender ID, or 0 if the sender is not cached
+     */
+    qint64 cachedSenderId(const SenderData& sender);
+
+    /**
+     * Adds sender IDs to the sender ID cache
+     *
+     * Only IDs of senders whose insertion has been committed may be cached.
+     *
+     * @note This method is threadsafe.
+     *
+     * @param senderIds  Sender IDs by sender
+     */
+    void cacheSenderIds(const QHash<SenderData, qint64>& senderIds);
+
+    /**
+     * Drops all entries from the sender ID cache, e.g. after senders have been deleted
+     *
+     * @note This method is threadsafe.
+     */
+    void clearSenderIdCache();
+
 private slots:
     void connectionDestroyed();
 
@@ -158,16 +199,10 @@ private:
     // which allows us thread safe termination of a connection
     class Connection;
     QHash<QThread*, Connection*> _connectionPool;
-};
 
-struct SenderData
-{
-    QString sender;
-    QString realname;
-    QString avatarurl;
-
-    friend uint qHash(const SenderData& key);
-    friend bool operator==(const SenderData& a, const SenderData& b);
+    static constexpr int SenderIdCacheSize{20000};  ///< Maximum number of cached sender IDs
+    QMutex _senderIdCacheMutex;
+    QCache<SenderData, qint64> _senderIdCache{SenderIdCacheSize};  ///< LRU cache of sender IDs, protected by _senderIdCacheMutex
 };
 
 // ========================================
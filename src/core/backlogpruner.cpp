@@ -0,0 +1,239 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "backlogpruner.h"
+
+#include <utility>
+
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "metricsserver.h"
+#include "storage.h"
+
+namespace {
+
+/// Time (in milliseconds) to wait after startup before the first retention pass
+constexpr int initialDelay{5 * 60 * 1000};
+
+/// @returns The key of the per buffer type override in the "BacklogRetention" setting, or an empty string if there is none
+QString bufferTypeKey(BufferInfo::Type type)
+{
+    switch (type) {
+    case BufferInfo::StatusBuffer:
+        return "StatusBuffer";
+    case BufferInfo::ChannelBuffer:
+        return "ChannelBuffer";
+    case BufferInfo::QueryBuffer:
+        return "QueryBuffer";
+    case BufferInfo::GroupBuffer:
+        return "GroupBuffer";
+    default:
+        return {};
+    }
+}
+
+BacklogPruner::Policy mergePolicy(const QVariantMap& settings, BacklogPruner::Policy policy)
+{
+    if (settings.contains("MaxAge"))
+        policy.maxAge = qMax(0, settings["MaxAge"].toInt());
+    if (settings.contains("MaxRows"))
+        policy.maxRows = qMax(0, settings["MaxRows"].toInt());
+    return policy;
+}
+
+/// @returns The limits of a settings map, with only the keys that were given
+QVariantMap sanitizeLimits(const QVariantMap& settings)
+{
+    QVariantMap result;
+    for (const char* key : {"MaxAge", "MaxRows"}) {
+        if (settings.contains(key))
+            result[key] = qMax(0, settings[key].toInt());
+    }
+    return result;
+}
+
+}  // namespace
+
+BacklogPruner::BacklogPruner(std::shared_ptr<Storage> storage, Policy defaultPolicy, int interval, MetricsServer* metricsServer, QObject* parent)
+    : QObject(parent)
+    , _storage{std::move(storage)}
+    , _defaultPolicy{defaultPolicy}
+    , _interval{qMax(1, interval)}
+    , _metricsServer{metricsServer}
+{
+    _thread = QThread::create([this] { run(); });
+    _thread->setObjectName("BacklogPruner");
+    _thread->start(QThread::LowPriority);
+}
+
+BacklogPruner::~BacklogPruner()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _stopping = true;
+    }
+    _stopCondition.wakeAll();
+    _thread->wait();
+    delete _thread;
+}
+
+void BacklogPruner::setMetricsServer(MetricsServer* metricsServer)
+{
+    _metricsServer = metricsServer;
+}
+
+BacklogPruner::Policy BacklogPruner::policy(const QVariantMap& userSettings, BufferInfo::Type type, const Policy& defaultPolicy)
+{
+    Policy policy = mergePolicy(userSettings, defaultPolicy);
+    QString typeKey = bufferTypeKey(type);
+    if (typeKey.isEmpty())
+        return policy;
+    return mergePolicy(userSettings[typeKey].toMap(), policy);
+}
+
+QVariantMap BacklogPruner::sanitizeSettings(const QVariantMap& userSettings)
+{
+    QVariantMap result = sanitizeLimits(userSettings);
+    for (BufferInfo::Type type : {BufferInfo::StatusBuffer, BufferInfo::ChannelBuffer, BufferInfo::QueryBuffer, BufferInfo::GroupBuffer}) {
+        QString typeKey = bufferTypeKey(type);
+        QVariantMap limits = sanitizeLimits(userSettings[typeKey].toMap());
+        if (!limits.isEmpty())
+            result[typeKey] = limits;
+    }
+    return result;
+}
+
+bool BacklogPruner::wait(int msecs)
+{
+    QMutexLocker locker(&_mutex);
+    if (!_stopping)
+        _stopCondition.wait(&_mutex, QDeadlineTimer{msecs});
+    return !_stopping;
+}
+
+void BacklogPruner::run()
+{
+    if (!wait(initialDelay))
+        return;
+
+    do {
+        prune();
+        compress();
+    } while (wait(_interval * 60 * 1000));
+}
+
+void BacklogPruner::prune()
+{
+    QElapsedTimer timer;
+    timer.start();
+    MetricsServer* metricsServer = _metricsServer;
+    if (metricsServer)
+        metricsServer->setBacklogRetentionRunning(true);
+
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    qint64 deletedMessages = 0;
+    int prunedBuffers = 0;
+    bool interrupted = false;
+
+    const auto users = _storage->getAllAuthUserNames().keys();
+    for (UserId user : users) {
+        QVariantMap settings = _storage->getUserSetting(user, SettingName, QVariant()).toMap();
+        if (settings.isEmpty() && !_defaultPolicy.isEnabled())
+            continue;
+
+        for (const BufferInfo& bufferInfo : _storage->requestBuffers(user)) {
+            Policy policy = BacklogPruner::policy(settings, bufferInfo.type(), _defaultPolicy);
+            if (!policy.isEnabled())
+                continue;
+
+            QDateTime olderThan = policy.maxAge > 0 ? now.addDays(-policy.maxAge) : QDateTime();
+            MsgId before = _storage->oldestRetainedMsgId(user, bufferInfo.bufferId(), policy.maxRows);
+            if (!olderThan.isValid() && !before.isValid())
+                continue;
+
+            qint64 deletedFromBuffer = 0;
+            int deleted = 0;
+            do {
+                if (!wait(BatchPause)) {
+                    interrupted = true;
+                    break;
+                }
+                deleted = _storage->deleteExpiredMsgs(user, bufferInfo.bufferId(), olderThan, before, BatchSize);
+                if (deleted > 0) {
+                    deletedFromBuffer += deleted;
+                    if (metricsServer)
+                        metricsServer->addBacklogRetentionProgress(deleted, 0);
+                }
+            } while (deleted == BatchSize);
+
+            if (deletedFromBuffer > 0) {
+                qDebug() << "Backlog retention: deleted" << deletedFromBuffer << "messages from buffer" << bufferInfo.bufferId() << "of user"
+                         << user;
+                deletedMessages += deletedFromBuffer;
+                ++prunedBuffers;
+            }
+            if (interrupted)
+                break;
+        }
+        if (interrupted)
+            break;
+    }
+
+    qint64 deletedSenders = 0;
+    if (deletedMessages > 0 && !interrupted) {
+        qInfo() << "Backlog retention: deleted" << deletedMessages << "messages from" << prunedBuffers
+                << "buffers, removing orphaned senders...";
+
+        const qint64 maxSenderId = _storage->maxSenderId();
+        for (qint64 firstSenderId = 0; firstSenderId < maxSenderId; firstSenderId += BatchSize) {
+            if (!wait(BatchPause)) {
+                interrupted = true;
+                break;
+            }
+            int deleted = _storage->deleteOrphanedSenders(firstSenderId, firstSenderId + BatchSize);
+            if (deleted < 0)
+                break;
+            if (deleted > 0) {
+                deletedSenders += deleted;
+                if (metricsServer)
+                    metricsServer->addBacklogRetentionProgress(0, deleted);
+            }
+        }
+
+        if (!interrupted)
+            _storage->compact();
+
+        qInfo() << "Backlog retention: removed" << deletedSenders << "orphaned senders, pass took" << timer.elapsed() / 1000 << "s";
+    }
+    else if (interrupted && deletedMessages > 0) {
+        qInfo() << "Backlog retention: interrupted after deleting" << deletedMessages << "messages from" << prunedBuffers << "buffers";
+    }
+
+    if (metricsServer)
+        metricsServer->setBacklogRetentionRunning(false);
+}
+
+void BacklogPruner::compress()
+{
+    int cleaned = 0;
+    do {
+        if (!wait(BatchPause))
+            return;
+        cleaned = _storage->cleanupSearchIndex(BatchSize);
+    } while (cleaned == BatchSize);
+
+    const MsgId start = _compressCursor;
+    while (wait(BatchPause)) {
+        MsgId last = _storage->compressMsgs(_compressCursor, BatchSize);
+        if (!last.isValid())
+            break;
+        _compressCursor = last;
+    }
+    if (_compressCursor != start)
+        qDebug() << "Backlog compression: processed messages up to" << _compressCursor;
+}
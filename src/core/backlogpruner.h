@@ -0,0 +1,133 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "core-export.h"
+
+#include <atomic>
+#include <memory>
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+#include <QWaitCondition>
+
+#include "bufferinfo.h"
+
+class MetricsServer;
+class QThread;
+class Storage;
+
+/**
+ * Background job enforcing the backlog retention policy.
+ *
+ * In regular intervals, the pruner deletes messages that are older than the configured maximum age,
+ * or that exceed the configured maximum number of messages of a buffer. Messages are deleted in small
+ * batches from a dedicated thread, so neither the sessions nor the storage writer are blocked for long.
+ * Afterwards, senders no longer referenced by any message are garbage collected and the storage
+ * backend is asked to give back the freed space.
+ *
+ * The core-wide policy is set with the --backlog-max-age and --backlog-max-rows options. Users can
+ * override it with the "BacklogRetention" user setting (set through CoreSession::setBacklogRetention()),
+ * which holds "MaxAge" (in days) and "MaxRows", optionally overridden per buffer type by nested maps
+ * named "StatusBuffer", "ChannelBuffer", "QueryBuffer" and "GroupBuffer". A value of 0 means unlimited.
+ *
+ * After each retention pass, the pruner also takes care of backlog compression (enabled with the
+ * --backlog-compression option): it compresses messages that were stored before compression was
+ * enabled, and removes deleted compressed messages from the search index.
+ */
+class CORE_EXPORT BacklogPruner : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Retention limits for a buffer
+    struct Policy
+    {
+        int maxAge{0};   ///< Maximum age of messages in days, 0 for unlimited
+        int maxRows{0};  ///< Maximum number of messages per buffer, 0 for unlimited
+
+        bool isEnabled() const { return maxAge > 0 || maxRows > 0; }
+    };
+
+    /// Name of the user setting holding a user's retention policy
+    static constexpr const char* SettingName{"BacklogRetention"};
+
+    /// Number of messages or senders deleted in one go
+    static constexpr int BatchSize{1000};
+
+    /// Time (in milliseconds) to wait between batches, giving other writers a chance to get to the database
+    static constexpr int BatchPause{50};
+
+    /**
+     * Constructor.
+     *
+     * @param storage       The storage backend to prune
+     * @param defaultPolicy The core-wide retention policy
+     * @param interval      Time between retention passes, in minutes
+     * @param metricsServer MetricsServer to report progress to, may be nullptr
+     * @param parent        Parent object
+     */
+    BacklogPruner(std::shared_ptr<Storage> storage, Policy defaultPolicy, int interval, MetricsServer* metricsServer, QObject* parent = nullptr);
+
+    /**
+     * Destructor.
+     *
+     * Interrupts a running retention pass and stops the pruner thread.
+     */
+    ~BacklogPruner() override;
+
+    /**
+     * Sets the MetricsServer to report progress to.
+     *
+     * @note This method is threadsafe.
+     *
+     * @param metricsServer MetricsServer to report progress to, may be nullptr
+     */
+    void setMetricsServer(MetricsServer* metricsServer);
+
+    /**
+     * Determines the retention policy for a buffer type.
+     *
+     * @param userSettings  The user's "BacklogRetention" setting
+     * @param type          The buffer type
+     * @param defaultPolicy The core-wide retention policy
+     * @returns The effective policy
+     */
+    static Policy policy(const QVariantMap& userSettings, BufferInfo::Type type, const Policy& defaultPolicy);
+
+    /**
+     * Strips a "BacklogRetention" setting down to the keys the pruner knows.
+     *
+     * @param userSettings The setting as received from a client
+     * @returns The setting with only known keys and non-negative limits
+     */
+    static QVariantMap sanitizeSettings(const QVariantMap& userSettings);
+
+private:
+    void run();
+    void prune();
+    void compress();
+
+    /**
+     * Waits for the given time, or until the pruner is stopped.
+     *
+     * @returns false if the pruner is stopping
+     */
+    bool wait(int msecs);
+
+private:
+    std::shared_ptr<Storage> _storage;
+    Policy _defaultPolicy;
+    int _interval;
+    std::atomic<MetricsServer*> _metricsServer;
+    MsgId _compressCursor;  ///< Last message processed by compress(), only accessed from the pruner thread
+
+    QThread* _thread{nullptr};
+
+    QMutex _mutex;
+    QWaitCondition _stopCondition;
+    bool _stopping{false};  ///< protected by _mutex
+};
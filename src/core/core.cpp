@@ -71,6 +71,8 @@ Core::~Core()
 {
     qDeleteAll(_connectingClients);
     qDeleteAll(_sessions);
+    _backlogPruner.reset();
+    _storageWriter.reset();
     syncStorage();
 }
 
@@ -185,6 +187,11 @@ void Core::init()
             throw ExitException{success ? EXIT_SUCCESS : EXIT_FAILURE};
         }
 
+        if (Quassel::isOptionSet("compact-storage")) {
+            bool success = _storage->enableIncrementalCompaction();
+            throw ExitException{success ? EXIT_SUCCESS : EXIT_FAILURE};
+        }
+
         _strictIdentEnabled = Quassel::isOptionSet("strict-ident");
         if (_strictIdentEnabled) {
             cacheSysIdent();
@@ -202,6 +209,8 @@ void Core::init()
             _metricsServer = new MetricsServer(this);
             _server.setMetricsServer(_metricsServer);
             _v6server.setMetricsServer(_metricsServer);
+            _storage->setMetricsServer(_metricsServer);
+            _backlogPruner->setMetricsServer(_metricsServer);
         }
 
         Quassel::registerReloadHandler([]() {
@@ -457,6 +466,16 @@ bool Core::initStorage(
         break;
     }
     _storage = std::move(storage);
+    if (Quassel::isOptionSet("backlog-compression") && !_storage->enableMessageCompression()) {
+        qWarning() << qPrintable(tr("Storage backend %1 does not support backlog compression, storing messages uncompressed").arg(backend));
+    }
+    _storageWriter = std::make_unique<StorageWriter>(_storage, Quassel::optionValue("storage-commit-latency").toInt());
+    // Also set up here rather than in init(), so cores configured through the setup wizard get pruned as well
+    _backlogPruner = std::make_unique<BacklogPruner>(_storage,
+                                                     BacklogPruner::Policy{Quassel::optionValue("backlog-max-age").toInt(),
+                                                                           Quassel::optionValue("backlog-max-rows").toInt()},
+                                                     Quassel::optionValue("backlog-retention-interval").toInt(),
+                                                     _metricsServer);
     return true;
 }
 
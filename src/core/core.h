@@ -16,6 +16,7 @@
 #include <QVariant>
 
 #include "authenticator.h"
+#include "backlogpruner.h"
 #include "bufferinfo.h"
 #include "deferredptr.h"
 #include "identserver.h"
@@ -27,6 +28,7 @@
 #include "singleton.h"
 #include "sslserver.h"
 #include "storage.h"
+#include "storagewriter.h"
 #include "types.h"
 
 class CoreAuthHandler;
@@ -374,6 +376,20 @@ public:
      */
     static inline bool storeMessages(MessageList& messages) { return instance()->_storage->logMessages(messages); }
 
+    //! Store a list of Messages asynchronously, batched together with the messages of other sessions.
+    /** \note This method is threadsafe.
+     *
+     *  \param context  The callback is invoked in this object's thread, and dropped if it is destroyed
+     *  \param messages The list message objects to be stored
+     *  \param callback Receives the stored messages with their unique Ids set; not invoked for an empty list
+     */
+    static inline void storeMessagesAsync(QObject* context, MessageList messages, StorageWriter::Callback callback)
+    {
+        if (messages.isEmpty())
+            return;
+        instance()->_storageWriter->enqueue(context, std::move(messages), std::move(callback));
+    }
+
     //! Request a certain number messages stored in a given buffer.
     /** \param buffer   The buffer we request messages from
      *  \param first    if != -1 return only messages with a MsgId >= first
@@ -453,6 +469,20 @@ public:
         return instance()->_storage->requestAllMsgsFiltered(user, first, last, limit, type, flags);
     }
 
+    //! Search the backlog of a user for messages matching a full-text query
+    /** \note This method is threadsafe.
+     *
+     *  \param bufferId The buffer to search in; if invalid, all buffers of the user are searched
+     *  \param query    The search terms
+     *  \param limit    if != -1 limit the returned list to a max of \limit entries
+     *  \param last     if != -1 return only messages with a MsgId < last
+     *  \return The matching messages, ordered by relevance
+     */
+    static inline std::vector<Message> searchMsgs(UserId user, BufferId bufferId, const QString& query, int limit = -1, MsgId last = -1)
+    {
+        return instance()->_storage->searchMsgs(user, bufferId, query, limit, last);
+    }
+
     //! Request a list of all buffers known to a user.
     /** This method is used to get a list of all buffers we have stored a backlog from.
      *  \note This method is threadsafe.
@@ -771,6 +801,7 @@ private:
     QHash<UserId, SessionThread*> _sessions;
     DeferredSharedPtr<Storage> _storage;              ///< Active storage backend
     DeferredSharedPtr<Authenticator> _authenticator;  ///< Active authenticator
+    std::unique_ptr<StorageWriter> _storageWriter;    ///< Group-committing writer for the active storage backend
     QMap<UserId, QString> _authUserNames;
 
     QTimer _storageSyncTimer;
@@ -786,6 +817,7 @@ private:
 
     IdentServer* _identServer{nullptr};
     MetricsServer* _metricsServer{nullptr};
+    std::unique_ptr<BacklogPruner> _backlogPruner;
 
     bool _initialized{false};
     bool _configured{false};
@@ -72,6 +72,7 @@ void CoreAuthHandler::onReadyRead()
                                                        this,
                                                        socket(),
                                                        Compressor::NoCompression,
+                                                       Compressor::Zlib,
                                                        this);
             connect(peer, &RemotePeer::protocolVersionMismatch, this, &CoreAuthHandler::onProtocolVersionMismatch);
             setPeer(peer);
@@ -83,7 +84,10 @@ void CoreAuthHandler::onReadyRead()
         // figure out which connection features we'll use based on the client's support
         if (Core::sslSupported() && (features & QuasselProtocol::Encryption))
             _connectionFeatures |= QuasselProtocol::Encryption;
-        if (features & QuasselProtocol::Compression)
+        // Only one compression algorithm is used, zstd is preferred and zlib is the fallback
+        if ((features & QuasselProtocol::ZstdCompression) && Compressor::isAvailable(Compressor::Zstd))
+            _connectionFeatures |= QuasselProtocol::ZstdCompression;
+        else if (features & QuasselProtocol::Compression)
             _connectionFeatures |= QuasselProtocol::Compression;
 
         socket()->read((char*)&magic, 4);  // read the 4 bytes we've just peeked at
@@ -101,12 +105,17 @@ void CoreAuthHandler::onReadyRead()
 
         if (data >= 0x80000000) {  // last protocol
             Compressor::CompressionLevel level;
-            if (_connectionFeatures & QuasselProtocol::Compression)
+            Compressor::Algorithm algorithm = Compressor::Zlib;
+            if (_connectionFeatures & QuasselProtocol::ZstdCompression) {
+                level = Compressor::BestCompression;
+                algorithm = Compressor::Zstd;
+            }
+            else if (_connectionFeatures & QuasselProtocol::Compression)
                 level = Compressor::BestCompression;
             else
                 level = Compressor::NoCompression;
 
-            RemotePeer* peer = PeerFactory::createPeer(_supportedProtos, this, socket(), level, this);
+            RemotePeer* peer = PeerFactory::createPeer(_supportedProtos, this, socket(), level, algorithm, this);
             if (!peer) {
                 qWarning() << "Received invalid handshake data from client" << hostAddress().toString();
                 close();
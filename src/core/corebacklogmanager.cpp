@@ -7,9 +7,13 @@
 #include <iterator>
 
 #include <QDebug>
+#include <QTimer>
 
 #include "core.h"
 #include "coresession.h"
+#include "peer.h"
+#include "remotepeer.h"
+#include "signalproxy.h"
 
 CoreBacklogManager::CoreBacklogManager(CoreSession* coreSession)
     : BacklogManager(coreSession)
@@ -148,3 +152,135 @@ QVariantList CoreBacklogManager::requestBacklogAllFiltered(MsgId first, MsgId la
 
     return backlog;
 }
+
+QVariantList CoreBacklogManager::requestBacklogSearch(BufferId bufferId, const QString& query, int limit, MsgId last)
+{
+    QVariantList backlog;
+    auto msgList = Core::searchMsgs(coreSession()->user(), bufferId, query, limit, last);
+
+    std::transform(msgList.cbegin(), msgList.cend(), std::back_inserter(backlog), [](auto&& msg) { return QVariant::fromValue(msg); });
+
+    return backlog;
+}
+
+void CoreBacklogManager::requestBacklogAllChunked(MsgId first, MsgId last, int limit, int additional, int chunkSize)
+{
+    Peer* peer = coreSession()->signalProxy()->sourcePeer();
+    if (!peer)
+        return;
+
+    BacklogStream stream{peer->id(), first, last, limit, additional, chunkSize > 0 ? chunkSize : DefaultChunkSize, last, limit};
+    _backlogStreams.push_back(stream);
+    // Pages are sent from the event loop, so other work of this session is not held up by a large request
+    if (_backlogStreams.size() == 1)
+        QTimer::singleShot(0, this, &CoreBacklogManager::processBacklogStreams);
+}
+
+void CoreBacklogManager::processBacklogStreams()
+{
+    if (_backlogStreams.empty())
+        return;
+
+    BacklogStream stream = _backlogStreams.front();
+    _backlogStreams.pop_front();
+
+    // The requesting client may have disconnected in the meantime
+    Peer* peer = coreSession()->signalProxy()->peerById(stream.peerId);
+    auto* remotePeer = qobject_cast<RemotePeer*>(peer);
+    if (remotePeer && remotePeer->isOpen() && remotePeer->queuedBytes() > RemotePeer::sendHighWaterMark) {
+        // Don't fetch pages faster than the client takes them, they'd only pile up in the peer's send queue
+        _pausedStreams.push_back(stream);
+        connect(remotePeer, &RemotePeer::sendQueueChanged, this, &CoreBacklogManager::onSendQueueChanged, Qt::UniqueConnection);
+        connect(remotePeer, &Peer::disconnected, this, &CoreBacklogManager::onPeerDisconnected, Qt::UniqueConnection);
+    }
+    else if (peer && peer->isOpen() && sendBacklogPage(peer, stream)) {
+        _backlogStreams.push_back(stream);
+    }
+
+    if (!_backlogStreams.empty())
+        QTimer::singleShot(0, this, &CoreBacklogManager::processBacklogStreams);
+}
+
+void CoreBacklogManager::onSendQueueChanged(qint64 queuedBytes)
+{
+    if (queuedBytes <= RemotePeer::sendLowWaterMark)
+        resumeBacklogStreams(qobject_cast<Peer*>(sender()));
+}
+
+void CoreBacklogManager::onPeerDisconnected()
+{
+    // processBacklogStreams() drops the streams once it finds the peer gone
+    resumeBacklogStreams(qobject_cast<Peer*>(sender()));
+}
+
+void CoreBacklogManager::resumeBacklogStreams(Peer* peer)
+{
+    if (!peer)
+        return;
+
+    disconnect(peer, nullptr, this, nullptr);
+
+    bool idle = _backlogStreams.empty();
+    auto it = std::stable_partition(_pausedStreams.begin(), _pausedStreams.end(), [peer](auto&& stream) {
+        return stream.peerId != peer->id();
+    });
+    std::move(it, _pausedStreams.end(), std::back_inserter(_backlogStreams));
+    _pausedStreams.erase(it, _pausedStreams.end());
+
+    if (idle && !_backlogStreams.empty())
+        QTimer::singleShot(0, this, &CoreBacklogManager::processBacklogStreams);
+}
+
+bool CoreBacklogManager::sendBacklogPage(Peer* peer, BacklogStream& stream)
+{
+    std::vector<Message> msgList;
+    bool phaseDone = true;
+    if (stream.remaining != 0) {
+        int pageSize = stream.remaining < 0 ? stream.chunkSize : std::min(stream.chunkSize, stream.remaining);
+        msgList = Core::requestAllMsgs(coreSession()->user(), stream.additionalPhase ? MsgId(-1) : stream.first, stream.cursor, pageSize);
+        phaseDone = static_cast<int>(msgList.size()) < pageSize;
+    }
+
+    QVariantList chunk;
+    int chunkBytes = 0;
+    for (auto&& msg : msgList) {
+        chunk << QVariant::fromValue(msg);
+        // Rough estimate of the serialized size, strings are transferred as UTF-16
+        chunkBytes += 64 + 2 * (msg.contents().size() + msg.sender().size() + msg.realName().size() + msg.avatarUrl().size());
+        if (chunkBytes >= MaxChunkBytes) {
+            sendBacklogChunk(peer, stream, chunk, false);
+            chunk.clear();
+            chunkBytes = 0;
+        }
+        if (!stream.cursor.isValid() || msg.msgId() < stream.cursor)
+            stream.cursor = msg.msgId();
+    }
+    if (stream.remaining > 0)
+        stream.remaining -= static_cast<int>(msgList.size());
+    if (stream.remaining == 0)
+        phaseDone = true;
+
+    // Like requestBacklogAll(), continue seamlessly with the additional messages once the requested range is exhausted
+    if (phaseDone && !stream.additionalPhase && stream.additional > 0) {
+        stream.additionalPhase = true;
+        if (stream.first != -1)
+            stream.cursor = stream.first;
+        stream.remaining = stream.additional;
+        phaseDone = false;
+    }
+
+    if (phaseDone) {
+        sendBacklogChunk(peer, stream, chunk, true);
+        return false;
+    }
+    if (!chunk.isEmpty())
+        sendBacklogChunk(peer, stream, chunk, false);
+    return true;
+}
+
+void CoreBacklogManager::sendBacklogChunk(Peer* peer, const BacklogStream& stream, const QVariantList& msgs, bool complete)
+{
+    coreSession()->signalProxy()->restrictTargetPeers(peer, [&] {
+        SYNC_OTHER(receiveBacklogAllChunk, ARG(stream.first), ARG(stream.last), ARG(stream.limit), ARG(stream.additional), ARG(msgs), ARG(complete))
+    });
+}
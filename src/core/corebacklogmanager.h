@@ -3,9 +3,12 @@
 
 #pragma once
 
+#include <deque>
+
 #include "backlogmanager.h"
 
 class CoreSession;
+class Peer;
 
 class CoreBacklogManager : public BacklogManager
 {
@@ -25,7 +28,47 @@ public slots:
     QVariantList requestBacklogAll(MsgId first = -1, MsgId last = -1, int limit = -1, int additional = 0) override;
     QVariantList requestBacklogAllFiltered(
         MsgId first = -1, MsgId last = -1, int limit = -1, int additional = 0, int type = -1, int flags = -1) override;
+    QVariantList requestBacklogSearch(BufferId bufferId, const QString& query, int limit = -1, MsgId last = -1) override;
+    void requestBacklogAllChunked(MsgId first = -1, MsgId last = -1, int limit = -1, int additional = 0, int chunkSize = -1) override;
+
+private slots:
+    void processBacklogStreams();
+    void onSendQueueChanged(qint64 queuedBytes);
+    void onPeerDisconnected();
 
 private:
+    /// A chunked backlog request that is still being delivered
+    struct BacklogStream
+    {
+        int peerId;
+        MsgId first;
+        MsgId last;
+        int limit;
+        int additional;
+        int chunkSize;
+        MsgId cursor;                 ///< Exclusive upper bound of the next page
+        int remaining;                ///< Messages left to send in the current phase, -1 for no limit
+        bool additionalPhase{false};  ///< Whether the additional messages are being sent
+    };
+
+    /// Default number of messages per chunk
+    static constexpr int DefaultChunkSize{500};
+
+    /// Maximum chunk size in bytes (estimated), chunks are split early when exceeding it
+    static constexpr int MaxChunkBytes{256 * 1024};
+
+    /**
+     * Fetches the next page of a backlog stream and sends it to the peer.
+     *
+     * @returns true if the stream has more messages to deliver
+     */
+    bool sendBacklogPage(Peer* peer, BacklogStream& stream);
+
+    /// Moves the paused streams of the given peer back into the rotation
+    void resumeBacklogStreams(Peer* peer);
+    void sendBacklogChunk(Peer* peer, const BacklogStream& stream, const QVariantList& msgs, bool complete);
+
     CoreSession* _coreSession;
+    std::deque<BacklogStream> _backlogStreams;  ///< Pending streams, served round-robin one page at a time
+    std::deque<BacklogStream> _pausedStreams;   ///< Streams waiting for their peer to catch up with the data already sent
 };
@@ -39,8 +39,33 @@ CoreBufferSyncer::CoreBufferSyncer(CoreSession* parent)
 void CoreBufferSyncer::requestSetLastSeenMsg(BufferId buffer, const MsgId& msgId)
 {
     if (setLastSeenMsg(buffer, msgId)) {
-        int activity = Core::bufferActivity(buffer, msgId);
-        int highlightCount = Core::highlightCount(buffer, msgId);
+        UnreadState& state = unreadState(buffer);
+
+        // Drop everything that is seen now
+        for (auto it = state.lastMsgIdByType.begin(); it != state.lastMsgIdByType.end();) {
+            if (it.value() <= msgId)
+                it = state.lastMsgIdByType.erase(it);
+            else
+                ++it;
+        }
+        state.unreadHighlights.erase(state.unreadHighlights.begin(),
+                                     std::upper_bound(state.unreadHighlights.begin(), state.unreadHighlights.end(), msgId));
+
+        int activity;
+        int highlightCount;
+        if (state.untrackedUpTo.isValid() && msgId < state.untrackedUpTo) {
+            // Some of the messages that predate tracking are still unread, only the storage backend knows about them
+            activity = Core::bufferActivity(buffer, msgId);
+            highlightCount = Core::highlightCount(buffer, msgId);
+        }
+        else {
+            state.untrackedUpTo = MsgId();
+            activity = Message::Types();
+            for (auto it = state.lastMsgIdByType.cbegin(); it != state.lastMsgIdByType.cend(); ++it) {
+                activity |= it.key();
+            }
+            highlightCount = static_cast<int>(state.unreadHighlights.size());
+        }
 
         setBufferActivity(buffer, activity);
         setHighlightCount(buffer, highlightCount);
@@ -49,6 +74,16 @@ void CoreBufferSyncer::requestSetLastSeenMsg(BufferId buffer, const MsgId& msgId
     }
 }
 
+CoreBufferSyncer::UnreadState& CoreBufferSyncer::unreadState(BufferId buffer)
+{
+    auto it = _unreadStates.find(buffer);
+    if (it == _unreadStates.end()) {
+        // Everything up to the last message known at startup was stored before we started tracking
+        it = _unreadStates.insert(buffer, UnreadState{lastMsg(buffer), {}, {}});
+    }
+    return *it;
+}
+
 void CoreBufferSyncer::requestSetMarkerLine(BufferId buffer, const MsgId& msgId)
 {
     if (setMarkerLine(buffer, msgId))
@@ -110,8 +145,10 @@ void CoreBufferSyncer::removeBuffer(BufferId bufferId)
             return;
         }
     }
-    if (Core::removeBuffer(_coreSession->user(), bufferId))
+    if (Core::removeBuffer(_coreSession->user(), bufferId)) {
+        _unreadStates.remove(bufferId);
         BufferSyncer::removeBuffer(bufferId);
+    }
 }
 
 void CoreBufferSyncer::renameBuffer(BufferId bufferId, QString newName)
@@ -149,6 +186,23 @@ void CoreBufferSyncer::mergeBuffersPermanently(BufferId bufferId1, BufferId buff
     }
 
     if (Core::mergeBuffersPermanently(_coreSession->user(), bufferId1, bufferId2)) {
+        // The messages of the second buffer now belong to the first one
+        UnreadState merged = unreadState(bufferId2);
+        UnreadState& state = unreadState(bufferId1);
+        state.untrackedUpTo = std::max(state.untrackedUpTo, merged.untrackedUpTo);
+        for (auto it = merged.lastMsgIdByType.cbegin(); it != merged.lastMsgIdByType.cend(); ++it) {
+            MsgId& lastMsgId = state.lastMsgIdByType[it.key()];
+            lastMsgId = std::max(lastMsgId, it.value());
+        }
+        std::vector<MsgId> highlights;
+        std::merge(state.unreadHighlights.cbegin(),
+                   state.unreadHighlights.cend(),
+                   merged.unreadHighlights.cbegin(),
+                   merged.unreadHighlights.cend(),
+                   std::back_inserter(highlights));
+        state.unreadHighlights = std::move(highlights);
+        _unreadStates.remove(bufferId2);
+
         BufferSyncer::mergeBuffersPermanently(bufferId1, bufferId2);
     }
 }
@@ -183,6 +237,7 @@ void CoreBufferSyncer::purgeBufferIds()
     QSet<BufferId> storedIds = toQSet(lastSeenBufferIds()) + toQSet(markerLineBufferIds());
     foreach (BufferId bufferId, storedIds) {
         if (actualBuffers.find(bufferId) == actualBuffers.end()) {
+            _unreadStates.remove(bufferId);
             BufferSyncer::removeBuffer(bufferId);
         }
     }
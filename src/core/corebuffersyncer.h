@@ -3,6 +3,10 @@
 
 #pragma once
 
+#include <vector>
+
+#include <QHash>
+
 #include "buffersyncer.h"
 
 class CoreSession;
@@ -23,10 +27,12 @@ public slots:
 
     void addBufferActivity(const Message& message)
     {
-        if (message.flags().testFlag(Message::Flag::Ignored)) {
-            // Don't update buffer activity with messages that are ignored
+        if (message.flags().testFlag(Message::Flag::Ignored) || message.flags().testFlag(Message::Flag::Self)) {
+            // Don't update buffer activity with messages that are ignored or sent by ourselves, matching what the
+            // storage backends report
             return;
         }
+        unreadState(message.bufferId()).lastMsgIdByType[message.type()] = message.msgId();
         auto oldActivity = activity(message.bufferId());
         if (!oldActivity.testFlag(message.type())) {
             setBufferActivity(message.bufferId(), (int)(oldActivity | message.type()));
@@ -41,6 +47,7 @@ public slots:
         }
         auto oldHighlightCount = highlightCount(message.bufferId());
         if (message.flags().testFlag(Message::Flag::Highlight) && !message.flags().testFlag(Message::Flag::Self)) {
+            unreadState(message.bufferId()).unreadHighlights.push_back(message.msgId());
             setHighlightCount(message.bufferId(), oldHighlightCount + 1);
         }
     }
@@ -71,9 +78,26 @@ protected:
     void customEvent(QEvent* event) override;
 
 private:
+    /**
+     * Unread messages of a buffer, as far as needed to derive its activity and highlight count.
+     *
+     * Only messages stored while the session is running are tracked. Older messages may still be
+     * unread, but their share of the activity and highlight count is only known to the storage backend.
+     */
+    struct UnreadState
+    {
+        MsgId untrackedUpTo;                  ///< Messages up to this id predate tracking, invalid once they are all seen
+        QHash<int, MsgId> lastMsgIdByType;    ///< Latest unread message per Message::Type
+        std::vector<MsgId> unreadHighlights;  ///< Unread highlights, in ascending order
+    };
+
+    UnreadState& unreadState(BufferId buffer);
+
     CoreSession* _coreSession;
     bool _purgeBuffers;
 
+    QHash<BufferId, UnreadState> _unreadStates;
+
     QSet<BufferId> dirtyLastSeenBuffers;
     QSet<BufferId> dirtyMarkerLineBuffers;
     QSet<BufferId> dirtyActivities;
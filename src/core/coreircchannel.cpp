@@ -3,12 +3,20 @@
 
 #include "coreircchannel.h"
 
+#include <QTimer>
+
 #include "corenetwork.h"
+#include "coresession.h"
+#include "ircuser.h"
+#include "peer.h"
 
 CoreIrcChannel::CoreIrcChannel(const QString& channelname, Network* network)
     : IrcChannel(channelname, network)
     , _receivedWelcomeMsg(false)
 {
+    connect(this, &IrcChannel::ircUsersJoined, this, &CoreIrcChannel::onIrcUsersJoined);
+    connect(this, &IrcChannel::ircUserParted, this, &CoreIrcChannel::scheduleUserCountSync);
+
 #ifdef HAVE_QCA2
     _cipher = nullptr;
 
@@ -39,6 +47,44 @@ CoreIrcChannel::~CoreIrcChannel()
 #endif
 }
 
+void CoreIrcChannel::onIrcUsersJoined(const QList<IrcUser*>& ircUsers)
+{
+    // Clients that know the members learn about the new users via the join
+    for (IrcUser* ircUser : ircUsers) {
+        for (int peerId : memberPeers())
+            ircUser->releaseTo(peerId);
+    }
+    scheduleUserCountSync();
+}
+
+void CoreIrcChannel::scheduleUserCountSync()
+{
+    // Joins and parts come in bursts on netsplits, so only send the final count
+    if (_userCountSyncScheduled)
+        return;
+    _userCountSyncScheduled = true;
+    QTimer::singleShot(0, this, &CoreIrcChannel::syncUserCount);
+}
+
+void CoreIrcChannel::syncUserCount()
+{
+    _userCountSyncScheduled = false;
+
+    // Don't bother with channels we've left in the meantime
+    auto* coreNetwork = qobject_cast<CoreNetwork*>(network());
+    if (!coreNetwork || coreNetwork->ircChannel(name()) != this)
+        return;
+
+    SignalProxy* proxy = coreNetwork->coreSession()->signalProxy();
+    QSet<Peer*> peers;
+    for (Peer* peer : proxy->peers()) {
+        if (peer && peer->hasFeature(Quassel::Feature::LazyChannelMembers) && !memberPeers().contains(peer->id()))
+            peers.insert(peer);
+    }
+    if (!peers.isEmpty())
+        proxy->restrictTargetPeers(peers, [this] { setUserCount(userCount()); });
+}
+
 #ifdef HAVE_QCA2
 Cipher* CoreIrcChannel::cipher() const
 {
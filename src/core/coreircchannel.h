@@ -25,8 +25,16 @@ public:
     inline bool receivedWelcomeMsg() const { return _receivedWelcomeMsg; }
     inline void setReceivedWelcomeMsg() { _receivedWelcomeMsg = true; }
 
+private slots:
+    void onIrcUsersJoined(const QList<IrcUser*>& ircUsers);
+    void scheduleUserCountSync();
+
+    /// Sends the number of users to the clients with lazy channel membership that don't know the members
+    void syncUserCount();
+
 private:
     bool _receivedWelcomeMsg;
+    bool _userCountSyncScheduled{false};
 
 #ifdef HAVE_QCA2
     mutable Cipher* _cipher;
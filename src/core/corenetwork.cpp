@@ -73,6 +73,7 @@ CoreNetwork::CoreNetwork(const NetworkId& networkid, CoreSession* session)
     connect(&socket, &QSslSocket::encrypted, this, &CoreNetwork::onSocketInitialized);
     connect(&socket, selectOverload<const QList<QSslError>&>(&QSslSocket::sslErrors), this, &CoreNetwork::onSslErrors);
     connect(this, &CoreNetwork::newEvent, coreSession()->eventManager(), &EventManager::postEvent);
+    connect(this, &CoreNetwork::newEvents, coreSession()->eventManager(), &EventManager::postEvents);
 
     // Custom rate limiting
     // These react to the user changing settings in the client
@@ -243,6 +244,8 @@ void CoreNetwork::connectToIrc(bool reconnecting)
         // hostname of the server. Qt's DNS cache also isn't used by the proxy so we don't need to refresh the entry.
         QHostInfo::fromName(server.host);
     }
+    _socketBuffer.clear();
+    _discardingLine = false;
     if (server.useSsl) {
         CoreIdentity* identity = identityPtr();
         if (identity) {
@@ -489,18 +492,56 @@ void CoreNetwork::setMyNick(const QString& mynick)
 
 void CoreNetwork::onSocketHasData()
 {
-    while (socket.canReadLine()) {
-        QByteArray s = socket.readLine();
-        if (_metricsServer) {
-            _metricsServer->receiveDataNetwork(userId(), s.size());
+    // Read everything that's available at once, connect bursts and bouncer playback easily amount to thousands of lines
+    QByteArray data = socket.readAll();
+    if (data.isEmpty()) {
+        return;
+    }
+    if (_metricsServer) {
+        _metricsServer->receiveDataNetwork(userId(), data.size());
+    }
+    if (!_socketBuffer.isEmpty()) {
+        data.prepend(_socketBuffer);
+        _socketBuffer.clear();
+    }
+
+    const QDateTime timestamp = QDateTime::currentDateTimeUtc();
+    QList<Event*> events;
+    qsizetype start = 0;
+    qsizetype end;
+    while ((end = data.indexOf('\n', start)) != -1) {
+        qsizetype length = end - start;
+        if (length > 0 && data.at(end - 1) == '\r') {
+            length--;
         }
-        if (s.endsWith("\r\n"))
-            s.chop(2);
-        else if (s.endsWith("\n"))
-            s.chop(1);
-        NetworkDataEvent* event = new NetworkDataEvent(EventManager::NetworkIncoming, this, s);
-        event->setTimestamp(QDateTime::currentDateTimeUtc());
-        emit newEvent(event);
+        if (_discardingLine) {
+            // This is the rest of an overlong line, whose beginning was already dropped
+            _discardingLine = false;
+        }
+        else if (length > maxLineLength) {
+            qWarning() << "Discarding overlong line of" << length << "bytes received from network" << networkName();
+        }
+        else {
+            // Events share the read buffer, rather than each getting a copy of their line
+            NetworkDataEvent* event = new NetworkDataEvent(EventManager::NetworkIncoming, this, data, start, length);
+            event->setTimestamp(timestamp);
+            events.append(event);
+        }
+        start = end + 1;
+    }
+    // Keep an incomplete line until the rest of it arrives, unless the server exceeds any sensible line length
+    if (start < data.size() && !_discardingLine) {
+        if (data.size() - start > maxLineLength) {
+            qWarning() << "Discarding overlong line received from network" << networkName();
+            _discardingLine = true;
+        }
+        else {
+            _socketBuffer = data.sliced(start);
+        }
+    }
+
+    if (!events.isEmpty()) {
+        emit newEvents(events);
     }
 }
 
@@ -1572,6 +1613,33 @@ void CoreNetwork::requestSetNetworkInfo(const NetworkInfo& info)
     }
 }
 
+void CoreNetwork::requestChannelMembers(const QString& channel) const
+{
+    IrcChannel* ircChannel = this->ircChannel(channel);
+    Peer* peer = coreSession()->signalProxy()->sourcePeer();
+    if (!ircChannel || !peer)
+        return;
+
+    QVariantMap users;
+    for (IrcUser* user : ircChannel->ircUsers()) {
+        users[user->nick()] = user->toVariantMap();
+        user->releaseTo(peer->id());
+    }
+    QVariantMap members{{"IrcUsers", users}, {"UserModes", ircChannel->initUserModes()}};
+    ircChannel->addMemberPeer(peer);
+
+    // Only the requesting client is interested in the members
+    coreSession()->signalProxy()->restrictTargetPeers(peer, [&] { SYNC_OTHER(setChannelMembers, ARG(channel), ARG(members)) });
+}
+
+void CoreNetwork::forgetPeer(int peerId)
+{
+    for (IrcUser* ircUser : ircUsers())
+        ircUser->releaseTo(peerId);
+    for (IrcChannel* ircChannel : ircChannels())
+        ircChannel->removeMemberPeer(peerId);
+}
+
 QList<QList<QByteArray>> CoreNetwork::splitMessage(const QString& cmd,
                                                    const QString& message,
                                                    const std::function<QList<QByteArray>(QString&)>& cmdGenerator)
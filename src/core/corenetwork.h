@@ -161,6 +161,16 @@ public:
      */
     void retryCapsIndividually();
 
+    /**
+     * Drops all per-client state of a disconnected client.
+     *
+     * Peer IDs are never reused, so the IDs remembered for lazy channel membership would otherwise
+     * pile up in the network's IrcUsers and IrcChannels for as long as the session runs.
+     *
+     * @param peerId The ID of the disconnected client's peer
+     */
+    void forgetPeer(int peerId);
+
     /**
      * List of capabilities requiring further core<->server messages to configure.
      *
@@ -180,6 +190,7 @@ public slots:
     void requestConnect() const override;
     void requestDisconnect() const override;
     void requestSetNetworkInfo(const NetworkInfo& info) override;
+    void requestChannelMembers(const QString& channel) const override;
 
     void setUseAutoReconnect(bool) override;
     void setAutoReconnectInterval(quint32) override;
@@ -417,6 +428,7 @@ signals:
     void sslErrors(const QVariant& errorData);
 
     void newEvent(Event* event);
+    void newEvents(const QList<Event*>& events);
     void socketInitialized(const CoreIdentity* identity,
                            const QHostAddress& localAddress,
                            quint16 localPort,
@@ -493,6 +505,11 @@ private:
 
     QSslSocket socket;
     qint64 _socketId{0};
+    QByteArray _socketBuffer;     ///< Incomplete line left over from the last read
+    bool _discardingLine{false};  ///< Whether the rest of an overlong line is being skipped
+
+    /// Longest line accepted from the server: 8191 bytes of message tags (IRCv3), plus 512 bytes for the rest (RFC 1459)
+    static constexpr qsizetype maxLineLength{8191 + 512};
 
     CoreUserInputHandler* _userInputHandler;
     MetricsServer* _metricsServer;
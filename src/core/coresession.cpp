@@ -7,6 +7,7 @@
 
 #include <QRegularExpressionMatch>
 
+#include "backlogpruner.h"
 #include "core.h"
 #include "corebacklogmanager.h"
 #include "corebuffersyncer.h"
@@ -78,6 +79,7 @@ CoreSession::CoreSession(UserId uid, bool restoreState, bool strictIdentEnabled,
 
     p->attachSlot(SIGNAL(sendInput(BufferInfo, QString)), this, &CoreSession::msgFromClient);
     p->attachSignal(this, &CoreSession::displayMsg);
+    p->attachSignal(this, &CoreSession::displayMsgs);
     p->attachSignal(this, &CoreSession::displayStatusMsg);
 
     p->attachSignal(this, &CoreSession::identityCreated);
@@ -98,6 +100,10 @@ CoreSession::CoreSession(UserId uid, bool restoreState, bool strictIdentEnabled,
     p->attachSlot(SIGNAL(kickClient(int)), this, &CoreSession::kickClient);
     p->attachSignal(this, &CoreSession::disconnectFromCore);
 
+    p->attachSlot(SIGNAL(setBacklogRetention(QVariantMap)), this, &CoreSession::setBacklogRetention);
+    p->attachSlot(SIGNAL(requestBacklogRetention()), this, &CoreSession::requestBacklogRetention);
+    p->attachSignal(this, &CoreSession::backlogRetentionSet);
+
     QVariantMap data;
     data["quasselVersion"] = Quassel::buildInfo().fancyVersionString;
     data["quasselBuildDate"] = Quassel::buildInfo().commitDate;  // "BuildDate" for compatibility
@@ -107,6 +113,15 @@ CoreSession::CoreSession(UserId uid, bool restoreState, bool strictIdentEnabled,
 
     loadSettings();
 
+    for (auto&& bufferInfo : Core::requestBuffers(user())) {
+        _bufferInfoCache[bufferInfo.networkId()].insert(bufferInfo.bufferName().toLower(), bufferInfo);
+    }
+    connect(_bufferSyncer, &BufferSyncer::bufferRemoved, this, &CoreSession::invalidateBufferInfo);
+    connect(_bufferSyncer, &BufferSyncer::bufferRenamed, this, &CoreSession::invalidateBufferInfo);
+    connect(_bufferSyncer, &BufferSyncer::buffersPermanentlyMerged, this, [this](BufferId, BufferId mergedBuffer) {
+        invalidateBufferInfo(mergedBuffer);
+    });
+
     eventManager()->registerObject(ircParser(), EventManager::NormalPriority);
     eventManager()->registerObject(sessionEventProcessor(), EventManager::HighPriority);  // needs to process events *before* the stringifier!
     eventManager()->registerObject(ctcpParser(), EventManager::NormalPriority);
@@ -251,6 +266,7 @@ void CoreSession::addClient(RemotePeer* peer)
 
     if (_metricsServer) {
         _metricsServer->addClient(user());
+        connect(peer, &RemotePeer::sendQueueChanged, this, &CoreSession::updateClientSendQueue);
     }
 }
 
@@ -267,11 +283,26 @@ void CoreSession::removeClient(Peer* peer)
         qInfo() << qPrintable(tr("Client")) << p->description() << qPrintable(tr("disconnected (UserId: %1).").arg(user().toInt()));
     _coreInfo->setConnectedClientData(signalProxy()->peerCount(), signalProxy()->peerData());
 
+    for (CoreNetwork* net : _networks)
+        net->forgetPeer(peer->id());
+
     if (_metricsServer) {
         _metricsServer->removeClient(user());
+        updateClientSendQueue();
     }
 }
 
+void CoreSession::updateClientSendQueue()
+{
+    qint64 queuedBytes = 0;
+    for (Peer* peer : signalProxy()->peers()) {
+        auto* remotePeer = qobject_cast<RemotePeer*>(peer);
+        if (remotePeer)
+            queuedBytes += remotePeer->queuedBytes();
+    }
+    _metricsServer->clientSendQueue(user(), queuedBytes);
+}
+
 QHash<QString, QString> CoreSession::persistentChannels(NetworkId id) const
 {
     return Core::persistentChannels(user(), id);
@@ -369,91 +400,126 @@ void CoreSession::customEvent(QEvent* event)
 
 void CoreSession::processMessages()
 {
-    if (_messageQueue.count() == 1) {
-        const RawMessage& rawMsg = _messageQueue.first();
+    auto toMessage = [this](const RawMessage& rawMsg, const BufferInfo& bufferInfo) {
+        return Message(rawMsg.timestamp,
+                       bufferInfo,
+                       rawMsg.type,
+                       rawMsg.text,
+                       rawMsg.sender,
+                       senderPrefixes(rawMsg.sender, bufferInfo),
+                       realName(rawMsg.sender, rawMsg.networkId),
+                       avatarUrl(rawMsg.sender, rawMsg.networkId),
+                       rawMsg.flags);
+    };
+
+    MessageList messages;
+    QList<RawMessage> redirectedMessages;  // list of Messages which don't enforce a buffer creation
+    for (const RawMessage& rawMsg : _messageQueue) {
         bool createBuffer = !(rawMsg.flags & Message::Redirected);
-        BufferInfo bufferInfo = Core::bufferInfo(user(), rawMsg.networkId, rawMsg.bufferType, rawMsg.target, createBuffer);
+        if (!createBuffer && _redirectFallbackCache.value(rawMsg.networkId).contains(rawMsg.target.toLower())) {
+            // Already known not to have a buffer, don't ask the database again
+            redirectedMessages << rawMsg;
+            continue;
+        }
+        BufferInfo bufferInfo = cachedBufferInfo(rawMsg.networkId, rawMsg.bufferType, rawMsg.target, createBuffer);
         if (!bufferInfo.isValid()) {
             Q_ASSERT(!createBuffer);
-            bufferInfo = Core::bufferInfo(user(), rawMsg.networkId, BufferInfo::StatusBuffer, "");
+            redirectedMessages << rawMsg;
+            continue;
         }
-        Message msg(rawMsg.timestamp,
-                    bufferInfo,
-                    rawMsg.type,
-                    rawMsg.text,
-                    rawMsg.sender,
-                    senderPrefixes(rawMsg.sender, bufferInfo),
-                    realName(rawMsg.sender, rawMsg.networkId),
-                    avatarUrl(rawMsg.sender, rawMsg.networkId),
-                    rawMsg.flags);
-        if (Core::storeMessage(msg))
-            emit displayMsg(msg);
+        messages << toMessage(rawMsg, bufferInfo);
     }
-    else {
-        QHash<NetworkId, QHash<QString, BufferInfo>> bufferInfoCache;
-        MessageList messages;
-        QList<RawMessage> redirectedMessages;  // list of Messages which don't enforce a buffer creation
-        BufferInfo bufferInfo;
-        for (int i = 0; i < _messageQueue.count(); i++) {
-            const RawMessage& rawMsg = _messageQueue.at(i);
-            if (bufferInfoCache.contains(rawMsg.networkId) && bufferInfoCache[rawMsg.networkId].contains(rawMsg.target)) {
-                bufferInfo = bufferInfoCache[rawMsg.networkId][rawMsg.target];
-            }
-            else {
-                bool createBuffer = !(rawMsg.flags & Message::Redirected);
-                bufferInfo = Core::bufferInfo(user(), rawMsg.networkId, rawMsg.bufferType, rawMsg.target, createBuffer);
-                if (!bufferInfo.isValid()) {
-                    Q_ASSERT(!createBuffer);
-                    redirectedMessages << rawMsg;
-                    continue;
-                }
-                bufferInfoCache[rawMsg.networkId][rawMsg.target] = bufferInfo;
+
+    // recheck if there exists a buffer to store a redirected message in, as it may have been created by now
+    for (const RawMessage& rawMsg : redirectedMessages) {
+        const QString key = rawMsg.target.toLower();
+        BufferInfo bufferInfo = _bufferInfoCache.value(rawMsg.networkId).value(key);
+        if (!bufferInfo.isValid()) {
+            // no luck -> we store them in the StatusBuffer
+            QHash<QString, BufferInfo>& fallbacks = _redirectFallbackCache[rawMsg.networkId];
+            bufferInfo = fallbacks.value(key);
+            if (!bufferInfo.isValid()) {
+                bufferInfo = cachedBufferInfo(rawMsg.networkId, BufferInfo::StatusBuffer, "");
+                // remember the fallback in case there are more messages for the original target
+                if (bufferInfo.isValid())
+                    fallbacks.insert(key, bufferInfo);
             }
-            Message msg(rawMsg.timestamp,
-                        bufferInfo,
-                        rawMsg.type,
-                        rawMsg.text,
-                        rawMsg.sender,
-                        senderPrefixes(rawMsg.sender, bufferInfo),
-                        realName(rawMsg.sender, rawMsg.networkId),
-                        avatarUrl(rawMsg.sender, rawMsg.networkId),
-                        rawMsg.flags);
-            messages << msg;
         }
+        messages << toMessage(rawMsg, bufferInfo);
+    }
 
-        // recheck if there exists a buffer to store a redirected message in
-        for (int i = 0; i < redirectedMessages.count(); i++) {
-            const RawMessage& rawMsg = redirectedMessages.at(i);
-            if (bufferInfoCache.contains(rawMsg.networkId) && bufferInfoCache[rawMsg.networkId].contains(rawMsg.target)) {
-                bufferInfo = bufferInfoCache[rawMsg.networkId][rawMsg.target];
-            }
-            else {
-                // no luck -> we store them in the StatusBuffer
-                bufferInfo = Core::bufferInfo(user(), rawMsg.networkId, BufferInfo::StatusBuffer, "");
-                // add the StatusBuffer to the Cache in case there are more Messages for the original target
-                bufferInfoCache[rawMsg.networkId][rawMsg.target] = bufferInfo;
-            }
-            Message msg(rawMsg.timestamp,
-                        bufferInfo,
-                        rawMsg.type,
-                        rawMsg.text,
-                        rawMsg.sender,
-                        senderPrefixes(rawMsg.sender, bufferInfo),
-                        realName(rawMsg.sender, rawMsg.networkId),
-                        avatarUrl(rawMsg.sender, rawMsg.networkId),
-                        rawMsg.flags);
-            messages << msg;
+    _processMessages = false;
+    _messageQueue.clear();
+
+    // Messages are committed by the storage writer together with those of other sessions; they can only be
+    // shown once they have been assigned their MsgIds
+    Core::storeMessagesAsync(this, std::move(messages), [this](bool success, const MessageList& storedMessages) {
+        if (!success)
+            return;
+        displayMessages(storedMessages);
+    });
+}
+
+void CoreSession::displayMessages(const MessageList& messages)
+{
+    if (messages.isEmpty())
+        return;
+
+    QSet<Peer*> batchPeers;
+    QSet<Peer*> legacyPeers;
+    for (Peer* peer : signalProxy()->peers()) {
+        if (peer->hasFeature(Quassel::Feature::BatchedMessages))
+            batchPeers.insert(peer);
+        else
+            legacyPeers.insert(peer);
+    }
+
+    if (!batchPeers.isEmpty()) {
+        // Sent as a list of variants, which all protocols know how to (de)serialize
+        QVariantList batch;
+        batch.reserve(messages.size());
+        for (const Message& msg : messages)
+            batch << QVariant::fromValue(msg);
+        signalProxy()->restrictTargetPeers(batchPeers, [&] { emit displayMsgs(batch); });
+    }
+
+    // displayMsg() is also used within the core, so it needs to be emitted even if no older clients are connected
+    signalProxy()->restrictTargetPeers(legacyPeers, [&] {
+        for (const Message& msg : messages) {
+            emit displayMsg(msg);
         }
+    });
+}
 
-        if (Core::storeMessages(messages)) {
-            // FIXME: extend protocol to a displayMessages(MessageList)
-            for (int i = 0; i < messages.count(); i++) {
-                emit displayMsg(messages[i]);
+BufferInfo CoreSession::cachedBufferInfo(NetworkId networkId, BufferInfo::Type type, const QString& bufferName, bool create)
+{
+    QHash<QString, BufferInfo>& networkBuffers = _bufferInfoCache[networkId];
+    const QString key = bufferName.toLower();
+    auto it = networkBuffers.constFind(key);
+    if (it != networkBuffers.constEnd())
+        return *it;
+
+    BufferInfo bufferInfo = Core::bufferInfo(user(), networkId, type, bufferName, create);
+    if (bufferInfo.isValid()) {
+        networkBuffers.insert(key, bufferInfo);
+        // Messages redirected to this target can go to its own buffer from now on
+        _redirectFallbackCache[networkId].remove(key);
+    }
+    return bufferInfo;
+}
+
+void CoreSession::invalidateBufferInfo(BufferId bufferId)
+{
+    // A renamed or merged buffer may now be the one a redirect target should go to
+    _redirectFallbackCache.clear();
+    for (auto&& networkBuffers : _bufferInfoCache) {
+        for (auto it = networkBuffers.begin(); it != networkBuffers.end(); ++it) {
+            if (it->bufferId() == bufferId) {
+                networkBuffers.erase(it);
+                return;
             }
         }
     }
-    _processMessages = false;
-    _messageQueue.clear();
 }
 
 QString CoreSession::senderPrefixes(const QString& sender, const BufferInfo& bufferInfo) const
@@ -665,6 +731,8 @@ void CoreSession::destroyNetwork(NetworkId id)
         for (BufferId bufferId : Core::requestBufferIdsForNetwork(user(), id)) {
             _bufferSyncer->removeBuffer(bufferId);
         }
+        _bufferInfoCache.remove(id);
+        _redirectFallbackCache.remove(id);
         emit networkRemoved(id);
         net->deleteLater();
     }
@@ -672,7 +740,7 @@ void CoreSession::destroyNetwork(NetworkId id)
 
 void CoreSession::renameBuffer(const NetworkId& networkId, const QString& newName, const QString& oldName)
 {
-    BufferInfo bufferInfo = Core::bufferInfo(user(), networkId, BufferInfo::QueryBuffer, oldName, false);
+    BufferInfo bufferInfo = cachedBufferInfo(networkId, BufferInfo::QueryBuffer, oldName, false);
     if (bufferInfo.isValid()) {
         _bufferSyncer->renameBuffer(bufferInfo.bufferId(), newName);
     }
@@ -770,3 +838,16 @@ void CoreSession::kickClient(int peerId)
     }
     signalProxy()->restrictTargetPeers(peer, [&] { emit disconnectFromCore(); });
 }
+
+void CoreSession::setBacklogRetention(const QVariantMap& settings)
+{
+    QVariantMap sanitized = BacklogPruner::sanitizeSettings(settings);
+    Core::setUserSetting(user(), BacklogPruner::SettingName, sanitized);
+    emit backlogRetentionSet(sanitized);
+}
+
+void CoreSession::requestBacklogRetention()
+{
+    QVariantMap settings = Core::getUserSetting(user(), BacklogPruner::SettingName).toMap();
+    signalProxy()->restrictTargetPeers(signalProxy()->sourcePeer(), [&] { emit backlogRetentionSet(settings); });
+}
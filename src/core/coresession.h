@@ -134,6 +134,20 @@ public slots:
 
     void kickClient(int peerId);
 
+    /**
+     * Sets the user's backlog retention policy, overriding the core-wide one.
+     *
+     * The new policy is applied by the next retention pass, and propagated to the clients.
+     *
+     * @param settings Map holding "MaxAge" (in days) and "MaxRows", optionally overridden per buffer type by nested maps named
+     *                 "StatusBuffer", "ChannelBuffer", "QueryBuffer" and "GroupBuffer". 0 means unlimited, and missing keys
+     *                 fall back to the core-wide policy.
+     */
+    void setBacklogRetention(const QVariantMap& settings);
+
+    /// Sends the user's backlog retention policy to the requesting client
+    void requestBacklogRetention();
+
     QHash<QString, QString> persistentChannels(NetworkId) const;
 
     QHash<QString, QByteArray> bufferCiphers(NetworkId id) const;
@@ -153,6 +167,8 @@ signals:
 
     // void msgFromGui(uint netid, QString buf, QString message);
     void displayMsg(Message message);
+    /// Sends a batch of new messages (as Message variants) to clients supporting the BatchedMessages feature
+    void displayMsgs(QVariantList messages);
     void displayStatusMsg(QString, QString);
 
     //! Identity has been created.
@@ -173,6 +189,9 @@ signals:
 
     void passwordChanged(PeerPtr peer, bool success);
 
+    /// The user's backlog retention policy has been set, see setBacklogRetention() for its format
+    void backlogRetentionSet(const QVariantMap& settings);
+
     void disconnectFromCore();
 
 protected:
@@ -180,6 +199,8 @@ protected:
 
 private slots:
     void removeClient(Peer* peer);
+    /// Reports the amount of data held back for slow clients to the metrics server
+    void updateClientSendQueue();
 
     void recvStatusMsgFromServer(QString msg);
     void recvMessageFromServer(RawMessage msg);
@@ -195,8 +216,23 @@ private slots:
 
     void onNetworkDisconnected(NetworkId networkId);
 
+    /// Drops a buffer that was removed, renamed or merged away from the BufferInfo cache
+    void invalidateBufferInfo(BufferId bufferId);
+
 private:
     void processMessages();
+    void displayMessages(const MessageList& messages);
+
+    /**
+     * Looks up a buffer in the session's BufferInfo cache, falling back to the storage backend on a miss.
+     *
+     * @param networkId  The network the buffer belongs to
+     * @param type       The buffer type, used when creating the buffer
+     * @param bufferName The buffer name, matched case-insensitively
+     * @param create     Whether the buffer shall be created if it doesn't exist yet
+     * @returns The BufferInfo of the buffer, or an invalid BufferInfo if it doesn't exist and wasn't created
+     */
+    BufferInfo cachedBufferInfo(NetworkId networkId, BufferInfo::Type type, const QString& bufferName, bool create = true);
 
     void loadSettings();
 
@@ -253,6 +289,9 @@ private:
     QString avatarUrl(const QString& sender, NetworkId networkId) const;
     QList<RawMessage> _messageQueue;
     bool _processMessages;
+    QHash<NetworkId, QHash<QString, BufferInfo>> _bufferInfoCache;  ///< Known buffers by network and lowercased name
+    /// Status buffers that stand in for redirect targets without a buffer of their own, by network and lowercased target
+    QHash<NetworkId, QHash<QString, BufferInfo>> _redirectFallbackCache;
     CoreIgnoreListManager _ignoreListManager;
     CoreHighlightRuleManager _highlightRuleManager;
     MetricsServer* _metricsServer{nullptr};
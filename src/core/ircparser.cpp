@@ -3,6 +3,8 @@
 
 #include "ircparser.h"
 
+#include <optional>
+
 #include <QDebug>
 #include <QRegularExpressionMatch>
 
@@ -33,10 +35,10 @@ IrcParser::IrcParser(CoreSession* session)
     connect(this, &IrcParser::newEvent, coreSession()->eventManager(), &EventManager::postEvent);
 }
 
-bool IrcParser::checkParamCount(const QString& cmd, const QList<QByteArray>& params, int minParams)
+bool IrcParser::checkParamCount(const IrcMessageView& msg, int minParams)
 {
-    if (params.count() < minParams) {
-        qWarning() << "Expected" << minParams << "params for IRC command" << cmd << ", got:" << params;
+    if (msg.paramCount() < minParams) {
+        qWarning() << "Expected" << minParams << "params for IRC command" << msg.command() << ", got:" << msg.params();
         return false;
     }
     return true;
@@ -74,10 +76,17 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
         return;
     }
 
+    // Lines read together are dispatched one after another, and an earlier one may have caused us to abort the connection
+    if (net->socketState() == QAbstractSocket::UnconnectedState) {
+        return;
+    }
+
     // note that the IRC server is still alive
     net->resetPingTimeout();
 
-    const QByteArray rawMsg = e->data();
+    // The event owns the line, and outlives the parsing
+    const QByteArrayView line = e->dataView();
+    const QByteArray rawMsg = QByteArray::fromRawData(line.data(), line.size());
     if (rawMsg.isEmpty()) {
         qWarning() << "Received empty string from server!";
         return;
@@ -89,39 +98,55 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
         qDebug() << "IRC net" << net->networkId() << "<<" << rawMsg;
     }
 
-    QHash<IrcTagKey, QString> tags;
-    QString prefix;
-    QString cmd;
-    QList<QByteArray> params;
-    IrcDecoder::parseMessage([&net](const QByteArray& data) { return net->serverDecode(data); }, rawMsg, tags, prefix, cmd, params);
+    const auto decode = [&net](const QByteArray& data) { return net->serverDecode(data); };
+    const IrcMessageView view = IrcDecoder::parseView(rawMsg);
 
     // Log the message if enabled and network ID matches or allows all
     if (_debugLogParsedIrc && (_debugLogParsedNetId == -1 || net->networkId().toInt() == _debugLogParsedNetId)) {
         // Include network ID
-        qDebug() << "IRC net" << net->networkId() << "<<" << tags << prefix << cmd << params;
+        qDebug() << "IRC net" << net->networkId() << "<<" << view.tags(decode) << view.decodedPrefix(decode)
+                 << view.decodedCommand(decode) << view.params();
     }
 
-    if (net->capEnabled(IrcCap::SERVER_TIME) && tags.contains(IrcTags::SERVER_TIME)) {
-        QDateTime serverTime = QDateTime::fromString(tags[IrcTags::SERVER_TIME], "yyyy-MM-ddThh:mm:ss.zzzZ");
+    // Fields are decoded when first needed, and parameters are passed to the decoders without copying them
+    std::optional<QHash<IrcTagKey, QString>> decodedTags;
+    auto tags = [&]() -> const QHash<IrcTagKey, QString>& {
+        if (!decodedTags)
+            decodedTags = view.tags(decode);
+        return *decodedTags;
+    };
+    std::optional<QString> decodedPrefix;
+    auto prefix = [&]() -> const QString& {
+        if (!decodedPrefix)
+            decodedPrefix = view.decodedPrefix(decode);
+        return *decodedPrefix;
+    };
+    int firstParam = 0;
+    auto paramCount = [&]() { return view.paramCount() - firstParam; };
+    auto param = [&](int index) { return view.rawParam(firstParam + index); };
+
+    if (net->capEnabled(IrcCap::SERVER_TIME) && view.hasTag(IrcTags::SERVER_TIME)) {
+        QString serverTimeTag = view.tagValue(IrcTags::SERVER_TIME, decode);
+        QDateTime serverTime = QDateTime::fromString(serverTimeTag, "yyyy-MM-ddThh:mm:ss.zzzZ");
         serverTime.setTimeZone(QTimeZone::utc());
         if (serverTime.isValid()) {
             e->setTimestamp(serverTime);
         }
         else {
-            qDebug() << "Invalid timestamp from server-time tag:" << tags[IrcTags::SERVER_TIME];
+            qDebug() << "Invalid timestamp from server-time tag:" << serverTimeTag;
         }
     }
 
-    if (net->capEnabled(IrcCap::ACCOUNT_TAG) && tags.contains(IrcTags::ACCOUNT)) {
+    if (net->capEnabled(IrcCap::ACCOUNT_TAG) && view.hasTag(IrcTags::ACCOUNT)) {
         // Whenever account-tag is specified, update the relevant IrcUser if it exists
         // Logged-out status is handled in specific commands (PRIVMSG, NOTICE, etc)
         //
         // Don't use "updateNickFromMask" here to ensure this only updates existing IrcUsers and
         // won't create a new IrcUser.  This guards against an IRC server setting "account" tag in
         // nonsensical places, e.g. for messages that are not user sent.
-        IrcUser* ircuser = net->ircUser(prefix);
+        IrcUser* ircuser = net->ircUser(prefix());
         if (ircuser) {
-            ircuser->setAccount(tags[IrcTags::ACCOUNT]);
+            ircuser->setAccount(view.tagValue(IrcTags::ACCOUNT, decode));
         }
 
         // NOTE: if "account-tag" is enabled and no "account" tag is sent, the given user isn't
@@ -136,24 +161,23 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
     EventManager::EventType type = EventManager::Invalid;
 
     QString messageTarget;
-    uint num = cmd.toUInt();
+    uint num = view.command().toUInt();
     if (num > 0) {
         // numeric reply
-        if (params.count() == 0) {
+        if (paramCount() == 0) {
             qWarning() << "Message received from server violates RFC and is ignored!" << rawMsg;
             return;
         }
         // numeric replies have the target as first param (RFC 2812 - 2.4). this is usually our own nick. Remove this!
-        messageTarget = net->serverDecode(params.takeFirst());
+        messageTarget = net->serverDecode(param(0));
+        firstParam = 1;
         type = EventManager::IrcEventNumeric;
     }
     else {
         // any other irc command
-        QString typeName = QLatin1String("IrcEvent") + cmd.at(0).toUpper() + cmd.mid(1).toLower();
-        type = EventManager::eventTypeByName(typeName);
+        type = EventManager::ircEventTypeByCommand(view.command());
         if (type == EventManager::Invalid) {
-            type = EventManager::eventTypeByName("IrcEventUnknown");
-            Q_ASSERT(type != EventManager::Invalid);
+            type = EventManager::IrcEventUnknown;
         }
     }
 
@@ -170,18 +194,18 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
     case EventManager::IrcEventPrivmsg:
         defaultHandling = false;  // this might create a list of events
 
-        if (checkParamCount(cmd, params, 1)) {
-            QString senderNick = nickFromMask(prefix);
+        if (checkParamCount(view, 1)) {
+            QString senderNick = nickFromMask(prefix());
             // Fetch/create the relevant IrcUser, and store it for later updates
-            IrcUser* ircuser = net->updateNickFromMask(prefix);
+            IrcUser* ircuser = net->updateNickFromMask(prefix());
 
             // Handle account-tag
             if (ircuser && net->capEnabled(IrcCap::ACCOUNT_TAG)) {
-                if (tags.contains(IrcTags::ACCOUNT)) {
+                if (tags().contains(IrcTags::ACCOUNT)) {
                     // Account tag available, set account.
                     // This duplicates the generic account-tag handling in case a new IrcUser object
                     // was just created.
-                    ircuser->setAccount(tags[IrcTags::ACCOUNT]);
+                    ircuser->setAccount(tags()[IrcTags::ACCOUNT]);
                 }
                 else {
                     // PRIVMSG is user sent; it's safe to assume the user has logged out.
@@ -195,9 +219,10 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
             // Cache the result to avoid multiple redundant comparisons
             bool isSelfMessage = net->isMyNick(senderNick);
 
-            QByteArray msg = params.count() < 2 ? QByteArray() : params.at(1);
+            // The message is carried along by the event, so it needs its own copy
+            QByteArray msg = paramCount() < 2 ? QByteArray() : view.param(1).toByteArray();
 
-            QStringList targets = net->serverDecode(params.at(0)).split(',', Qt::SkipEmptyParts);
+            QStringList targets = net->serverDecode(param(0)).split(',', Qt::SkipEmptyParts);
             QStringList::const_iterator targetIter;
             for (targetIter = targets.constBegin(); targetIter != targets.constEnd(); ++targetIter) {
                 // For self-messages, keep the target, don't set it to the senderNick
@@ -208,7 +233,7 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
                 msg = decrypt(net, target, msg);
 
                 IrcEventRawMessage* rawMessage
-                    = new IrcEventRawMessage(EventManager::IrcEventRawPrivmsg, net, tags, msg, prefix, target, e->timestamp());
+                    = new IrcEventRawMessage(EventManager::IrcEventRawPrivmsg, net, tags(), msg, prefix(), target, e->timestamp());
                 if (isSelfMessage) {
                     // Self-messages need processed differently, tag as such via flag.
                     rawMessage->setFlag(EventManager::Self);
@@ -221,16 +246,16 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
     case EventManager::IrcEventNotice:
         defaultHandling = false;
 
-        if (checkParamCount(cmd, params, 2)) {
+        if (checkParamCount(view, 2)) {
             // Check if the sender is our own nick.  If so, treat message as if sent by ourself.
             // See http://ircv3.net/specs/extensions/echo-message-3.2.html
             // Cache the result to avoid multiple redundant comparisons
-            bool isSelfMessage = net->isMyNick(nickFromMask(prefix));
+            bool isSelfMessage = net->isMyNick(nickFromMask(prefix()));
 
             // Only update from the prefix once during the loop
             bool updatedFromPrefix = false;
 
-            QStringList targets = net->serverDecode(params.at(0)).split(',', Qt::SkipEmptyParts);
+            QStringList targets = net->serverDecode(param(0)).split(',', Qt::SkipEmptyParts);
             QStringList::const_iterator targetIter;
             for (targetIter = targets.constBegin(); targetIter != targets.constEnd(); ++targetIter) {
                 QString target = *targetIter;
@@ -239,7 +264,7 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
                 // :ChanServ!ChanServ@services. NOTICE egst :[#apache] Welcome, this is #apache. Please read the in-channel topic message.
                 // This channel is being logged by IRSeekBot. If you have any question please see http://blog.freenode.net/?p=68
                 if (!net->isChannelName(target)) {
-                    QString decMsg = net->serverDecode(params.at(1));
+                    QString decMsg = net->serverDecode(param(1));
                     QRegularExpression welcomeRegExp(R"(^\[([^\]]+)\] )");
                     QRegularExpressionMatch match = welcomeRegExp.match(decMsg);
                     if (match.hasMatch()) {
@@ -250,13 +275,13 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
                             net->ircChannel(channelname));  // NOLINT(cppcoreguidelines-pro-type-static-cast-downcast)
                         if (chan && !chan->receivedWelcomeMsg()) {
                             chan->setReceivedWelcomeMsg();
-                            events << new MessageEvent(Message::Notice, net, decMsg, prefix, channelname, Message::None, e->timestamp());
+                            events << new MessageEvent(Message::Notice, net, decMsg, prefix(), channelname, Message::None, e->timestamp());
                             continue;
                         }
                     }
                 }
 
-                if (prefix.isEmpty() || target == "AUTH") {
+                if (prefix().isEmpty() || target == "AUTH") {
                     target = QString();
                 }
                 else {
@@ -266,7 +291,7 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
                     if (!net->isChannelName(target)) {
                         // For self-messages, keep the target, don't set it to the sender prefix
                         if (!isSelfMessage) {
-                            target = nickFromMask(prefix);
+                            target = nickFromMask(prefix());
                         }
 
                         if (!updatedFromPrefix) {
@@ -274,15 +299,15 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
                             updatedFromPrefix = true;
 
                             // Fetch/create the relevant IrcUser, and store it for later updates
-                            IrcUser* ircuser = net->updateNickFromMask(prefix);
+                            IrcUser* ircuser = net->updateNickFromMask(prefix());
 
                             // Handle account-tag
                             if (ircuser && net->capEnabled(IrcCap::ACCOUNT_TAG)) {
-                                if (tags.contains(IrcTags::ACCOUNT)) {
+                                if (tags().contains(IrcTags::ACCOUNT)) {
                                     // Account tag available, set account.
                                     // This duplicates the generic account-tag handling in case a
                                     // new IrcUser object was just created.
-                                    ircuser->setAccount(tags[IrcTags::ACCOUNT]);
+                                    ircuser->setAccount(tags()[IrcTags::ACCOUNT]);
                                 }
                                 else {
                                     // NOTICE is user sent; it's safe to assume the user has
@@ -298,17 +323,18 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
                 // Handle DH1080 key exchange
                 // Don't allow key exchange in channels, and don't allow it for self-messages.
                 bool keyExchangeAllowed = (!net->isChannelName(target) && !isSelfMessage);
-                if (params[1].startsWith("DH1080_INIT") && keyExchangeAllowed) {
-                    events << new KeyEvent(EventManager::KeyEvent, net, tags, prefix, target, KeyEvent::Init, params[1].mid(12));
+                if (param(1).startsWith("DH1080_INIT") && keyExchangeAllowed) {
+                    events << new KeyEvent(EventManager::KeyEvent, net, tags(), prefix(), target, KeyEvent::Init, param(1).mid(12));
                 }
-                else if (params[1].startsWith("DH1080_FINISH") && keyExchangeAllowed) {
-                    events << new KeyEvent(EventManager::KeyEvent, net, tags, prefix, target, KeyEvent::Finish, params[1].mid(14));
+                else if (param(1).startsWith("DH1080_FINISH") && keyExchangeAllowed) {
+                    events << new KeyEvent(EventManager::KeyEvent, net, tags(), prefix(), target, KeyEvent::Finish, param(1).mid(14));
                 }
                 else
 #endif
                 {
-                    IrcEventRawMessage* rawMessage
-                        = new IrcEventRawMessage(EventManager::IrcEventRawNotice, net, tags, params[1], prefix, target, e->timestamp());
+                    // The message is carried along by the event, so it needs its own copy
+                    IrcEventRawMessage* rawMessage = new IrcEventRawMessage(
+                        EventManager::IrcEventRawNotice, net, tags(), view.param(1).toByteArray(), prefix(), target, e->timestamp());
                     if (isSelfMessage) {
                         // Self-messages need processed differently, tag as such via flag.
                         rawMessage->setFlag(EventManager::Self);
@@ -321,46 +347,46 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
 
         // the following events need only special casing for param decoding
     case EventManager::IrcEventKick:
-        if (params.count() >= 3) {  // we have a reason
-            decParams << net->serverDecode(params.at(0)) << net->serverDecode(params.at(1));
-            decParams << net->channelDecode(decParams.first(), params.at(2));  // kick reason
+        if (paramCount() >= 3) {  // we have a reason
+            decParams << net->serverDecode(param(0)) << net->serverDecode(param(1));
+            decParams << net->channelDecode(decParams.first(), param(2));  // kick reason
         }
         break;
 
     case EventManager::IrcEventPart:
-        if (params.count() >= 2) {
-            QString channel = net->serverDecode(params.at(0));
+        if (paramCount() >= 2) {
+            QString channel = net->serverDecode(param(0));
             decParams << channel;
-            decParams << net->userDecode(nickFromMask(prefix), params.at(1));
-            net->updateNickFromMask(prefix);
+            decParams << net->userDecode(nickFromMask(prefix()), param(1));
+            net->updateNickFromMask(prefix());
         }
         break;
 
     case EventManager::IrcEventQuit:
-        if (params.count() >= 1) {
-            decParams << net->userDecode(nickFromMask(prefix), params.at(0));
-            net->updateNickFromMask(prefix);
+        if (paramCount() >= 1) {
+            decParams << net->userDecode(nickFromMask(prefix()), param(0));
+            net->updateNickFromMask(prefix());
         }
         break;
 
     case EventManager::IrcEventTagmsg:
         defaultHandling = false;  // this might create a list of events
 
-        if (checkParamCount(cmd, params, 1)) {
-            QString senderNick = nickFromMask(prefix);
-            net->updateNickFromMask(prefix);
+        if (checkParamCount(view, 1)) {
+            QString senderNick = nickFromMask(prefix());
+            net->updateNickFromMask(prefix());
             // Check if the sender is our own nick.  If so, treat message as if sent by ourself.
             // See http://ircv3.net/specs/extensions/echo-message-3.2.html
             // Cache the result to avoid multiple redundant comparisons
             bool isSelfMessage = net->isMyNick(senderNick);
 
-            QStringList targets = net->serverDecode(params.at(0)).split(',', Qt::SkipEmptyParts);
+            QStringList targets = net->serverDecode(param(0)).split(',', Qt::SkipEmptyParts);
             QStringList::const_iterator targetIter;
             for (targetIter = targets.constBegin(); targetIter != targets.constEnd(); ++targetIter) {
                 // For self-messages, keep the target, don't set it to the senderNick
                 QString target = net->isChannelName(*targetIter) || net->isStatusMsg(*targetIter) || isSelfMessage ? *targetIter : senderNick;
 
-                IrcEvent* tagMsg = new IrcEvent(EventManager::IrcEventTagmsg, net, tags, prefix, {target});
+                IrcEvent* tagMsg = new IrcEvent(EventManager::IrcEventTagmsg, net, tags(), prefix(), {target});
                 if (isSelfMessage) {
                     // Self-messages need processed differently, tag as such via flag.
                     tagMsg->setFlag(EventManager::Self);
@@ -372,46 +398,46 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
         break;
 
     case EventManager::IrcEventTopic:
-        if (params.count() >= 1) {
-            QString channel = net->serverDecode(params.at(0));
+        if (paramCount() >= 1) {
+            QString channel = net->serverDecode(param(0));
             decParams << channel;
-            decParams << (params.count() >= 2 ? net->channelDecode(channel, decrypt(net, channel, params.at(1), true)) : QString());
+            decParams << (paramCount() >= 2 ? net->channelDecode(channel, decrypt(net, channel, param(1), true)) : QString());
         }
         break;
 
     case EventManager::IrcEventAway: {
         // Update hostmask info first.  This will create the nick if it doesn't exist, e.g.
         // away-notify data being sent before JOIN messages.
-        net->updateNickFromMask(prefix);
+        net->updateNickFromMask(prefix());
         // Separate nick in order to separate server and user decoding
-        QString nick = nickFromMask(prefix);
+        QString nick = nickFromMask(prefix());
         decParams << nick;
-        decParams << (params.count() >= 1 ? net->userDecode(nick, params.at(0)) : QString());
+        decParams << (paramCount() >= 1 ? net->userDecode(nick, param(0)) : QString());
     } break;
 
     case EventManager::IrcEventNumeric:
         switch (num) {
         case 301: /* RPL_AWAY */
-            if (params.count() >= 2) {
-                QString nick = net->serverDecode(params.at(0));
+            if (paramCount() >= 2) {
+                QString nick = net->serverDecode(param(0));
                 decParams << nick;
-                decParams << net->userDecode(nick, params.at(1));
+                decParams << net->userDecode(nick, param(1));
             }
             break;
 
         case 332: /* RPL_TOPIC */
-            if (params.count() >= 2) {
-                QString channel = net->serverDecode(params.at(0));
+            if (paramCount() >= 2) {
+                QString channel = net->serverDecode(param(0));
                 decParams << channel;
-                decParams << net->channelDecode(channel, decrypt(net, channel, params.at(1), true));
+                decParams << net->channelDecode(channel, decrypt(net, channel, param(1), true));
             }
             break;
 
         case 333: /* Topic set by... */
-            if (params.count() >= 3) {
-                QString channel = net->serverDecode(params.at(0));
-                decParams << channel << net->serverDecode(params.at(1));
-                decParams << net->channelDecode(channel, params.at(2));
+            if (paramCount() >= 3) {
+                QString channel = net->serverDecode(param(0));
+                decParams << channel << net->serverDecode(param(1));
+                decParams << net->channelDecode(channel, param(2));
             }
             break;
         case 451: /* You have not registered... */
@@ -436,8 +462,8 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
     }
 
     if (defaultHandling && type != EventManager::Invalid) {
-        for (int i = decParams.count(); i < params.count(); i++)
-            decParams << net->serverDecode(params.at(i));
+        for (int i = decParams.count(); i < paramCount(); i++)
+            decParams << net->serverDecode(param(i));
 
         // We want to trim the last param just in case, except for PRIVMSG and NOTICE
         // ... but those happen to be the only ones not using defaultHandling anyway
@@ -446,9 +472,9 @@ void IrcParser::processNetworkIncoming(NetworkDataEvent* e)
 
         IrcEvent* event;
         if (type == EventManager::IrcEventNumeric)
-            event = new IrcEventNumeric(num, net, tags, prefix, messageTarget);
+            event = new IrcEventNumeric(num, net, tags(), prefix(), messageTarget);
         else
-            event = new IrcEvent(type, net, tags, prefix);
+            event = new IrcEvent(type, net, tags(), prefix());
         event->setParams(decParams);
         event->setTimestamp(e->timestamp());
         events << event;
@@ -11,6 +11,7 @@
 class Event;
 class EventManager;
 class IrcEvent;
+class IrcMessageView;
 class NetworkDataEvent;
 
 class IrcParser : public QObject
@@ -29,7 +30,7 @@ signals:
 protected:
     Q_INVOKABLE void processNetworkIncoming(NetworkDataEvent* e);
 
-    bool checkParamCount(const QString& cmd, const QList<QByteArray>& params, int minParams);
+    bool checkParamCount(const IrcMessageView& msg, int minParams);
 
     // no-op if we don't have crypto support!
     QByteArray decrypt(Network* network, const QString& target, const QByteArray& message, bool isTopic = false);
@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "messagecompressor.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <QHash>
+#include <QtEndian>
+
+namespace {
+
+/// Upper bound for decompressed texts, protecting us from corrupt data
+constexpr int maxMessageSize{1024 * 1024};
+
+}  // namespace
+
+MessageCompressor::~MessageCompressor()
+{
+    endStream(_deflater);
+    endStream(_primed);
+}
+
+void MessageCompressor::endStream(z_streamp& stream)
+{
+    if (stream) {
+        deflateEnd(stream);
+        delete stream;
+        stream = nullptr;
+    }
+}
+
+QByteArray MessageCompressor::trainDictionary(const QStringList& samples)
+{
+    // Count whole messages as well as words and pairs of words, which covers both repetitive
+    // messages like joins and quits and common phrases in regular conversation
+    QHash<QString, int> counts;
+    for (const QString& sample : samples) {
+        ++counts[sample];
+        const QStringList words = sample.split(' ', Qt::SkipEmptyParts);
+        for (int i = 0; i < words.size(); ++i) {
+            if (words[i].size() >= 3)
+                ++counts[words[i]];
+            if (i > 0)
+                ++counts[words[i - 1] + ' ' + words[i]];
+        }
+    }
+
+    struct Candidate
+    {
+        QByteArray bytes;
+        qint64 score;
+    };
+    std::vector<Candidate> candidates;
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+        if (it.value() < 2)
+            continue;
+        QByteArray bytes = it.key().toUtf8();
+        if (bytes.size() < 3 || bytes.size() > MaxDictionarySize / 16)
+            continue;
+        // Every occurrence but the first could be replaced by a back reference
+        candidates.push_back({std::move(bytes), qint64(it.value() - 1) * it.key().size()});
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+
+    std::vector<const QByteArray*> selected;
+    int size = 0;
+    for (const Candidate& candidate : candidates) {
+        if (size + candidate.bytes.size() > MaxDictionarySize)
+            continue;
+        selected.push_back(&candidate.bytes);
+        size += candidate.bytes.size();
+        if (size >= MaxDictionarySize - 2)
+            break;
+    }
+
+    QByteArray dictionary;
+    dictionary.reserve(size);
+    std::for_each(selected.crbegin(), selected.crend(), [&dictionary](const QByteArray* bytes) { dictionary += *bytes; });
+    return dictionary;
+}
+
+void MessageCompressor::setDictionary(int dictionaryId, const QByteArray& dictionary)
+{
+    _dictionaryId = dictionary.isEmpty() ? 0 : dictionaryId;
+    _dictionary = dictionary.left(MaxDictionarySize);
+    endStream(_primed);
+}
+
+bool MessageCompressor::prime()
+{
+    if (_primed)
+        return true;
+
+    _primed = new z_stream;
+    _primed->zalloc = Z_NULL;
+    _primed->zfree = Z_NULL;
+    _primed->opaque = Z_NULL;
+    // Raw deflate without zlib header and checksum; every byte counts for short texts. Higher levels hardly gain
+    // anything on texts this short.
+    if (deflateInit2(_primed, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        delete _primed;
+        _primed = nullptr;
+        return false;
+    }
+    if (deflateSetDictionary(_primed, reinterpret_cast<const Bytef*>(_dictionary.constData()), _dictionary.size()) != Z_OK) {
+        endStream(_primed);
+        return false;
+    }
+    return true;
+}
+
+QByteArray MessageCompressor::compress(const QString& text)
+{
+    QByteArray input = text.toUtf8();
+    if (!hasDictionary() || input.size() < MinMessageSize)
+        return {};
+
+    // Loading the dictionary means hashing all of it, so do that only once and start every text from a copy
+    if (!prime())
+        return {};
+    endStream(_deflater);
+    _deflater = new z_stream;
+    if (deflateCopy(_deflater, _primed) != Z_OK) {
+        delete _deflater;
+        _deflater = nullptr;
+        return {};
+    }
+
+    QByteArray output(HeaderSize + deflateBound(_deflater, input.size()), Qt::Uninitialized);
+    output[0] = Deflate;
+    qToBigEndian<quint32>(_dictionaryId, output.data() + 1);
+
+    _deflater->next_in = reinterpret_cast<Bytef*>(input.data());
+    _deflater->avail_in = input.size();
+    _deflater->next_out = reinterpret_cast<Bytef*>(output.data() + HeaderSize);
+    _deflater->avail_out = output.size() - HeaderSize;
+    if (deflate(_deflater, Z_FINISH) != Z_STREAM_END)
+        return {};
+
+    output.resize(HeaderSize + _deflater->total_out);
+    if (output.size() >= input.size())
+        return {};
+    return output;
+}
+
+bool MessageCompressor::decompress(const QByteArray& data, const DictionaryLookup& dictionary, QString& text)
+{
+    if (data.size() < HeaderSize || data[0] != Deflate)
+        return false;
+
+    QByteArray dict = dictionary(qFromBigEndian<quint32>(data.constData() + 1));
+    if (dict.isEmpty())
+        return false;
+
+    z_stream inflater;
+    inflater.zalloc = Z_NULL;
+    inflater.zfree = Z_NULL;
+    inflater.opaque = Z_NULL;
+    inflater.next_in = Z_NULL;
+    inflater.avail_in = 0;
+    if (inflateInit2(&inflater, -MAX_WBITS) != Z_OK)
+        return false;
+
+    QByteArray output;
+    int status = inflateSetDictionary(&inflater, reinterpret_cast<const Bytef*>(dict.constData()), dict.size());
+    if (status == Z_OK) {
+        output.resize(qMin(maxMessageSize, 4 * data.size() + 64));
+        inflater.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData() + HeaderSize));
+        inflater.avail_in = data.size() - HeaderSize;
+        inflater.next_out = reinterpret_cast<Bytef*>(output.data());
+        inflater.avail_out = output.size();
+        status = inflate(&inflater, Z_FINISH);
+        while ((status == Z_OK || status == Z_BUF_ERROR) && inflater.avail_out == 0 && output.size() < maxMessageSize) {
+            output.resize(qMin(maxMessageSize, 2 * output.size()));
+            inflater.next_out = reinterpret_cast<Bytef*>(output.data() + inflater.total_out);
+            inflater.avail_out = output.size() - inflater.total_out;
+            status = inflate(&inflater, Z_FINISH);
+        }
+    }
+    inflateEnd(&inflater);
+
+    if (status != Z_STREAM_END)
+        return false;
+    text = QString::fromUtf8(output.constData(), inflater.total_out);
+    return true;
+}
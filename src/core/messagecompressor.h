@@ -0,0 +1,111 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <functional>
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include <zlib.h>
+
+/**
+ * Compresses message texts for storage in the backlog.
+ *
+ * IRC messages are short, so compressing them one by one only pays off with a dictionary of strings
+ * that commonly occur in the backlog (join and quit messages, bot output, frequent words...). The
+ * dictionary is trained from a sample of the core's own backlog, and stored alongside the compressed
+ * messages, which refer to it by ID.
+ *
+ * Compressed texts carry a small header identifying the format and the dictionary, so the format can
+ * evolve without having to touch existing rows.
+ */
+class MessageCompressor
+{
+public:
+    /// Maximum size of a dictionary; deflate can't make use of more than its window size
+    static constexpr int MaxDictionarySize{32 * 1024};
+
+    /// Texts shorter than this (in UTF-8) are not worth compressing
+    static constexpr int MinMessageSize{24};
+
+    /// Number of messages a dictionary should be trained from
+    static constexpr int DictionarySampleSize{20000};
+
+    /// Minimum number of sample messages needed for training a useful dictionary
+    static constexpr int MinDictionarySamples{1000};
+
+    /// Looks up a dictionary by ID, returning an empty QByteArray for unknown IDs
+    using DictionaryLookup = std::function<QByteArray(int dictionaryId)>;
+
+    MessageCompressor() = default;
+    ~MessageCompressor();
+
+    MessageCompressor(const MessageCompressor&) = delete;
+    MessageCompressor& operator=(const MessageCompressor&) = delete;
+
+    /**
+     * Builds a dictionary from a sample of message texts.
+     *
+     * Strings are ranked by the number of bytes they would save, and the most valuable ones are placed
+     * at the end of the dictionary, where they can be referenced with the shortest distances.
+     *
+     * @param samples Message texts to train from
+     * @returns The dictionary, at most MaxDictionarySize bytes
+     */
+    static QByteArray trainDictionary(const QStringList& samples);
+
+    /**
+     * Sets the dictionary used for compression.
+     *
+     * @param dictionaryId The ID under which the dictionary is stored
+     * @param dictionary   The dictionary data
+     */
+    void setDictionary(int dictionaryId, const QByteArray& dictionary);
+
+    /// @returns Whether a dictionary has been set, i.e. whether the compressor is usable
+    bool hasDictionary() const { return _dictionaryId > 0; }
+
+    /**
+     * Compresses a message text.
+     *
+     * @note This method is not threadsafe.
+     *
+     * @param text The text to compress
+     * @returns The compressed text, or an empty QByteArray if the text should better be stored as is
+     */
+    QByteArray compress(const QString& text);
+
+    /**
+     * Decompresses a message text.
+     *
+     * @note This method is threadsafe.
+     *
+     * @param data       The compressed text, as returned by compress()
+     * @param dictionary Provides the dictionary referenced by the compressed text
+     * @param[out] text  The decompressed text
+     * @returns true on success
+     */
+    static bool decompress(const QByteArray& data, const DictionaryLookup& dictionary, QString& text);
+
+private:
+    /// Format identifiers, stored in the first byte of compressed texts
+    enum Format : char
+    {
+        Deflate = 1,  ///< Raw deflate stream with preset dictionary
+    };
+
+    /// Size of the header preceding the compressed data: format and dictionary ID
+    static constexpr int HeaderSize{5};
+
+    /// Sets up _primed with the current dictionary, unless that has already been done
+    bool prime();
+    static void endStream(z_streamp& stream);
+
+    int _dictionaryId{0};
+    QByteArray _dictionary;
+    z_streamp _primed{nullptr};    ///< Stream with the dictionary loaded, never used for compressing itself
+    z_streamp _deflater{nullptr};  ///< Copy of _primed, used for compressing a single text
+};
@@ -13,6 +13,7 @@
 
 #include "core.h"
 #include "corenetwork.h"
+#include "event.h"
 
 MetricsServer::MetricsServer(QObject* parent)
     : QObject(parent)
@@ -188,6 +189,13 @@ void MetricsServer::respond()
             socket->write("# TYPE quassel_message_queue gauge\n");
             socket->write(
                 QString("quassel_message_queue{user=\"%1\"} %2 %3\n").arg(name).arg(_messageQueue.value(key, 0)).arg(timestamp).toUtf8());
+            socket->write("# HELP quassel_client_send_queue_bytes Amount of bytes held back for clients that can't keep up\n");
+            socket->write("# TYPE quassel_client_send_queue_bytes gauge\n");
+            socket->write(QString("quassel_client_send_queue_bytes{user=\"%1\"} %2 %3\n")
+                              .arg(name)
+                              .arg(_clientSendQueue.value(key, 0))
+                              .arg(timestamp)
+                              .toUtf8());
             socket->write("# HELP quassel_login_attempts The number of times the user has attempted to log in\n");
             socket->write("# TYPE quassel_login_attempts counter\n");
             socket->write(QString("quassel_login_attempts{user=\"%1\",successful=\"false\"} %2 %3\n")
@@ -201,6 +209,48 @@ void MetricsServer::respond()
                               .arg(timestamp)
                               .toUtf8());
         }
+        uint64_t senderIdCacheHits = _senderIdCacheHits;
+        uint64_t senderIdCacheMisses = _senderIdCacheMisses;
+        socket->write("# HELP quassel_storage_sender_cache_lookups Number of sender ID lookups served by the storage sender cache\n");
+        socket->write("# TYPE quassel_storage_sender_cache_lookups counter\n");
+        socket->write(QString("quassel_storage_sender_cache_lookups{result=\"hit\"} %1 %2\n").arg(senderIdCacheHits).arg(timestamp).toUtf8());
+        socket->write(QString("quassel_storage_sender_cache_lookups{result=\"miss\"} %1 %2\n").arg(senderIdCacheMisses).arg(timestamp).toUtf8());
+        if (senderIdCacheHits + senderIdCacheMisses > 0) {
+            socket->write("# HELP quassel_storage_sender_cache_hit_ratio Fraction of sender ID lookups served by the storage sender cache\n");
+            socket->write("# TYPE quassel_storage_sender_cache_hit_ratio gauge\n");
+            socket->write(QString("quassel_storage_sender_cache_hit_ratio %1 %2\n")
+                              .arg(double(senderIdCacheHits) / double(senderIdCacheHits + senderIdCacheMisses))
+                              .arg(timestamp)
+                              .toUtf8());
+        }
+        socket->write("# HELP quassel_backlog_retention_deleted_messages Number of messages deleted by the backlog retention policy\n");
+        socket->write("# TYPE quassel_backlog_retention_deleted_messages counter\n");
+        socket->write(QString("quassel_backlog_retention_deleted_messages %1 %2\n").arg(_backlogRetentionMessages.load()).arg(timestamp).toUtf8());
+        socket->write("# HELP quassel_backlog_retention_deleted_senders Number of orphaned senders deleted by the backlog retention policy\n");
+        socket->write("# TYPE quassel_backlog_retention_deleted_senders counter\n");
+        socket->write(QString("quassel_backlog_retention_deleted_senders %1 %2\n").arg(_backlogRetentionSenders.load()).arg(timestamp).toUtf8());
+        socket->write("# HELP quassel_backlog_retention_running Whether a backlog retention pass is in progress\n");
+        socket->write("# TYPE quassel_backlog_retention_running gauge\n");
+        socket->write(QString("quassel_backlog_retention_running %1 %2\n").arg(_backlogRetentionRunning ? 1 : 0).arg(timestamp).toUtf8());
+        if (_storageWriteLocks > 0) {
+            socket->write("# HELP quassel_storage_write_locks Number of times the storage write lock was acquired\n");
+            socket->write("# TYPE quassel_storage_write_locks counter\n");
+            socket->write(QString("quassel_storage_write_locks %1 %2\n").arg(_storageWriteLocks.load()).arg(timestamp).toUtf8());
+            socket->write("# HELP quassel_storage_write_lock_wait_seconds Total time spent waiting for the storage write lock\n");
+            socket->write("# TYPE quassel_storage_write_lock_wait_seconds counter\n");
+            socket->write(
+                QString("quassel_storage_write_lock_wait_seconds %1 %2\n").arg(_storageWriteLockWaitNs / 1e9).arg(timestamp).toUtf8());
+            socket->write("# HELP quassel_storage_write_lock_held_seconds Total time the storage write lock was held\n");
+            socket->write("# TYPE quassel_storage_write_lock_held_seconds counter\n");
+            socket->write(
+                QString("quassel_storage_write_lock_held_seconds %1 %2\n").arg(_storageWriteLockHeldNs / 1e9).arg(timestamp).toUtf8());
+        }
+        socket->write("# HELP quassel_events_live Number of currently allocated events\n");
+        socket->write("# TYPE quassel_events_live gauge\n");
+        socket->write(QString("quassel_events_live %1 %2\n").arg(Event::liveCount()).arg(timestamp).toUtf8());
+        socket->write("# HELP quassel_events_pooled Number of freed event allocations kept for reuse\n");
+        socket->write("# TYPE quassel_events_pooled gauge\n");
+        socket->write(QString("quassel_events_pooled %1 %2\n").arg(Event::pooledCount()).arg(timestamp).toUtf8());
         if (!_certificateExpires.isNull()) {
             socket->write("# HELP quassel_ssl_expire_time_seconds Expiration of the current TLS certificate in unixtime\n");
             socket->write("# TYPE quassel_ssl_expire_time_seconds gauge\n");
@@ -312,7 +362,40 @@ void MetricsServer::messageQueue(UserId user, uint64_t size)
     _messageQueue.insert(user, size);
 }
 
+void MetricsServer::clientSendQueue(UserId user, uint64_t size)
+{
+    _clientSendQueue.insert(user, size);
+}
+
 void MetricsServer::setCertificateExpires(QDateTime expires)
 {
     _certificateExpires = std::move(expires);
 }
+
+void MetricsServer::addSenderIdCacheLookup(bool hit)
+{
+    if (hit) {
+        ++_senderIdCacheHits;
+    }
+    else {
+        ++_senderIdCacheMisses;
+    }
+}
+
+void MetricsServer::addBacklogRetentionProgress(uint64_t messages, uint64_t senders)
+{
+    _backlogRetentionMessages += messages;
+    _backlogRetentionSenders += senders;
+}
+
+void MetricsServer::setBacklogRetentionRunning(bool running)
+{
+    _backlogRetentionRunning = running;
+}
+
+void MetricsServer::addStorageWriteLock(uint64_t waitNs, uint64_t heldNs)
+{
+    ++_storageWriteLocks;
+    _storageWriteLockWaitNs += waitNs;
+    _storageWriteLockHeldNs += heldNs;
+}
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <QHash>
 #include <QObject>
 #include <QString>
@@ -37,8 +39,52 @@ public:
 
     void messageQueue(UserId user, uint64_t size);
 
+    /**
+     * Sets the amount of data held back for the user's clients because they can't keep up.
+     *
+     * @param user The user
+     * @param size Total size of the queued messages, in bytes
+     */
+    void clientSendQueue(UserId user, uint64_t size);
+
     void setCertificateExpires(QDateTime expires);
 
+    /**
+     * Accounts for a lookup in the storage backend's sender ID cache.
+     *
+     * @note This method is threadsafe.
+     *
+     * @param hit Whether the sender was found in the cache
+     */
+    void addSenderIdCacheLookup(bool hit);
+
+    /**
+     * Accounts for rows deleted by the backlog retention policy.
+     *
+     * @note This method is threadsafe.
+     *
+     * @param messages Number of deleted messages
+     * @param senders  Number of deleted orphaned senders
+     */
+    void addBacklogRetentionProgress(uint64_t messages, uint64_t senders);
+
+    /**
+     * Sets whether a backlog retention pass is in progress.
+     *
+     * @note This method is threadsafe.
+     */
+    void setBacklogRetentionRunning(bool running);
+
+    /**
+     * Accounts for one use of the storage backend's exclusive write lock.
+     *
+     * @note This method is threadsafe.
+     *
+     * @param waitNs Time spent waiting for the lock, in nanoseconds
+     * @param heldNs Time the lock was held, in nanoseconds
+     */
+    void addStorageWriteLock(uint64_t waitNs, uint64_t heldNs);
+
 private slots:
     void incomingConnection();
     void respond();
@@ -58,6 +104,18 @@ private:
     QHash<UserId, uint64_t> _networkDataReceive{};
 
     QHash<UserId, uint64_t> _messageQueue{};
+    QHash<UserId, uint64_t> _clientSendQueue{};
 
     QDateTime _certificateExpires{};
+
+    std::atomic<uint64_t> _senderIdCacheHits{0};
+    std::atomic<uint64_t> _senderIdCacheMisses{0};
+
+    std::atomic<uint64_t> _backlogRetentionMessages{0};
+    std::atomic<uint64_t> _backlogRetentionSenders{0};
+    std::atomic<bool> _backlogRetentionRunning{false};
+
+    std::atomic<uint64_t> _storageWriteLocks{0};
+    std::atomic<uint64_t> _storageWriteLockWaitNs{0};
+    std::atomic<uint64_t> _storageWriteLockHeldNs{0};
 };
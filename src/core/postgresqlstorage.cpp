@@ -3,10 +3,14 @@
 
 #include "postgresqlstorage.h"
 
+#include <algorithm>
 #include <vector>
 
 #include <QByteArray>
 #include <QDataStream>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QMetaType>
 #include <QSqlDriver>
 #include <QSqlField>
@@ -15,6 +19,22 @@
 #include "network.h"
 #include "quassel.h"
 
+namespace {
+
+/// Wraps a JSON value for a nullable text column
+QJsonValue nullableString(const QString& value)
+{
+    return value.isNull() ? QJsonValue{} : QJsonValue{value};
+}
+
+/// Serializes rows for binding them as a single parameter, to be expanded with json_to_recordset()
+QString recordSet(const QJsonArray& rows)
+{
+    return QString::fromUtf8(QJsonDocument{rows}.toJson(QJsonDocument::Compact));
+}
+
+}  // namespace
+
 PostgreSqlStorage::PostgreSqlStorage(QObject* parent)
     : AbstractSqlStorage(parent)
 {
@@ -1636,31 +1656,12 @@ bool PostgreSqlStorage::logMessage(Message& msg)
         return false;
     }
 
-    QVariantList senderParams;
-    senderParams << msg.sender() << msg.realName() << msg.avatarUrl();
-    QSqlQuery getSenderIdQuery = executePreparedQuery("select_senderid", senderParams, db);
-    qint64 senderId;
-    if (getSenderIdQuery.first()) {
-        senderId = getSenderIdQuery.value(0).toLongLong();
-    }
-    else {
-        // it's possible that the sender was already added by another thread
-        // since the insert might fail we're setting a savepoint
-        savePoint("sender_sp1", db);
-        QSqlQuery addSenderQuery = executePreparedQuery("insert_sender", senderParams, db);
-
-        if (addSenderQuery.lastError().isValid()) {
-            rollbackSavePoint("sender_sp1", db);
-            getSenderIdQuery = executePreparedQuery("select_senderid", senderParams, db);
-            watchQuery(getSenderIdQuery);
-            getSenderIdQuery.first();
-            senderId = getSenderIdQuery.value(0).toLongLong();
-        }
-        else {
-            releaseSavePoint("sender_sp1", db);
-            addSenderQuery.first();
-            senderId = addSenderQuery.value(0).toLongLong();
-        }
+    SenderData sender = {msg.sender(), msg.realName(), msg.avatarUrl()};
+    QHash<SenderData, qint64> newSenderIds;
+    qint64 senderId = cachedSenderId(sender);
+    if (!senderId) {
+        senderId = fetchSenderId(db, sender, "sender_sp1");
+        newSenderIds.insert(sender, senderId);
     }
 
     QVariantList params;
@@ -1672,12 +1673,15 @@ bool PostgreSqlStorage::logMessage(Message& msg)
 
     if (!watchQuery(logMessageQuery)) {
         db.rollback();
+        // a cached sender may have been garbage collected in the meantime
+        clearSenderIdCache();
         return false;
     }
 
     logMessageQuery.first();
     MsgId msgId = logMessageQuery.value(0).toLongLong();
     db.commit();
+    cacheSenderIds(newSenderIds);
     if (msgId.isValid()) {
         msg.setMsgId(msgId);
         return true;
@@ -1696,81 +1700,175 @@ bool PostgreSqlStorage::logMessages(MessageList& msgs)
         return false;
     }
 
-    QList<int> senderIdList;
     QHash<SenderData, qint64> senderIds;
-    QSqlQuery addSenderQuery;
-    QSqlQuery selectSenderQuery;
-    ;
-    for (int i = 0; i < msgs.count(); i++) {
-        auto& msg = msgs.at(i);
+    QList<SenderData> uncachedSenders;
+    for (const Message& msg : msgs) {
         SenderData sender = {msg.sender(), msg.realName(), msg.avatarUrl()};
-        if (senderIds.contains(sender)) {
-            senderIdList << senderIds[sender];
+        if (senderIds.contains(sender))
             continue;
-        }
-
-        QVariantList senderParams;
-        senderParams << sender.sender << sender.realname << sender.avatarurl;
 
-        selectSenderQuery = executePreparedQuery("select_senderid", senderParams, db);
-        if (selectSenderQuery.first()) {
-            senderIdList << selectSenderQuery.value(0).toLongLong();
-            senderIds[sender] = selectSenderQuery.value(0).toLongLong();
-        }
-        else {
-            savePoint("sender_sp", db);
-            addSenderQuery = executePreparedQuery("insert_sender", senderParams, db);
-            if (addSenderQuery.lastError().isValid()) {
-                // seems it was inserted meanwhile... by a different thread
-                rollbackSavePoint("sender_sp", db);
-                selectSenderQuery = executePreparedQuery("select_senderid", senderParams, db);
-                watchQuery(selectSenderQuery);
-                selectSenderQuery.first();
-                senderIdList << selectSenderQuery.value(0).toLongLong();
-                senderIds[sender] = selectSenderQuery.value(0).toLongLong();
-            }
-            else {
-                releaseSavePoint("sender_sp", db);
-                addSenderQuery.first();
-                senderIdList << addSenderQuery.value(0).toLongLong();
-                senderIds[sender] = addSenderQuery.value(0).toLongLong();
+        qint64 senderId = cachedSenderId(sender);
+        senderIds[sender] = senderId;
+        if (!senderId)
+            uncachedSenders << sender;
+    }
+
+    // Resolve all uncached senders at once, falling back to single lookups for whatever the bulk query missed
+    QHash<SenderData, qint64> newSenderIds;
+    if (!uncachedSenders.isEmpty()) {
+        newSenderIds = fetchSenderIds(db, uncachedSenders);
+        for (const SenderData& sender : uncachedSenders) {
+            qint64 senderId = newSenderIds.value(sender);
+            if (!senderId) {
+                senderId = fetchSenderId(db, sender, "sender_sp");
+                newSenderIds.insert(sender, senderId);
             }
+            senderIds[sender] = senderId;
         }
     }
 
-    // yes we loop twice over the same list. This avoids alternating queries.
-    bool error = false;
-    for (int i = 0; i < msgs.count(); i++) {
-        Message& msg = msgs[i];
-        QVariantList params;
-        // PostgreSQL handles QDateTime()'s serialized format by default, and QDateTime() serializes
-        // to a 64-bit time compatible format by default.
-        params << msg.timestamp() << msg.bufferInfo().bufferId().toInt() << msg.type() << (int)msg.flags() << senderIdList.at(i)
-               << msg.senderPrefixes() << msg.contents();
-        QSqlQuery logMessageQuery = executePreparedQuery("insert_message", params, db);
-        if (!watchQuery(logMessageQuery)) {
-            db.rollback();
-            error = true;
-            break;
-        }
-        else {
-            logMessageQuery.first();
-            msg.setMsgId(logMessageQuery.value(0).toLongLong());
-        }
+    QList<qint64> senderIdList;
+    senderIdList.reserve(msgs.count());
+    for (const Message& msg : msgs) {
+        senderIdList << senderIds.value({msg.sender(), msg.realName(), msg.avatarUrl()});
     }
 
-    if (error) {
+    if (!insertMessages(db, msgs, senderIdList)) {
+        db.rollback();
         // we had a rollback in the db so we need to reset all msgIds
         for (int i = 0; i < msgs.count(); i++) {
             msgs[i].setMsgId(MsgId());
         }
+        // a cached sender may have been garbage collected in the meantime
+        clearSenderIdCache();
         return false;
     }
 
     db.commit();
+    cacheSenderIds(newSenderIds);
     return true;
 }
 
+bool PostgreSqlStorage::insertMessages(QSqlDatabase& db, MessageList& msgs, const QList<qint64>& senderIds)
+{
+    if (msgs.count() == 1) {
+        // A single message is cheapest to insert directly
+        Message& msg = msgs.first();
+        QVariantList params;
+        params << msg.timestamp() << msg.bufferInfo().bufferId().toInt() << msg.type() << (int)msg.flags() << senderIds.first()
+               << msg.senderPrefixes() << msg.contents();
+        QSqlQuery logMessageQuery = executePreparedQuery("insert_message", params, db);
+        if (!watchQuery(logMessageQuery))
+            return false;
+        logMessageQuery.first();
+        msg.setMsgId(logMessageQuery.value(0).toLongLong());
+        return true;
+    }
+
+    // The order of rows returned by a multi-row INSERT is unspecified, so reserve the MsgIds up front
+    // and insert them explicitly. This keeps the batch down to two round trips, regardless of its size.
+    QSqlQuery nextIdsQuery = executePreparedQuery("select_messageids_next", msgs.count(), db);
+    if (!watchQuery(nextIdsQuery))
+        return false;
+
+    QList<qint64> msgIds;
+    msgIds.reserve(msgs.count());
+    while (nextIdsQuery.next()) {
+        msgIds << nextIdsQuery.value(0).toLongLong();
+    }
+    if (msgIds.count() != msgs.count()) {
+        qWarning() << "PostgreSqlStorage::insertMessages(): could only reserve" << msgIds.count() << "of" << msgs.count() << "message ids";
+        return false;
+    }
+    std::sort(msgIds.begin(), msgIds.end());
+
+    // QPSQL can't bind arrays, so the rows go in as one JSON parameter that is escaped by the driver. Timestamps are
+    // stored as UTC without time zone, like QDateTime values bound by the driver.
+    QJsonArray rows;
+    for (int i = 0; i < msgs.count(); i++) {
+        const Message& msg = msgs.at(i);
+        rows.append(QJsonObject{
+            {"messageid", msgIds.at(i)},
+            {"time", msg.timestamp().toUTC().toString(Qt::ISODateWithMs)},
+            {"bufferid", msg.bufferInfo().bufferId().toInt()},
+            {"type", static_cast<int>(msg.type())},
+            {"flags", static_cast<int>(msg.flags())},
+            {"senderid", senderIds.at(i)},
+            {"senderprefixes", nullableString(msg.senderPrefixes())},
+            {"message", nullableString(msg.contents())},
+        });
+    }
+
+    QSqlQuery insertQuery = executePreparedQuery("insert_messages_bulk", recordSet(rows), db);
+    if (!watchQuery(insertQuery))
+        return false;
+
+    for (int i = 0; i < msgs.count(); i++) {
+        msgs[i].setMsgId(msgIds.at(i));
+    }
+    return true;
+}
+
+QHash<SenderData, qint64> PostgreSqlStorage::fetchSenderIds(QSqlDatabase& db, const QList<SenderData>& senders)
+{
+    QHash<SenderData, qint64> senderIds;
+    if (senders.count() == 1) {
+        // Not worth building arrays for, and the single lookup handles concurrent additions itself
+        return senderIds;
+    }
+
+    QJsonArray rows;
+    for (const SenderData& sender : senders) {
+        rows.append(QJsonObject{
+            {"sender", nullableString(sender.sender)},
+            {"realname", nullableString(sender.realname)},
+            {"avatarurl", nullableString(sender.avatarurl)},
+        });
+    }
+
+    // Senders might be added concurrently, so make sure a failing insert doesn't abort the transaction; whatever is
+    // missing then gets resolved one by one
+    savePoint("senders_bulk_sp", db);
+    QSqlQuery query = executePreparedQuery("insert_senders_bulk", recordSet(rows), db);
+    if (!watchQuery(query)) {
+        rollbackSavePoint("senders_bulk_sp", db);
+        return senderIds;
+    }
+
+    while (query.next()) {
+        senderIds.insert({query.value(1).toString(), query.value(2).toString(), query.value(3).toString()}, query.value(0).toLongLong());
+    }
+    releaseSavePoint("senders_bulk_sp", db);
+    return senderIds;
+}
+
+qint64 PostgreSqlStorage::fetchSenderId(QSqlDatabase& db, const SenderData& sender, const QString& savePointName)
+{
+    QVariantList senderParams;
+    senderParams << sender.sender << sender.realname << sender.avatarurl;
+
+    QSqlQuery selectSenderQuery = executePreparedQuery("select_senderid", senderParams, db);
+    if (selectSenderQuery.first()) {
+        return selectSenderQuery.value(0).toLongLong();
+    }
+
+    // it's possible that the sender was already added by another thread
+    // since the insert might fail we're setting a savepoint
+    savePoint(savePointName, db);
+    QSqlQuery addSenderQuery = executePreparedQuery("insert_sender", senderParams, db);
+    if (addSenderQuery.lastError().isValid()) {
+        rollbackSavePoint(savePointName, db);
+        selectSenderQuery = executePreparedQuery("select_senderid", senderParams, db);
+        watchQuery(selectSenderQuery);
+        selectSenderQuery.first();
+        return selectSenderQuery.value(0).toLongLong();
+    }
+
+    releaseSavePoint(savePointName, db);
+    addSenderQuery.first();
+    return addSenderQuery.value(0).toLongLong();
+}
+
 std::vector<Message> PostgreSqlStorage::requestMsgs(UserId user, BufferId bufferId, MsgId first, MsgId last, int limit)
 {
     std::vector<Message> messagelist;
@@ -2105,6 +2203,187 @@ std::vector<Message> PostgreSqlStorage::requestAllMsgsFiltered(
     return messagelist;
 }
 
+std::vector<Message> PostgreSqlStorage::searchMsgs(UserId user, BufferId bufferId, const QString& query, int limit, MsgId last)
+{
+    std::vector<Message> messagelist;
+
+    if (query.trimmed().isEmpty())
+        return messagelist;
+
+    // requestBuffers uses it's own transaction.
+    QHash<BufferId, BufferInfo> bufferInfoHash;
+    for (const BufferInfo& bufferInfo : requestBuffers(user)) {
+        bufferInfoHash[bufferInfo.bufferId()] = bufferInfo;
+    }
+
+    if (bufferId.isValid() && !bufferInfoHash.contains(bufferId))
+        return messagelist;
+
+    QSqlDatabase db = logDb();
+    if (!beginReadOnlyTransaction(db)) {
+        qWarning() << "PostgreSqlStorage::searchMsgs(): cannot start read only transaction!";
+        qWarning() << " -" << qPrintable(db.lastError().text());
+        return messagelist;
+    }
+
+    QSqlQuery searchQuery(db);
+    if (bufferId.isValid()) {
+        searchQuery.prepare(queryString("select_messagesSearch"));
+        searchQuery.bindValue(":bufferid", bufferId.toInt());
+    }
+    else {
+        searchQuery.prepare(queryString("select_messagesAllSearch"));
+        searchQuery.bindValue(":userid", user.toInt());
+    }
+    // plainto_tsquery() takes care of parsing arbitrary user input, no escaping needed
+    searchQuery.bindValue(":query", query);
+    searchQuery.bindValue(":lastmsg", last == -1 ? std::numeric_limits<qint64>::max() : last.toQint64());
+    if (limit != -1)
+        searchQuery.bindValue(":limit", limit);
+    else
+        searchQuery.bindValue(":limit", QVariant(QMetaType(QMetaType::Int)));
+    safeExec(searchQuery);
+    if (!watchQuery(searchQuery)) {
+        db.rollback();
+        return messagelist;
+    }
+
+    QDateTime timestamp;
+    while (searchQuery.next()) {
+        // PostgreSQL returns date/time in ISO 8601 format, no 64-bit handling needed
+        // See https://www.postgresql.org/docs/current/static/datatype-datetime.html#DATATYPE-DATETIME-OUTPUT
+        timestamp = searchQuery.value(2).toDateTime();
+        timestamp.setTimeZone(QTimeZone::UTC);
+        Message msg(timestamp,
+                    bufferInfoHash[searchQuery.value(1).toInt()],
+                    (Message::Type)searchQuery.value(3).toInt(),
+                    searchQuery.value(9).toString(),
+                    searchQuery.value(5).toString(),
+                    searchQuery.value(6).toString(),
+                    searchQuery.value(7).toString(),
+                    searchQuery.value(8).toString(),
+                    Message::Flags{searchQuery.value(4).toInt()});
+        msg.setMsgId(searchQuery.value(0).toLongLong());
+        messagelist.push_back(std::move(msg));
+    }
+
+    db.commit();
+    return messagelist;
+}
+
+MsgId PostgreSqlStorage::oldestRetainedMsgId(UserId user, BufferId bufferId, int keepCount)
+{
+    MsgId msgId;
+    if (keepCount <= 0)
+        return msgId;
+
+    QSqlDatabase db = logDb();
+    if (!beginReadOnlyTransaction(db)) {
+        qWarning() << "PostgreSqlStorage::oldestRetainedMsgId(): cannot start read only transaction!";
+        qWarning() << " -" << qPrintable(db.lastError().text());
+        return msgId;
+    }
+
+    QSqlQuery query(db);
+    query.prepare(queryString("select_backlog_retention_boundary"));
+    query.bindValue(":userid", user.toInt());
+    query.bindValue(":bufferid", bufferId.toInt());
+    query.bindValue(":offset", keepCount - 1);
+    safeExec(query);
+    if (watchQuery(query) && query.first())
+        msgId = query.value(0).toLongLong();
+
+    db.commit();
+    return msgId;
+}
+
+int PostgreSqlStorage::deleteExpiredMsgs(UserId user, BufferId bufferId, const QDateTime& olderThan, MsgId before, int limit)
+{
+    QSqlDatabase db = logDb();
+    if (!beginTransaction(db)) {
+        qWarning() << "PostgreSqlStorage::deleteExpiredMsgs(): cannot start transaction!";
+        qWarning() << " -" << qPrintable(db.lastError().text());
+        return -1;
+    }
+
+    QSqlQuery query(db);
+    query.prepare(queryString("delete_backlog_expired"));
+    query.bindValue(":userid", user.toInt());
+    query.bindValue(":bufferid", bufferId.toInt());
+    query.bindValue(":olderthan", olderThan.isValid() ? olderThan : QDateTime::fromMSecsSinceEpoch(0, QTimeZone::UTC));
+    query.bindValue(":before", before.toQint64());
+    query.bindValue(":limit", limit);
+    safeExec(query);
+    if (!watchQuery(query)) {
+        db.rollback();
+        return -1;
+    }
+
+    int deleted = query.numRowsAffected();
+    db.commit();
+    return deleted;
+}
+
+qint64 PostgreSqlStorage::maxSenderId()
+{
+    qint64 senderId = 0;
+
+    QSqlDatabase db = logDb();
+    if (!beginReadOnlyTransaction(db)) {
+        qWarning() << "PostgreSqlStorage::maxSenderId(): cannot start read only transaction!";
+        qWarning() << " -" << qPrintable(db.lastError().text());
+        return senderId;
+    }
+
+    QSqlQuery query(db);
+    query.prepare(queryString("select_sender_max_id"));
+    safeExec(query);
+    if (watchQuery(query) && query.first())
+        senderId = query.value(0).toLongLong();
+
+    db.commit();
+    return senderId;
+}
+
+int PostgreSqlStorage::deleteOrphanedSenders(qint64 firstSenderId, qint64 lastSenderId)
+{
+    QSqlDatabase db = logDb();
+    if (!beginTransaction(db)) {
+        qWarning() << "PostgreSqlStorage::deleteOrphanedSenders(): cannot start transaction!";
+        qWarning() << " -" << qPrintable(db.lastError().text());
+        return -1;
+    }
+
+    QSqlQuery query(db);
+    query.prepare(queryString("delete_senders_orphaned"));
+    query.bindValue(":firstsenderid", firstSenderId);
+    query.bindValue(":lastsenderid", lastSenderId);
+    safeExec(query);
+    if (!watchQuery(query)) {
+        db.rollback();
+        return -1;
+    }
+
+    int deleted = query.numRowsAffected();
+    db.commit();
+    // A message logged concurrently may still have picked up a deleted id from the cache; logMessages() clears the
+    // cache when its insert fails, so retrying the message resolves the sender again
+    if (deleted > 0)
+        clearSenderIdCache();
+    return deleted;
+}
+
+void PostgreSqlStorage::compact()
+{
+    // VACUUM cannot run inside a transaction block, so these are executed on their own
+    QSqlDatabase db = logDb();
+    for (auto&& queryName : {"vacuum_backlog", "vacuum_sender"}) {
+        QSqlQuery query(db);
+        query.exec(queryString(queryName));
+        watchQuery(query);
+    }
+}
+
 QMap<UserId, QString> PostgreSqlStorage::getAllAuthUserNames()
 {
     QMap<UserId, QString> authusernames;
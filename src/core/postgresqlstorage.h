@@ -113,6 +113,14 @@ public:
                                                 int limit = -1,
                                                 Message::Types type = Message::Types{-1},
                                                 Message::Flags flags = Message::Flags{-1}) override;
+    std::vector<Message> searchMsgs(UserId user, BufferId bufferId, const QString& query, int limit = -1, MsgId last = -1) override;
+
+    /* Backlog retention */
+    MsgId oldestRetainedMsgId(UserId user, BufferId bufferId, int keepCount) override;
+    int deleteExpiredMsgs(UserId user, BufferId bufferId, const QDateTime& olderThan, MsgId before, int limit) override;
+    qint64 maxSenderId() override;
+    int deleteOrphanedSenders(qint64 firstSenderId, qint64 lastSenderId) override;
+    void compact() override;
 
     /* Sysident handling */
     QMap<UserId, QString> getAllAuthUserNames() override;
@@ -176,6 +184,43 @@ protected:
 private:
     void bindNetworkInfo(QSqlQuery& query, const NetworkInfo& info);
     void bindServerInfo(QSqlQuery& query, const Network::Server& server);
+
+    /**
+     * Fetches the ID of a sender from the database, adding the sender if necessary
+     *
+     * Has to be called from within a transaction.
+     *
+     * @param db             The database connection holding the transaction
+     * @param sender         The sender to resolve
+     * @param savePointName  Name of the savepoint guarding the insert against concurrent additions
+     * @return The sender ID
+     */
+    qint64 fetchSenderId(QSqlDatabase& db, const SenderData& sender, const QString& savePointName);
+
+    /**
+     * Fetches the IDs of a set of senders in a single round trip, adding missing senders
+     *
+     * Has to be called from within a transaction. Senders that could not be resolved, e.g. because
+     * they were added concurrently, are missing from the result and have to be fetched individually.
+     *
+     * @param db       The database connection holding the transaction
+     * @param senders  The senders to resolve
+     * @return The resolved sender IDs
+     */
+    QHash<SenderData, qint64> fetchSenderIds(QSqlDatabase& db, const QList<SenderData>& senders);
+
+    /**
+     * Inserts a list of messages in a single statement, setting their MsgIds
+     *
+     * Has to be called from within a transaction.
+     *
+     * @param db         The database connection holding the transaction
+     * @param msgs       The messages to insert
+     * @param senderIds  The sender ID of each message
+     * @return true on success
+     */
+    bool insertMessages(QSqlDatabase& db, MessageList& msgs, const QList<qint64>& senderIds);
+
     QSqlQuery prepareAndExecuteQuery(const QString& queryname, const QString& paramstring, QSqlDatabase& db);
     QSqlQuery prepareAndExecuteQuery(const QString& queryname, QSqlDatabase& db)
     {
@@ -3,12 +3,19 @@
 
 #include "sqlitestorage.h"
 
+#include <utility>
+#include <vector>
+
 #include <QByteArray>
 #include <QDataStream>
 #include <QLatin1String>
+#include <QMutexLocker>
+#include <QRegularExpression>
 #include <QStringConverter>
+#include <QThread>
 #include <QVariant>
 
+#include "metricsserver.h"
 #include "network.h"
 #include "quassel.h"
 
@@ -19,6 +26,18 @@ SqliteStorage::SqliteStorage(QObject* parent)
 {
 }
 
+Storage::State SqliteStorage::init(const QVariantMap& settings, const QProcessEnvironment& environment, bool loadFromEnvironment)
+{
+    State state = AbstractSqlStorage::init(settings, environment, loadFromEnvironment);
+    // Only switch journal modes on a complete schema; some settings (e.g. auto_vacuum) cannot be
+    // changed anymore once the database is in WAL mode
+    if (state == IsReady) {
+        enableWriteAheadLog();
+        loadDictionaries();
+    }
+    return state;
+}
+
 bool SqliteStorage::isAvailable() const
 {
     if (!QSqlDatabase::isDriverAvailable("QSQLITE"))
@@ -1832,22 +1851,19 @@ bool SqliteStorage::logMessage(Message& msg)
                    << "type=" << msg.type() << "buffer=" << msg.bufferInfo().bufferName() << "content=" << msg.contents();
     }
 
-    // Step 1: Ensure the sender exists
-    {
-        QSqlQuery addSenderQuery(db);
-        addSenderQuery.prepare(queryString("insert_sender"));
-        addSenderQuery.bindValue(":sender", QVariant(sender));
-        addSenderQuery.bindValue(":realname", QVariant(realName));
-        addSenderQuery.bindValue(":avatarurl", QVariant(avatarUrl));
-        lockForWrite();
-        safeExec(addSenderQuery);
-        if (addSenderQuery.lastError().isValid() && addSenderQuery.lastError().nativeErrorCode() != QLatin1String{"19"}) {
-            qCritical() << "Failed to insert sender:" << qPrintable(sender) << "Error:" << qPrintable(addSenderQuery.lastError().text());
-            error = true;
-        }
+    // Compressing takes a while, don't keep other writers waiting for it
+    QByteArray compressedMessage = compressMessageText(message);
+
+    // Step 1: Resolve the sender, adding it if necessary
+    QHash<SenderData, qint64> newSenderIds;
+    lockForWrite();
+    qint64 senderId = this->senderId(db, {sender, realName, avatarUrl}, newSenderIds);
+    if (!senderId) {
+        qCritical() << "Failed to resolve sender:" << qPrintable(sender);
+        error = true;
     }
 
-    // Step 2: Insert the message (senderid is handled by the query's subquery)
+    // Step 2: Insert the message
     if (!error) {
         QSqlQuery logMessageQuery(db);
         logMessageQuery.prepare(queryString("insert_message"));
@@ -1855,11 +1871,9 @@ bool SqliteStorage::logMessage(Message& msg)
         logMessageQuery.bindValue(":bufferid", static_cast<int>(msg.bufferInfo().bufferId().toInt()));
         logMessageQuery.bindValue(":type", static_cast<int>(msg.type()));
         logMessageQuery.bindValue(":flags", static_cast<int>(msg.flags()));
-        logMessageQuery.bindValue(":sender", QVariant(sender));
-        logMessageQuery.bindValue(":realname", QVariant(realName));
-        logMessageQuery.bindValue(":avatarurl", QVariant(avatarUrl));
+        logMessageQuery.bindValue(":senderid", senderId);
         logMessageQuery.bindValue(":senderprefixes", QVariant(senderPrefixes));
-        logMessageQuery.bindValue(":message", QVariant(message));
+        bool compressed = bindMessageText(logMessageQuery, message, compressedMessage);
         safeExec(logMessageQuery);
         if (logMessageQuery.lastError().isValid()) {
             qCritical() << "Failed to insert backlog message. Bound values:" << logMessageQuery.boundValues()
@@ -1870,6 +1884,8 @@ bool SqliteStorage::logMessage(Message& msg)
             MsgId msgId = logMessageQuery.lastInsertId().toLongLong();
             if (msgId.isValid()) {
                 msg.setMsgId(msgId);
+                if (compressed && !indexMessageText(db, msgId, message))
+                    error = true;
             }
             else {
                 qCritical() << "Invalid message ID after backlog insert";
@@ -1883,6 +1899,7 @@ bool SqliteStorage::logMessage(Message& msg)
     }
     else {
         db.commit();
+        cacheSenderIds(newSenderIds);
     }
     unlock();
     return !error;
@@ -1893,27 +1910,31 @@ bool SqliteStorage::logMessages(MessageList& msgs)
     QSqlDatabase db = logDb();
     db.transaction();
 
-    {
-        QSet<SenderData> senders;
-        QSqlQuery addSenderQuery(db);
-        addSenderQuery.prepare(queryString("insert_sender"));
-        lockForWrite();
-        for (int i = 0; i < msgs.count(); i++) {
-            auto& msg = msgs.at(i);
-            SenderData sender = {msg.sender(), msg.realName(), msg.avatarUrl()};
-            if (senders.contains(sender))
-                continue;
-            senders << sender;
+    // Compressing takes a while, don't keep other writers waiting for it
+    QList<QByteArray> compressedContents;
+    compressedContents.reserve(msgs.count());
+    for (const Message& msg : msgs)
+        compressedContents << compressMessageText(msg.contents());
 
-            addSenderQuery.bindValue(":sender", sender.sender);
-            addSenderQuery.bindValue(":realname", sender.realname);
-            addSenderQuery.bindValue(":avatarurl", sender.avatarurl);
-            safeExec(addSenderQuery);
+    bool error = false;
+    QHash<SenderData, qint64> senderIds;
+    QHash<SenderData, qint64> newSenderIds;
+    lockForWrite();
+    for (int i = 0; i < msgs.count(); i++) {
+        auto& msg = msgs.at(i);
+        SenderData sender = {msg.sender(), msg.realName(), msg.avatarUrl()};
+        if (senderIds.contains(sender))
+            continue;
+
+        qint64 senderId = this->senderId(db, sender, newSenderIds);
+        if (!senderId) {
+            error = true;
+            break;
         }
+        senderIds.insert(sender, senderId);
     }
 
-    bool error = false;
-    {
+    if (!error) {
         QSqlQuery logMessageQuery(db);
         logMessageQuery.prepare(queryString("insert_message"));
         for (int i = 0; i < msgs.count(); i++) {
@@ -1924,11 +1945,9 @@ bool SqliteStorage::logMessages(MessageList& msgs)
             logMessageQuery.bindValue(":bufferid", msg.bufferInfo().bufferId().toInt());
             logMessageQuery.bindValue(":type", msg.type());
             logMessageQuery.bindValue(":flags", (int)msg.flags());
-            logMessageQuery.bindValue(":sender", msg.sender());
-            logMessageQuery.bindValue(":realname", msg.realName());
-            logMessageQuery.bindValue(":avatarurl", msg.avatarUrl());
+            logMessageQuery.bindValue(":senderid", senderIds.value({msg.sender(), msg.realName(), msg.avatarUrl()}));
             logMessageQuery.bindValue(":senderprefixes", msg.senderPrefixes());
-            logMessageQuery.bindValue(":message", msg.contents());
+            bool compressed = bindMessageText(logMessageQuery, msg.contents(), compressedContents.at(i));
 
             safeExec(logMessageQuery);
             if (!watchQuery(logMessageQuery)) {
@@ -1937,6 +1956,10 @@ bool SqliteStorage::logMessages(MessageList& msgs)
             }
             else {
                 msg.setMsgId(logMessageQuery.lastInsertId().toLongLong());
+                if (compressed && !indexMessageText(db, msg.msgId(), msg.contents())) {
+                    error = true;
+                    break;
+                }
             }
         }
     }
@@ -1951,11 +1974,46 @@ bool SqliteStorage::logMessages(MessageList& msgs)
     }
     else {
         db.commit();
+        cacheSenderIds(newSenderIds);
         unlock();
     }
     return !error;
 }
 
+qint64 SqliteStorage::senderId(QSqlDatabase& db, const SenderData& sender, QHash<SenderData, qint64>& newSenderIds)
+{
+    qint64 senderId = cachedSenderId(sender);
+    if (senderId)
+        return senderId;
+
+    QSqlQuery selectSenderQuery(db);
+    selectSenderQuery.prepare(queryString("select_senderid"));
+    selectSenderQuery.bindValue(":sender", sender.sender);
+    selectSenderQuery.bindValue(":realname", sender.realname);
+    selectSenderQuery.bindValue(":avatarurl", sender.avatarurl);
+    safeExec(selectSenderQuery);
+    if (!watchQuery(selectSenderQuery))
+        return 0;
+
+    if (selectSenderQuery.first()) {
+        senderId = selectSenderQuery.value(0).toLongLong();
+    }
+    else {
+        QSqlQuery addSenderQuery(db);
+        addSenderQuery.prepare(queryString("insert_sender"));
+        addSenderQuery.bindValue(":sender", sender.sender);
+        addSenderQuery.bindValue(":realname", sender.realname);
+        addSenderQuery.bindValue(":avatarurl", sender.avatarurl);
+        safeExec(addSenderQuery);
+        if (!watchQuery(addSenderQuery))
+            return 0;
+        senderId = addSenderQuery.lastInsertId().toLongLong();
+    }
+
+    newSenderIds.insert(sender, senderId);
+    return senderId;
+}
+
 std::vector<Message> SqliteStorage::requestMsgs(UserId user, BufferId bufferId, MsgId first, MsgId last, int limit)
 {
     std::vector<Message> messagelist;
@@ -1973,7 +2031,7 @@ std::vector<Message> SqliteStorage::requestMsgs(UserId user, BufferId bufferId,
         bufferInfoQuery.bindValue(":userid", user.toInt());
         bufferInfoQuery.bindValue(":bufferid", bufferId.toInt());
 
-        lockForRead();
+        lockForBacklogRead();
         safeExec(bufferInfoQuery);
         error = !watchQuery(bufferInfoQuery) || !bufferInfoQuery.first();
         if (!error) {
@@ -1987,7 +2045,7 @@ std::vector<Message> SqliteStorage::requestMsgs(UserId user, BufferId bufferId,
     }
     if (error) {
         db.rollback();
-        unlock();
+        unlockBacklogRead();
         return messagelist;
     }
 
@@ -2018,7 +2076,7 @@ std::vector<Message> SqliteStorage::requestMsgs(UserId user, BufferId bufferId,
                 QDateTime::fromMSecsSinceEpoch(query.value(1).toLongLong()),
                 bufferInfo,
                 (Message::Type)query.value(2).toInt(),
-                query.value(8).toString(),
+                messageText(query.value(8), query.value(9)),
                 query.value(4).toString(),
                 query.value(5).toString(),
                 query.value(6).toString(),
@@ -2029,7 +2087,7 @@ std::vector<Message> SqliteStorage::requestMsgs(UserId user, BufferId bufferId,
         }
     }
     db.commit();
-    unlock();
+    unlockBacklogRead();
 
     return messagelist;
 }
@@ -2052,7 +2110,7 @@ std::vector<Message> SqliteStorage::requestMsgsFiltered(
         bufferInfoQuery.bindValue(":userid", user.toInt());
         bufferInfoQuery.bindValue(":bufferid", bufferId.toInt());
 
-        lockForRead();
+        lockForBacklogRead();
         safeExec(bufferInfoQuery);
         error = !watchQuery(bufferInfoQuery) || !bufferInfoQuery.first();
         if (!error) {
@@ -2066,7 +2124,7 @@ std::vector<Message> SqliteStorage::requestMsgsFiltered(
     }
     if (error) {
         db.rollback();
-        unlock();
+        unlockBacklogRead();
         return messagelist;
     }
 
@@ -2102,7 +2160,7 @@ std::vector<Message> SqliteStorage::requestMsgsFiltered(
                 QDateTime::fromMSecsSinceEpoch(query.value(1).toLongLong()),
                 bufferInfo,
                 (Message::Type)query.value(2).toInt(),
-                query.value(8).toString(),
+                messageText(query.value(8), query.value(9)),
                 query.value(4).toString(),
                 query.value(5).toString(),
                 query.value(6).toString(),
@@ -2113,7 +2171,7 @@ std::vector<Message> SqliteStorage::requestMsgsFiltered(
         }
     }
     db.commit();
-    unlock();
+    unlockBacklogRead();
 
     return messagelist;
 }
@@ -2136,7 +2194,7 @@ std::vector<Message> SqliteStorage::requestMsgsForward(
         bufferInfoQuery.bindValue(":userid", user.toInt());
         bufferInfoQuery.bindValue(":bufferid", bufferId.toInt());
 
-        lockForRead();
+        lockForBacklogRead();
         safeExec(bufferInfoQuery);
         error = !watchQuery(bufferInfoQuery) || !bufferInfoQuery.first();
         if (!error) {
@@ -2150,7 +2208,7 @@ std::vector<Message> SqliteStorage::requestMsgsForward(
     }
     if (error) {
         db.rollback();
-        unlock();
+        unlockBacklogRead();
         return messagelist;
     }
 
@@ -2192,7 +2250,7 @@ std::vector<Message> SqliteStorage::requestMsgsForward(
                 QDateTime::fromMSecsSinceEpoch(query.value(1).toLongLong()),
                 bufferInfo,
                 (Message::Type)query.value(2).toInt(),
-                query.value(8).toString(),
+                messageText(query.value(8), query.value(9)),
                 query.value(4).toString(),
                 query.value(5).toString(),
                 query.value(6).toString(),
@@ -2203,7 +2261,7 @@ std::vector<Message> SqliteStorage::requestMsgsForward(
         }
     }
     db.commit();
-    unlock();
+    unlockBacklogRead();
 
     return messagelist;
 }
@@ -2221,7 +2279,7 @@ std::vector<Message> SqliteStorage::requestAllMsgs(UserId user, MsgId first, Msg
         bufferInfoQuery.prepare(queryString("select_buffers"));
         bufferInfoQuery.bindValue(":userid", user.toInt());
 
-        lockForRead();
+        lockForBacklogRead();
         safeExec(bufferInfoQuery);
         watchQuery(bufferInfoQuery);
         while (bufferInfoQuery.next()) {
@@ -2255,7 +2313,7 @@ std::vector<Message> SqliteStorage::requestAllMsgs(UserId user, MsgId first, Msg
                 QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()),
                 bufferInfoHash[query.value(1).toInt()],
                 (Message::Type)query.value(3).toInt(),
-                query.value(9).toString(),
+                messageText(query.value(9), query.value(10)),
                 query.value(5).toString(),
                 query.value(6).toString(),
                 query.value(7).toString(),
@@ -2266,7 +2324,7 @@ std::vector<Message> SqliteStorage::requestAllMsgs(UserId user, MsgId first, Msg
         }
     }
     db.commit();
-    unlock();
+    unlockBacklogRead();
     return messagelist;
 }
 
@@ -2284,7 +2342,7 @@ std::vector<Message> SqliteStorage::requestAllMsgsFiltered(
         bufferInfoQuery.prepare(queryString("select_buffers"));
         bufferInfoQuery.bindValue(":userid", user.toInt());
 
-        lockForRead();
+        lockForBacklogRead();
         safeExec(bufferInfoQuery);
         watchQuery(bufferInfoQuery);
         while (bufferInfoQuery.next()) {
@@ -2323,7 +2381,7 @@ std::vector<Message> SqliteStorage::requestAllMsgsFiltered(
                 QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()),
                 bufferInfoHash[query.value(1).toInt()],
                 (Message::Type)query.value(3).toInt(),
-                query.value(9).toString(),
+                messageText(query.value(9), query.value(10)),
                 query.value(5).toString(),
                 query.value(6).toString(),
                 query.value(7).toString(),
@@ -2334,10 +2392,425 @@ std::vector<Message> SqliteStorage::requestAllMsgsFiltered(
         }
     }
     db.commit();
-    unlock();
+    unlockBacklogRead();
     return messagelist;
 }
 
+std::vector<Message> SqliteStorage::searchMsgs(UserId user, BufferId bufferId, const QString& query, int limit, MsgId last)
+{
+    std::vector<Message> messagelist;
+
+    QString matchExpression = ftsMatchExpression(query);
+    if (matchExpression.isEmpty())
+        return messagelist;
+
+    QSqlDatabase db = logDb();
+    db.transaction();
+
+    QHash<BufferId, BufferInfo> bufferInfoHash;
+    {
+        QSqlQuery bufferInfoQuery(db);
+        bufferInfoQuery.prepare(queryString("select_buffers"));
+        bufferInfoQuery.bindValue(":userid", user.toInt());
+
+        lockForBacklogRead();
+        safeExec(bufferInfoQuery);
+        watchQuery(bufferInfoQuery);
+        while (bufferInfoQuery.next()) {
+            BufferInfo bufferInfo = BufferInfo(bufferInfoQuery.value(0).toInt(),
+                                               bufferInfoQuery.value(1).toInt(),
+                                               (BufferInfo::Type)bufferInfoQuery.value(2).toInt(),
+                                               bufferInfoQuery.value(3).toInt(),
+                                               bufferInfoQuery.value(4).toString());
+            bufferInfoHash[bufferInfo.bufferId()] = bufferInfo;
+        }
+
+        QSqlQuery searchQuery(db);
+        if (bufferId.isValid()) {
+            if (!bufferInfoHash.contains(bufferId)) {
+                // not one of the user's buffers
+                db.commit();
+                unlockBacklogRead();
+                return messagelist;
+            }
+            searchQuery.prepare(queryString("select_messagesSearch"));
+            searchQuery.bindValue(":bufferid", bufferId.toInt());
+        }
+        else {
+            searchQuery.prepare(queryString("select_messagesAllSearch"));
+            searchQuery.bindValue(":userid", user.toInt());
+        }
+        searchQuery.bindValue(":query", matchExpression);
+        searchQuery.bindValue(":lastmsg", last == -1 ? std::numeric_limits<qint64>::max() : last.toQint64());
+        searchQuery.bindValue(":limit", limit);
+        safeExec(searchQuery);
+
+        watchQuery(searchQuery);
+
+        while (searchQuery.next()) {
+            Message msg(
+                // As of SQLite schema version 31, timestamps are stored in milliseconds
+                // instead of seconds.  This nets us more precision as well as simplifying
+                // 64-bit time.
+                QDateTime::fromMSecsSinceEpoch(searchQuery.value(2).toLongLong()),
+                bufferInfoHash[searchQuery.value(1).toInt()],
+                (Message::Type)searchQuery.value(3).toInt(),
+                messageText(searchQuery.value(9), searchQuery.value(10)),
+                searchQuery.value(5).toString(),
+                searchQuery.value(6).toString(),
+                searchQuery.value(7).toString(),
+                searchQuery.value(8).toString(),
+                Message::Flags{searchQuery.value(4).toInt()});
+            msg.setMsgId(searchQuery.value(0).toLongLong());
+            messagelist.push_back(std::move(msg));
+        }
+    }
+    db.commit();
+    unlockBacklogRead();
+    return messagelist;
+}
+
+MsgId SqliteStorage::oldestRetainedMsgId(UserId user, BufferId bufferId, int keepCount)
+{
+    MsgId msgId;
+    if (keepCount <= 0)
+        return msgId;
+
+    QSqlDatabase db = logDb();
+    db.transaction();
+    {
+        QSqlQuery query(db);
+        query.prepare(queryString("select_backlog_retention_boundary"));
+        query.bindValue(":userid", user.toInt());
+        query.bindValue(":bufferid", bufferId.toInt());
+        query.bindValue(":offset", keepCount - 1);
+
+        lockForRead();
+        safeExec(query);
+        if (watchQuery(query) && query.first())
+            msgId = query.value(0).toLongLong();
+    }
+    db.commit();
+    unlock();
+    return msgId;
+}
+
+int SqliteStorage::deleteExpiredMsgs(UserId user, BufferId bufferId, const QDateTime& olderThan, MsgId before, int limit)
+{
+    QSqlDatabase db = logDb();
+    db.transaction();
+
+    int deleted = -1;
+    {
+        QSqlQuery query(db);
+        query.prepare(queryString("delete_backlog_expired"));
+        query.bindValue(":userid", user.toInt());
+        query.bindValue(":bufferid", bufferId.toInt());
+        // Timestamps are stored in milliseconds since the epoch, so nothing is older than 0
+        query.bindValue(":olderthan", olderThan.isValid() ? olderThan.toMSecsSinceEpoch() : 0);
+        query.bindValue(":before", before.toQint64());
+        query.bindValue(":limit", limit);
+
+        lockForWrite();
+        safeExec(query);
+        if (watchQuery(query))
+            deleted = query.numRowsAffected();
+    }
+
+    if (deleted < 0)
+        db.rollback();
+    else
+        db.commit();
+    unlock();
+    return deleted;
+}
+
+qint64 SqliteStorage::maxSenderId()
+{
+    qint64 senderId = 0;
+
+    QSqlDatabase db = logDb();
+    db.transaction();
+    {
+        QSqlQuery query(db);
+        query.prepare(queryString("select_sender_max_id"));
+
+        lockForRead();
+        safeExec(query);
+        if (watchQuery(query) && query.first())
+            senderId = query.value(0).toLongLong();
+    }
+    db.commit();
+    unlock();
+    return senderId;
+}
+
+int SqliteStorage::deleteOrphanedSenders(qint64 firstSenderId, qint64 lastSenderId)
+{
+    QSqlDatabase db = logDb();
+    db.transaction();
+
+    int deleted = -1;
+    {
+        QSqlQuery query(db);
+        query.prepare(queryString("delete_senders_orphaned"));
+        query.bindValue(":firstsenderid", firstSenderId);
+        query.bindValue(":lastsenderid", lastSenderId);
+
+        lockForWrite();
+        safeExec(query);
+        if (watchQuery(query))
+            deleted = query.numRowsAffected();
+    }
+
+    if (deleted < 0) {
+        db.rollback();
+    }
+    else {
+        db.commit();
+        // Message inserts resolve senders while holding the write lock, so nobody can pick up a deleted id
+        if (deleted > 0)
+            clearSenderIdCache();
+    }
+    unlock();
+    return deleted;
+}
+
+void SqliteStorage::compact()
+{
+    QSqlDatabase db = logDb();
+    lockForWrite();
+    {
+        QSqlQuery query(db);
+        query.exec("PRAGMA auto_vacuum");
+        // Only databases created with auto_vacuum = INCREMENTAL (2) can give back free pages incrementally
+        if (!query.first() || query.value(0).toInt() != 2) {
+            static bool hintShown = false;
+            if (!hintShown) {
+                qInfo() << "SQLite database was not created with incremental vacuum support, space freed by backlog retention is "
+                           "only reused, not returned. Run the core once with --compact-storage to enable it.";
+                hintShown = true;
+            }
+        }
+        else {
+            QSqlQuery vacuumQuery(db);
+            vacuumQuery.exec("PRAGMA incremental_vacuum");
+            // Each step of the statement frees pages, so make sure it runs to completion
+            while (vacuumQuery.next()) {
+            }
+            watchQuery(vacuumQuery);
+        }
+    }
+    unlock();
+}
+
+bool SqliteStorage::enableIncrementalCompaction()
+{
+    QSqlDatabase db = logDb();
+    lockForWrite();
+    bool success = true;
+    {
+        QSqlQuery query(db);
+        query.exec("PRAGMA auto_vacuum");
+        if (query.first() && query.value(0).toInt() == 2) {
+            qInfo() << "SQLite database already supports incremental vacuum.";
+        }
+        else {
+            // Changing the auto_vacuum mode of an existing database only takes effect once it is rebuilt by VACUUM
+            qInfo() << "Rebuilding SQLite database for incremental vacuum, this may take a while...";
+            QSqlQuery modeQuery(db);
+            modeQuery.exec("PRAGMA auto_vacuum = INCREMENTAL");
+            success = watchQuery(modeQuery);
+            if (success) {
+                QSqlQuery vacuumQuery(db);
+                vacuumQuery.exec("VACUUM");
+                success = watchQuery(vacuumQuery);
+            }
+            if (success)
+                qInfo() << "SQLite database rebuilt, space freed by backlog retention is now returned to the operating system.";
+        }
+    }
+    unlock();
+    return success;
+}
+
+bool SqliteStorage::enableMessageCompression()
+{
+    _compressionEnabled = true;
+    return true;
+}
+
+MsgId SqliteStorage::compressMsgs(MsgId after, int limit)
+{
+    if (!_compressionEnabled)
+        return {};
+
+    QSqlDatabase db = logDb();
+    db.transaction();
+    lockForWrite();
+
+    bool hasDictionary;
+    {
+        QMutexLocker locker(&_compressorMutex);
+        hasDictionary = _compressor.hasDictionary();
+    }
+
+    bool error = false;
+    int newDictionaryId = 0;
+    QByteArray newDictionary;
+    // A new dictionary is only handed to _compressor once it's committed; writers compress without holding the
+    // write lock, so they might otherwise store messages referring to a dictionary that gets rolled back
+    std::unique_ptr<MessageCompressor> newCompressor;
+    if (!hasDictionary) {
+        QStringList samples;
+        {
+            QSqlQuery query(db);
+            query.prepare(queryString("select_messages_dictionary_samples"));
+            query.bindValue(":limit", MessageCompressor::DictionarySampleSize);
+            safeExec(query);
+            error = !watchQuery(query);
+            while (query.next())
+                samples << query.value(0).toString();
+        }
+        // Wait for the backlog to grow, a dictionary trained from a handful of messages would be useless
+        if (error || samples.size() < MessageCompressor::MinDictionarySamples) {
+            db.rollback();
+            unlock();
+            return {};
+        }
+
+        newDictionary = MessageCompressor::trainDictionary(samples);
+        QSqlQuery query(db);
+        query.prepare(queryString("insert_backlog_dictionary"));
+        query.bindValue(":data", newDictionary);
+        safeExec(query);
+        error = !watchQuery(query);
+        if (!error) {
+            newDictionaryId = query.lastInsertId().toInt();
+            // Readers don't wait for us, so they must know the dictionary before the first message using it is committed
+            {
+                QMutexLocker locker(&_dictionaryMutex);
+                _dictionaries.insert(newDictionaryId, newDictionary);
+            }
+            newCompressor = std::make_unique<MessageCompressor>();
+            newCompressor->setDictionary(newDictionaryId, newDictionary);
+        }
+    }
+
+    MsgId lastMsgId;
+    std::vector<std::pair<MsgId, QString>> messages;
+    if (!error) {
+        QSqlQuery query(db);
+        query.prepare(queryString("select_messages_uncompressed"));
+        query.bindValue(":after", after.toQint64());
+        query.bindValue(":minlength", MessageCompressor::MinMessageSize);
+        query.bindValue(":limit", limit);
+        safeExec(query);
+        error = !watchQuery(query);
+        while (query.next())
+            messages.emplace_back(query.value(0).toLongLong(), query.value(1).toString());
+    }
+
+    if (!error) {
+        QSqlQuery query(db);
+        query.prepare(queryString("update_backlog_compress"));
+        for (const auto& [msgId, text] : messages) {
+            lastMsgId = msgId;
+            QByteArray data = newCompressor ? newCompressor->compress(text) : compressMessageText(text);
+            if (data.isEmpty())
+                continue;
+
+            query.bindValue(":messagedata", data);
+            query.bindValue(":messageid", msgId.toQint64());
+            safeExec(query);
+            if (!watchQuery(query)) {
+                error = true;
+                break;
+            }
+        }
+    }
+
+    if (error) {
+        db.rollback();
+        // The ID of a dictionary that was rolled back may be reused
+        if (newDictionaryId > 0) {
+            {
+                QMutexLocker locker(&_dictionaryMutex);
+                _dictionaries.remove(newDictionaryId);
+            }
+        }
+        lastMsgId = MsgId();
+    }
+    else {
+        db.commit();
+        if (newCompressor) {
+            QMutexLocker locker(&_compressorMutex);
+            _compressor.setDictionary(newDictionaryId, newDictionary);
+        }
+    }
+    unlock();
+    return lastMsgId;
+}
+
+int SqliteStorage::cleanupSearchIndex(int limit)
+{
+    QSqlDatabase db = logDb();
+    db.transaction();
+    lockForWrite();
+
+    bool error = false;
+    std::vector<std::pair<qint64, QByteArray>> entries;
+    {
+        QSqlQuery query(db);
+        query.prepare(queryString("select_backlog_fts_unindex"));
+        query.bindValue(":limit", limit);
+        safeExec(query);
+        error = !watchQuery(query);
+        while (query.next())
+            entries.emplace_back(query.value(0).toLongLong(), query.value(1).toByteArray());
+    }
+
+    int cleaned = 0;
+    if (!error) {
+        QSqlQuery ftsQuery(db);
+        ftsQuery.prepare(queryString("delete_backlog_fts"));
+        QSqlQuery deleteQuery(db);
+        deleteQuery.prepare(queryString("delete_backlog_fts_unindex"));
+        for (const auto& [msgId, data] : entries) {
+            // FTS5 needs the original text for removing a row from the index. If we can't restore it, the
+            // stale entry stays, but it can't turn up in search results as its message is gone.
+            QString text;
+            if (MessageCompressor::decompress(data, [this](int dictionaryId) { return dictionary(dictionaryId); }, text)) {
+                ftsQuery.bindValue(":messageid", msgId);
+                ftsQuery.bindValue(":message", text);
+                safeExec(ftsQuery);
+                if (!watchQuery(ftsQuery)) {
+                    error = true;
+                    break;
+                }
+            }
+
+            deleteQuery.bindValue(":messageid", msgId);
+            safeExec(deleteQuery);
+            if (!watchQuery(deleteQuery)) {
+                error = true;
+                break;
+            }
+            ++cleaned;
+        }
+    }
+
+    if (error) {
+        db.rollback();
+        cleaned = -1;
+    }
+    else {
+        db.commit();
+    }
+    unlock();
+    return cleaned;
+}
+
 QMap<UserId, QString> SqliteStorage::getAllAuthUserNames()
 {
     QMap<UserId, QString> authusernames;
@@ -2365,6 +2838,129 @@ QString SqliteStorage::backlogFile()
     return Quassel::configDirPath() + "quassel-storage.sqlite";
 }
 
+QString SqliteStorage::ftsMatchExpression(const QString& query)
+{
+    // User input must not be interpreted as FTS5 query syntax, so every term is turned into a quoted
+    // string (escaping embedded quotes by doubling them). Terms are implicitly ANDed by FTS5.
+    QStringList terms;
+    for (const QString& term : query.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts)) {
+        terms << QString("\"%1\"").arg(QString(term).replace('"', QLatin1String("\"\"")));
+    }
+    return terms.join(' ');
+}
+
+void SqliteStorage::enableWriteAheadLog()
+{
+    QSqlDatabase db = logDb();
+    QSqlQuery query(db);
+    query.exec("PRAGMA journal_mode = WAL");
+    // The journal mode stays the same if WAL is not supported, e.g. on some network file systems
+    _walMode = query.first() && query.value(0).toString().compare("wal", Qt::CaseInsensitive) == 0;
+    if (!_walMode) {
+        qWarning() << "SqliteStorage: could not enable write-ahead logging, backlog requests will block message logging";
+    }
+}
+
+void SqliteStorage::loadDictionaries()
+{
+    QSqlQuery query(logDb());
+    query.prepare(queryString("select_backlog_dictionaries"));
+
+    lockForRead();
+    safeExec(query);
+    watchQuery(query);
+    int latestId = 0;
+    QByteArray latest;
+    {
+        QMutexLocker locker(&_dictionaryMutex);
+        while (query.next()) {
+            latestId = query.value(0).toInt();
+            latest = query.value(1).toByteArray();
+            _dictionaries.insert(latestId, latest);
+        }
+    }
+    unlock();
+
+    if (latestId > 0) {
+        QMutexLocker locker(&_compressorMutex);
+        _compressor.setDictionary(latestId, latest);
+    }
+}
+
+QByteArray SqliteStorage::dictionary(int dictionaryId)
+{
+    QMutexLocker locker(&_dictionaryMutex);
+    return _dictionaries.value(dictionaryId);
+}
+
+QByteArray SqliteStorage::compressMessageText(const QString& text)
+{
+    if (!_compressionEnabled)
+        return {};
+
+    QMutexLocker locker(&_compressorMutex);
+    return _compressor.compress(text);
+}
+
+bool SqliteStorage::bindMessageText(QSqlQuery& query, const QString& text, const QByteArray& compressed)
+{
+    if (compressed.isEmpty()) {
+        query.bindValue(":message", text);
+        query.bindValue(":messagedata", QVariant(QMetaType(QMetaType::QByteArray)));
+        return false;
+    }
+    query.bindValue(":message", QVariant(QMetaType(QMetaType::QString)));
+    query.bindValue(":messagedata", compressed);
+    return true;
+}
+
+bool SqliteStorage::indexMessageText(QSqlDatabase& db, MsgId msgId, const QString& text)
+{
+    QSqlQuery query(db);
+    query.prepare(queryString("insert_backlog_fts"));
+    query.bindValue(":messageid", msgId.toQint64());
+    query.bindValue(":message", text);
+    safeExec(query);
+    return watchQuery(query);
+}
+
+QString SqliteStorage::messageText(const QVariant& message, const QVariant& messageData)
+{
+    if (messageData.isNull())
+        return message.toString();
+
+    QString text;
+    if (!MessageCompressor::decompress(messageData.toByteArray(), [this](int dictionaryId) { return dictionary(dictionaryId); }, text))
+        qWarning() << "SqliteStorage: could not decompress message text, the backlog may be corrupt";
+    return text;
+}
+
+void SqliteStorage::lockForWrite()
+{
+    QElapsedTimer waitTimer;
+    waitTimer.start();
+    _dbLock.lockForWrite();
+    _writeLockWait = waitTimer.nsecsElapsed();
+    _writeLockOwner = QThread::currentThreadId();
+    _writeLockTimer.start();
+}
+
+void SqliteStorage::unlock()
+{
+    // The lock is not recursive, so a thread owning the write lock cannot hold a read lock at the same time
+    if (_writeLockOwner.load() != QThread::currentThreadId()) {
+        _dbLock.unlock();
+        return;
+    }
+
+    qint64 held = _writeLockTimer.nsecsElapsed();
+    qint64 wait = _writeLockWait;
+    _writeLockOwner = nullptr;
+    _dbLock.unlock();
+    if (metricsServer())
+        metricsServer()->addStorageWriteLock(wait, held);
+}
+
 bool SqliteStorage::safeExec(QSqlQuery& query, int retryCount)
 {
     query.exec();
@@ -2438,6 +3034,8 @@ bool SqliteMigrationReader::prepareQuery(MigrationObject mo)
         bindValue(1, stepSize());
         break;
     case Backlog:
+        // The reader is not initialized like a regular storage, but needs the dictionaries of compressed messages
+        loadDictionaries();
         newQuery(queryString("migrate_read_backlog"), logDb());
         bindValue(0, 0);
         bindValue(1, stepSize());
@@ -2619,7 +3217,7 @@ bool SqliteMigrationReader::readMo(BacklogMO& backlog)
     backlog.flags = value(4).toInt();
     backlog.senderid = value(5).toLongLong();
     backlog.senderprefixes = value(6).toString();
-    backlog.message = value(7).toString();
+    backlog.message = messageText(value(7), value(8));
     return true;
 }
 
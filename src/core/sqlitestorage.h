@@ -3,12 +3,17 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
 #include <QReadWriteLock>
 #include <QSqlDatabase>
 
 #include "abstractsqlstorage.h"
+#include "messagecompressor.h"
 
 class QSqlQuery;
 
@@ -117,10 +122,29 @@ public:
                                                 int limit = -1,
                                                 Message::Types type = Message::Types{-1},
                                                 Message::Flags flags = Message::Flags{-1}) override;
+    std::vector<Message> searchMsgs(UserId user, BufferId bufferId, const QString& query, int limit = -1, MsgId last = -1) override;
+
+    /* Backlog retention */
+    MsgId oldestRetainedMsgId(UserId user, BufferId bufferId, int keepCount) override;
+    int deleteExpiredMsgs(UserId user, BufferId bufferId, const QDateTime& olderThan, MsgId before, int limit) override;
+    qint64 maxSenderId() override;
+    int deleteOrphanedSenders(qint64 firstSenderId, qint64 lastSenderId) override;
+    void compact() override;
+    bool enableIncrementalCompaction() override;
+
+    /* Backlog compression */
+    bool enableMessageCompression() override;
+    MsgId compressMsgs(MsgId after, int limit) override;
+    int cleanupSearchIndex(int limit) override;
 
     /* Sysident handling */
     QMap<UserId, QString> getAllAuthUserNames() override;
 
+public slots:
+    State init(const QVariantMap& settings = QVariantMap(),
+               const QProcessEnvironment& environment = {},
+               bool loadFromEnvironment = false) override;
+
 protected:
     void setConnectionProperties(const QVariantMap& properties, const QProcessEnvironment& environment, bool loadFromEnvironment) override
     {
@@ -154,14 +178,107 @@ protected:
 
 private:
     static QString backlogFile();
+    static QString ftsMatchExpression(const QString& query);
     void bindNetworkInfo(QSqlQuery& query, const NetworkInfo& info);
     void bindServerInfo(QSqlQuery& query, const Network::Server& server);
 
+    /**
+     * Resolves the ID of a sender, adding the sender to the database if necessary
+     *
+     * Has to be called from within a write transaction. IDs that were not served from the sender ID
+     * cache are added to @a newSenderIds, so they can be cached once the transaction is committed.
+     *
+     * @param db            The database connection holding the transaction
+     * @param sender        The sender to resolve
+     * @param newSenderIds  Collects the sender IDs fetched from the database
+     * @return The sender ID, or 0 on error
+     */
+    qint64 senderId(QSqlDatabase& db, const SenderData& sender, QHash<SenderData, qint64>& newSenderIds);
+
+    /**
+     * Switches the database to write-ahead logging, if possible
+     *
+     * In WAL mode, readers work on a snapshot of the database and neither block nor are blocked by the
+     * writer. Must be called before the storage is used by multiple threads, as it determines how
+     * lockForBacklogRead() behaves.
+     */
+    void enableWriteAheadLog();
+
+    /**
+     * Loads the compression dictionaries, and selects the most recent one for compressing new messages
+     */
+    void loadDictionaries();
+
+    /// @returns The compression dictionary with the given ID, or an empty QByteArray if unknown
+    QByteArray dictionary(int dictionaryId);
+
+    /**
+     * Compresses a message text for storage
+     *
+     * Doesn't need the write lock, so texts should be compressed before acquiring it.
+     *
+     * @returns The compressed text, or an empty QByteArray if compression is disabled or not worthwhile
+     */
+    QByteArray compressMessageText(const QString& text);
+
+    /**
+     * Binds a message text to the :message and :messagedata placeholders of a query
+     *
+     * If compressed data is given, the text is bound in compressed form, and the message has to be
+     * added to the search index with indexMessageText() once it is inserted.
+     *
+     * @param compressed The text as returned by compressMessageText()
+     * @returns true if the text was bound in compressed form
+     */
+    bool bindMessageText(QSqlQuery& query, const QString& text, const QByteArray& compressed);
+
+    /**
+     * Adds the text of a compressed message to the search index
+     *
+     * The FTS triggers only see the message column, which is empty for compressed messages.
+     */
+    bool indexMessageText(QSqlDatabase& db, MsgId msgId, const QString& text);
+
+    /**
+     * Restores a message text as read from the database, decompressing it if necessary
+     *
+     * @param message      The value of the message column
+     * @param messageData  The value of the messagedata column
+     */
+    QString messageText(const QVariant& message, const QVariant& messageData);
+
     inline void lockForRead() { _dbLock.lockForRead(); }
-    inline void lockForWrite() { _dbLock.lockForWrite(); }
-    inline void unlock() { _dbLock.unlock(); }
+    void lockForWrite();
+    void unlock();
+
+    /**
+     * Acquires the lock for a read-only transaction, unless the database is in WAL mode
+     *
+     * Must only be used for transactions that never write, and has to be paired with unlockBacklogRead().
+     */
+    inline void lockForBacklogRead()
+    {
+        if (!_walMode)
+            _dbLock.lockForRead();
+    }
+    inline void unlockBacklogRead()
+    {
+        if (!_walMode)
+            _dbLock.unlock();
+    }
+
     QReadWriteLock _dbLock;
+    bool _walMode{false};                              ///< Set once during init(), before other threads access the storage
+    std::atomic<Qt::HANDLE> _writeLockOwner{nullptr};  ///< Thread currently holding the write lock
+    QElapsedTimer _writeLockTimer;                     ///< Started when the write lock was acquired, protected by _dbLock
+    qint64 _writeLockWait{0};                          ///< Time spent waiting for the current write lock, protected by _dbLock
     static int _maxRetryCount;
+
+    MessageCompressor _compressor;         ///< Protected by _compressorMutex
+    QMutex _compressorMutex;               ///< Writers compress texts without holding _dbLock
+    bool _compressionEnabled{false};       ///< Set once during startup, before other threads access the storage
+    QHash<int, QByteArray> _dictionaries;  ///< Compression dictionaries by ID, protected by _dictionaryMutex
+    QMutex _dictionaryMutex;               ///< Readers access the dictionaries without holding _dbLock
 };
 
 // ========================================
@@ -13,6 +13,11 @@ Storage::Storage(QObject* parent)
 {
 }
 
+void Storage::setMetricsServer(MetricsServer* metricsServer)
+{
+    _metricsServer = metricsServer;
+}
+
 QString Storage::hashPassword(const QString& password)
 {
     return hashPasswordSha2_512(password);
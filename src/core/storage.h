@@ -17,6 +17,8 @@
 #include "network.h"
 #include "types.h"
 
+class MetricsServer;
+
 class Storage : public QObject
 {
     Q_OBJECT
@@ -95,6 +97,11 @@ public:
      */
     virtual void sync() = 0;
 
+    //! Sets the MetricsServer the storage backend reports its statistics to
+    /** \param metricsServer The MetricsServer, or nullptr to disable reporting
+     */
+    void setMetricsServer(MetricsServer* metricsServer);
+
     // TODO: Add functions for configuring the backlog handling, i.e. defining auto-cleanup settings etc
 
     /* User handling */
@@ -552,6 +559,88 @@ public:
                                                         Message::Flags flags = Message::Flags{-1})
         = 0;
 
+    //! Search the backlog of a user using the backend's full-text index
+    /** \param bufferId The buffer to search in; if invalid, all buffers of the user are searched
+     *  \param query    The search terms; all of them need to be contained in a message
+     *  \param limit    if != -1 limit the returned list to a max of \limit entries
+     *  \param last     if != -1 return only messages with a MsgId < last
+     *  \return The matching messages, ordered by relevance
+     */
+    virtual std::vector<Message> searchMsgs(UserId user, BufferId bufferId, const QString& query, int limit = -1, MsgId last = -1) = 0;
+
+    /* Backlog retention */
+
+    //! Find the oldest message a buffer retains when only its newest messages are kept
+    /** \param user      The user owning the buffer
+     *  \param bufferId  The buffer
+     *  \param keepCount The number of newest messages to keep
+     *  \return The MsgId of the oldest retained message, or an invalid MsgId if the buffer holds no more than keepCount messages
+     */
+    virtual MsgId oldestRetainedMsgId(UserId user, BufferId bufferId, int keepCount) = 0;
+
+    //! Delete a batch of messages that fall outside a buffer's retention policy
+    /** \param user      The user owning the buffer
+     *  \param bufferId  The buffer
+     *  \param olderThan Messages older than this are deleted; if invalid, the age of messages is not considered
+     *  \param before    Messages with a MsgId lower than this are deleted; if invalid, no messages are deleted by id
+     *  \param limit     Max amount of messages to delete
+     *  \return The number of deleted messages, or -1 on error
+     */
+    virtual int deleteExpiredMsgs(UserId user, BufferId bufferId, const QDateTime& olderThan, MsgId before, int limit) = 0;
+
+    //! Get the highest sender id in use
+    /** \return The highest sender id, or 0 if there are no senders
+     */
+    virtual qint64 maxSenderId() = 0;
+
+    //! Delete senders that are no longer referenced by any message
+    /** Only senders within the given range of ids are considered, so large tables can be processed in batches.
+     *  \param firstSenderId Only senders with an id greater than this are considered
+     *  \param lastSenderId  Only senders with an id up to and including this are considered
+     *  \return The number of deleted senders, or -1 on error
+     */
+    virtual int deleteOrphanedSenders(qint64 firstSenderId, qint64 lastSenderId) = 0;
+
+    //! Reclaim the space left behind by deleted rows
+    virtual void compact() = 0;
+
+    //! Prepare the database for compact() to give freed space back to the operating system
+    /** Some backends need to rewrite the whole database for this, which takes long and temporarily needs as much
+     *  disk space as the database itself. It is therefore only done on explicit request, while the core isn't running.
+     *  \return true on success, or if the database is already prepared
+     */
+    virtual bool enableIncrementalCompaction() { return true; }
+
+    //! Store the text of new messages compressed
+    /** Compressed messages remain searchable. Backends not supporting compression keep storing plain text.
+     *  \return true if the backend supports compression
+     */
+    virtual bool enableMessageCompression() { return false; }
+
+    //! Compress the text of already stored messages
+    /** Messages are processed in order of their ids, so large backlogs can be compressed in batches.
+     *  \param after Only messages with an id greater than this are considered
+     *  \param limit Max amount of messages to process
+     *  \return The id of the last processed message, or an invalid MsgId if there is nothing left to compress
+     */
+    virtual MsgId compressMsgs(MsgId after, int limit)
+    {
+        Q_UNUSED(after)
+        Q_UNUSED(limit)
+        return {};
+    }
+
+    //! Remove deleted compressed messages from the search index
+    /** Deleting compressed messages leaves their entries in the search index behind, which are cleaned up here.
+     *  \param limit Max amount of messages to process
+     *  \return The number of processed messages, or -1 on error
+     */
+    virtual int cleanupSearchIndex(int limit)
+    {
+        Q_UNUSED(limit)
+        return 0;
+    }
+
     //! Fetch all authusernames
     /** \return      Map of all current UserIds to permitted idents
      */
@@ -573,6 +662,8 @@ signals:
     void dbUpgradeInProgress(bool inProgress);
 
 protected:
+    inline MetricsServer* metricsServer() const { return _metricsServer; }
+
     QString hashPassword(const QString& password);
     bool checkHashedPassword(const UserId user, const QString& password, const QString& hashedPassword, const Storage::HashVersion version);
 
@@ -583,4 +674,6 @@ private:
     QString hashPasswordSha2_512(const QString& password);
     bool checkHashedPasswordSha2_512(const QString& password, const QString& hashedPassword);
     QString sha2_512(const QString& input);
+
+    MetricsServer* _metricsServer{nullptr};
 };
@@ -0,0 +1,144 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "storagewriter.h"
+
+#include <utility>
+
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "storage.h"
+
+StorageWriter::StorageWriter(std::shared_ptr<Storage> storage, int latencyBudget, QObject* parent)
+    : QObject(parent)
+    , _storage{std::move(storage)}
+    , _latencyBudget{qMax(0, latencyBudget)}
+{
+    _thread = QThread::create([this] { run(); });
+    _thread->setObjectName("StorageWriter");
+    _thread->start();
+}
+
+StorageWriter::~StorageWriter()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _stopping = true;
+    }
+    _jobsAvailable.wakeAll();
+    _thread->wait();
+    delete _thread;
+}
+
+int StorageWriter::latencyBudget() const
+{
+    return _latencyBudget;
+}
+
+void StorageWriter::enqueue(QObject* context, MessageList messages, Callback callback)
+{
+    // The writer thread must not touch the context, which may be destroyed in its own thread at any time. Instead, it
+    // posts the callback to a relay object that stays alive until the callback has been delivered.
+    if (messages.isEmpty()) {
+        return;
+    }
+    auto* relay = new QObject;
+    relay->moveToThread(context->thread());
+    Job job{relay, context, std::move(messages), std::move(callback)};
+
+    QMutexLocker locker(&_mutex);
+    if (_stopping) {
+        // The writer thread is gone or about to be, so store synchronously in the caller's thread
+        locker.unlock();
+        bool success = _storage->logMessages(job.messages);
+        deliver(job, success);
+        return;
+    }
+
+    _pendingMessages += job.messages.count();
+    _jobs.push_back(std::move(job));
+    // Only wake the writer when it has to start a new batch, or when the current batch is full
+    if (_jobs.size() == 1 || _pendingMessages >= MaxBatchSize) {
+        _jobsAvailable.wakeOne();
+    }
+}
+
+void StorageWriter::run()
+{
+    QMutexLocker locker(&_mutex);
+    while (true) {
+        while (_jobs.empty() && !_stopping) {
+            _jobsAvailable.wait(&_mutex);
+        }
+        if (_jobs.empty()) {
+            break;  // stopping, and nothing left to commit
+        }
+
+        // Give other sessions the chance to join this batch
+        QDeadlineTimer deadline{_latencyBudget};
+        while (!_stopping && _pendingMessages < MaxBatchSize && !deadline.hasExpired()) {
+            _jobsAvailable.wait(&_mutex, deadline);
+        }
+
+        std::vector<Job> jobs;
+        jobs.swap(_jobs);
+        _pendingMessages = 0;
+
+        locker.unlock();
+        commit(jobs);
+        locker.relock();
+    }
+}
+
+void StorageWriter::commit(std::vector<Job>& jobs)
+{
+    MessageList batch;
+    if (jobs.size() == 1) {
+        batch = jobs.front().messages;
+    }
+    else {
+        for (auto&& job : jobs) {
+            batch += job.messages;
+        }
+    }
+
+    if (_storage->logMessages(batch)) {
+        int offset = 0;
+        for (auto&& job : jobs) {
+            int count = job.messages.count();
+            job.messages = batch.mid(offset, count);
+            offset += count;
+            deliver(job, true);
+        }
+        return;
+    }
+
+    // The whole batch was rolled back; retry each job on its own. This gets a single job past transient errors, and
+    // keeps a single bad message from costing the other sessions their backlog.
+    qWarning() << "Could not commit batch of" << batch.count() << "messages from" << jobs.size() << "sources, retrying individually";
+    for (auto&& job : jobs) {
+        bool success = _storage->logMessages(job.messages);
+        deliver(job, success);
+    }
+}
+
+void StorageWriter::deliver(Job& job, bool success)
+{
+    // Runs in the context's thread, so checking the context can't race with its destruction
+    QMetaObject::invokeMethod(
+        job.relay,
+        [relay = job.relay,
+         context = std::move(job.context),
+         callback = std::move(job.callback),
+         messages = std::move(job.messages),
+         success]() {
+            if (context && callback) {
+                callback(success, messages);
+            }
+            relay->deleteLater();
+        },
+        Qt::QueuedConnection);
+}
@@ -0,0 +1,107 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QWaitCondition>
+
+#include "message.h"
+
+class QThread;
+class Storage;
+
+/**
+ * Asynchronous message writer with group commit.
+ *
+ * Sessions hand their freshly received messages to the writer instead of storing them synchronously
+ * in their own thread. The writer runs in a dedicated thread and collects everything enqueued within
+ * a short latency budget, so that the messages of all active sessions end up being stored in a single
+ * transaction. Once the batch is committed, the assigned MsgIds are handed back to the submitting
+ * session by invoking its callback in the thread of the given context object.
+ */
+class StorageWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Callback invoked once a submitted batch has been stored.
+     *
+     * @param success  Whether the messages could be stored
+     * @param messages The submitted messages, with their MsgIds set on success
+     */
+    using Callback = std::function<void(bool success, MessageList messages)>;
+
+    /// Default time (in milliseconds) the writer waits for further messages before committing
+    static constexpr int DefaultLatencyBudget{10};
+
+    /// Number of pending messages that triggers a commit without waiting for the latency budget to expire
+    static constexpr int MaxBatchSize{1000};
+
+    /**
+     * Constructor.
+     *
+     * @param storage       The storage backend to write to
+     * @param latencyBudget Maximum time (in milliseconds) a message may wait for others to join its batch
+     * @param parent        Parent object
+     */
+    StorageWriter(std::shared_ptr<Storage> storage, int latencyBudget = DefaultLatencyBudget, QObject* parent = nullptr);
+
+    /**
+     * Destructor.
+     *
+     * Commits all pending messages and stops the writer thread.
+     */
+    ~StorageWriter() override;
+
+    /**
+     * Enqueues a list of messages to be stored.
+     *
+     * The callback is invoked in the thread of @a context once the messages have been committed. If
+     * @a context has been destroyed in the meantime, the callback is dropped. Callbacks of the same
+     * context are invoked in the order their messages were enqueued. An empty list is ignored, and
+     * its callback is never invoked.
+     *
+     * @note This method is threadsafe.
+     *
+     * @param context  Context object determining the thread and lifetime of the callback
+     * @param messages The messages to store
+     * @param callback Invoked with the stored messages
+     */
+    void enqueue(QObject* context, MessageList messages, Callback callback);
+
+    /// @returns The latency budget in milliseconds
+    int latencyBudget() const;
+
+private:
+    struct Job
+    {
+        QObject* relay;              ///< Lives in the context's thread until the callback has been delivered
+        QPointer<QObject> context;   ///< Only to be accessed in the context's thread
+        MessageList messages;
+        Callback callback;
+    };
+
+    void run();
+    void commit(std::vector<Job>& jobs);
+    static void deliver(Job& job, bool success);
+
+private:
+    std::shared_ptr<Storage> _storage;
+    int _latencyBudget;
+
+    QThread* _thread{nullptr};
+
+    QMutex _mutex;
+    QWaitCondition _jobsAvailable;
+    std::vector<Job> _jobs;   ///< Pending jobs, protected by _mutex
+    int _pendingMessages{0};  ///< Number of messages in _jobs, protected by _mutex
+    bool _stopping{false};    ///< Set when the writer is shutting down, protected by _mutex
+};
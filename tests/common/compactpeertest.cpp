@@ -0,0 +1,359 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "peerfactory.h"
+
+#include <limits>
+#include <utility>
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTest>
+#include <QTimeZone>
+#include <QtEndian>
+
+#include "bufferinfo.h"
+#include "invocationspy.h"
+#include "message.h"
+#include "remotepeer.h"
+#include "signalproxy.h"
+#include "syncableobject.h"
+#include "testglobal.h"
+#include "types.h"
+
+using namespace ::testing;
+using namespace test;
+
+namespace {
+
+/// Parameters covering every type with a compact encoding, plus one that falls back to the DataStream serialization
+QVariantList allParams()
+{
+    BufferInfo bufferInfo{BufferId{7}, NetworkId{2}, BufferInfo::ChannelBuffer, 3, "#quassel"};
+    Message message{QDateTime::fromMSecsSinceEpoch(1710408413589),
+                    bufferInfo,
+                    Message::Action,
+                    "waves at everyone 👋",
+                    "alice!~alice@203.0.113.7",
+                    "@",
+                    "Alice Example",
+                    "https://example.com/alice.png",
+                    Message::Highlight | Message::Backlog};
+    message.setMsgId(MsgId{Q_INT64_C(5000000000)});
+
+    return {QVariant{},
+            false,
+            true,
+            0,
+            -1,
+            std::numeric_limits<int>::min(),
+            std::numeric_limits<int>::max(),
+            0u,
+            std::numeric_limits<uint>::max(),
+            std::numeric_limits<qlonglong>::min(),
+            std::numeric_limits<qlonglong>::max(),
+            std::numeric_limits<qulonglong>::max(),
+            QString{},
+            QString{""},
+            QString{"Grüße"},
+            QByteArray{},
+            QByteArray{"\0\xff", 2},
+            QStringList{"alice", QString{}, "bob"},
+            QVariant::fromValue(BufferId{-1}),
+            QVariant::fromValue(NetworkId{42}),
+            QVariant::fromValue(IdentityId{1}),
+            QVariant::fromValue(MsgId{-1}),
+            QVariant::fromValue(bufferInfo),
+            QVariant::fromValue(message),
+            QVariantList{1, QVariantList{"nested", QVariantMap{{"key", 2.5}}}},
+            QVariantMap{{"away", true}, {"nick", "alice"}, {"", QVariant{}}},
+            QDateTime::fromMSecsSinceEpoch(1710408413589, QTimeZone::UTC)};
+}
+
+void expectEqualBufferInfo(const BufferInfo& expected, const BufferInfo& actual)
+{
+    EXPECT_EQ(expected.bufferId(), actual.bufferId());
+    EXPECT_EQ(expected.networkId(), actual.networkId());
+    EXPECT_EQ(expected.type(), actual.type());
+    EXPECT_EQ(expected.groupId(), actual.groupId());
+    EXPECT_EQ(expected.bufferName(), actual.bufferName());
+}
+
+void expectEqualParams(const QVariantList& expected, const QVariantList& actual)
+{
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int i = 0; i < expected.size(); ++i) {
+        SCOPED_TRACE(i);
+        const QVariant& exp = expected[i];
+        const QVariant& act = actual[i];
+        ASSERT_EQ(exp.userType(), act.userType());
+
+        // Neither BufferInfo nor Message compare all of their fields
+        if (exp.userType() == qMetaTypeId<BufferInfo>()) {
+            expectEqualBufferInfo(exp.value<BufferInfo>(), act.value<BufferInfo>());
+        }
+        else if (exp.userType() == qMetaTypeId<Message>()) {
+            auto expMsg = exp.value<Message>();
+            auto actMsg = act.value<Message>();
+            EXPECT_EQ(expMsg.msgId(), actMsg.msgId());
+            EXPECT_EQ(expMsg.timestamp(), actMsg.timestamp());
+            EXPECT_EQ(expMsg.type(), actMsg.type());
+            EXPECT_EQ(expMsg.flags(), actMsg.flags());
+            expectEqualBufferInfo(expMsg.bufferInfo(), actMsg.bufferInfo());
+            EXPECT_EQ(expMsg.sender(), actMsg.sender());
+            EXPECT_EQ(expMsg.senderPrefixes(), actMsg.senderPrefixes());
+            EXPECT_EQ(expMsg.realName(), actMsg.realName());
+            EXPECT_EQ(expMsg.avatarUrl(), actMsg.avatarUrl());
+            EXPECT_EQ(expMsg.contents(), actMsg.contents());
+        }
+        else if (exp.userType() == QMetaType::QString) {
+            EXPECT_EQ(exp.toString(), act.toString());
+            EXPECT_EQ(exp.toString().isNull(), act.toString().isNull());
+        }
+        else if (exp.userType() == QMetaType::QByteArray) {
+            EXPECT_EQ(exp.toByteArray(), act.toByteArray());
+            EXPECT_EQ(exp.toByteArray().isNull(), act.toByteArray().isNull());
+        }
+        else if (exp.userType() == QMetaType::QVariantList) {
+            expectEqualParams(exp.toList(), act.toList());
+        }
+        else {
+            EXPECT_EQ(exp, act);
+        }
+    }
+}
+
+/// Builds a compact frame from raw bytes, as the values used in the protocol can't occur in a string literal
+QByteArray frame(std::initializer_list<quint8> bytes)
+{
+    QByteArray data;
+    for (quint8 byte : bytes)
+        data.append(static_cast<char>(byte));
+    return data;
+}
+
+// Values used in compact frames
+constexpr quint8 syncFrame{0xc1};
+constexpr quint8 rpcFrame{0xc2};
+constexpr quint8 nameDefinition{0};
+constexpr quint8 nameLiteral{1};
+constexpr quint8 intParam{3};
+constexpr quint8 stringParam{7};
+constexpr quint8 variantListParam{16};
+constexpr quint8 variantParam{18};
+
+}  // namespace
+
+class Emitter : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void sendParams(const QVariantList&);
+};
+
+class ParamsObject : public SyncableObject
+{
+    Q_OBJECT
+    SYNCABLE_OBJECT
+
+public:
+    QVariantList params() const { return _params; }
+
+public slots:
+    QVariantList initParams() const { return _params; }
+    void initSetParams(const QVariantList& params) { _params = params; }
+
+    void setParams(const QVariantList& params)
+    {
+        _params = params;
+        SYNC(ARG(params));
+        emit paramsSet(params);
+    }
+
+signals:
+    void paramsSet(const QVariantList&);
+
+private:
+    QVariantList _params;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------------
+
+class CompactPeerTest : public QObject, public ::testing::Test
+{
+    Q_OBJECT
+
+public:
+    void SetUp() override { ASSERT_TRUE(_server.listen(QHostAddress::LocalHost)); }
+
+protected:
+    /// @returns A connected pair of client and server sockets, or a pair of nullptrs on failure
+    std::pair<QTcpSocket*, QTcpSocket*> connectSockets()
+    {
+        auto* clientSocket = new QTcpSocket{this};
+        clientSocket->connectToHost(QHostAddress::LocalHost, _server.serverPort());
+        if (!clientSocket->waitForConnected(5000) || !_server.waitForNewConnection(5000))
+            return {};
+        return {clientSocket, _server.nextPendingConnection()};
+    }
+
+    RemotePeer* createPeer(QTcpSocket* socket)
+    {
+        return PeerFactory::createPeer({QuasselProtocol::CompactProtocol, 0}, nullptr, socket, Compressor::NoCompression, Compressor::Zlib, this);
+    }
+
+    /// Connects a client and a server peer talking the compact protocol
+    void connectPeers()
+    {
+        auto [clientSocket, serverSocket] = connectSockets();
+        ASSERT_NE(nullptr, serverSocket);
+        ASSERT_TRUE(_clientProxy.addPeer(createPeer(clientSocket)));
+        ASSERT_TRUE(_serverProxy.addPeer(createPeer(serverSocket)));
+    }
+
+    /**
+     * Sends a frame from a raw socket to a server peer.
+     *
+     * @param data The frame's contents
+     * @param size The size announced for the frame
+     * @returns The sending socket, or nullptr if connecting failed
+     */
+    QTcpSocket* sendFrame(const QByteArray& data, quint32 size)
+    {
+        auto [clientSocket, serverSocket] = connectSockets();
+        if (!serverSocket || !_serverProxy.addPeer(createPeer(serverSocket)))
+            return nullptr;
+
+        size = qToBigEndian<quint32>(size);
+        clientSocket->write(reinterpret_cast<const char*>(&size), 4);
+        clientSocket->write(data);
+        return clientSocket;
+    }
+
+    /// @returns Whether the server peer closed the connection after receiving the given frame
+    bool rejects(const QByteArray& data, quint32 size)
+    {
+        QTcpSocket* socket = sendFrame(data, size);
+        return socket && QTest::qWaitFor([socket]() { return socket->state() == QAbstractSocket::UnconnectedState; }, 5000);
+    }
+
+    bool rejects(const QByteArray& data) { return rejects(data, data.size()); }
+
+protected:
+    QTcpServer _server;
+    SignalProxy _clientProxy{SignalProxy::ProxyMode::Client, this};
+    SignalProxy _serverProxy{SignalProxy::ProxyMode::Server, this};
+};
+
+TEST_F(CompactPeerTest, rpcCallRoundTrip)
+{
+    connectPeers();
+
+    Emitter emitter;
+    ValueSpy<QVariantList> spy;
+    _serverProxy.attachSignal(&emitter, &Emitter::sendParams);
+    _clientProxy.attachSlot(SIGNAL(sendParams(QVariantList)), this, [&spy](const QVariantList& params) { spy.notify(params); });
+
+    // The second call refers to the signal name interned by the first one
+    for (int i = 0; i < 2; ++i) {
+        emit emitter.sendParams(allParams());
+        ASSERT_TRUE(spy.wait());
+        expectEqualParams(allParams(), spy.value());
+    }
+}
+
+TEST_F(CompactPeerTest, syncMessageRoundTrip)
+{
+    connectPeers();
+
+    SignalSpy spy;
+    ParamsObject serverObject;
+    ParamsObject clientObject;
+    serverObject.initSetParams({42, "init"});
+    serverObject.setObjectName("Foo");
+    clientObject.setObjectName("Foo");
+
+    // InitRequest and InitData are exchanged like in the DataStream protocol
+    spy.connect(&serverObject, &SyncableObject::initDone);
+    _serverProxy.synchronize(&serverObject);
+    ASSERT_TRUE(spy.wait());
+    spy.connect(&clientObject, &SyncableObject::initDone);
+    _clientProxy.synchronize(&clientObject);
+    ASSERT_TRUE(spy.wait());
+    EXPECT_EQ((QVariantList{42, "init"}), clientObject.params());
+
+    // The second call refers to the class, object and slot names interned by the first one
+    for (int i = 0; i < 2; ++i) {
+        spy.connect(&clientObject, &ParamsObject::paramsSet);
+        serverObject.setParams(allParams());
+        ASSERT_TRUE(spy.wait());
+        expectEqualParams(allParams(), clientObject.params());
+    }
+}
+
+TEST_F(CompactPeerTest, wellFormedFrame)
+{
+    ValueSpy<int> spy;
+    _serverProxy.attachSlot(SIGNAL(ping(int)), this, [&spy](int i) { spy.notify(i); });
+
+    // RpcCall of ping(int) with 42 (zigzag encoded), defining the signal name
+    QByteArray data = frame({rpcFrame, nameDefinition, 11}) + "2ping(int)" + frame({1, intParam, 84});
+    QTcpSocket* socket = sendFrame(data, data.size());
+    ASSERT_NE(nullptr, socket);
+    ASSERT_TRUE(spy.wait());
+    EXPECT_EQ(42, spy.value());
+    EXPECT_EQ(QAbstractSocket::ConnectedState, socket->state());
+}
+
+TEST_F(CompactPeerTest, truncatedFrames)
+{
+    // No signal name
+    EXPECT_TRUE(rejects(frame({rpcFrame})));
+    // Sync call without object and slot name
+    EXPECT_TRUE(rejects(frame({syncFrame, nameLiteral, 2, 'C'})));
+    // Name shorter than its length
+    EXPECT_TRUE(rejects(frame({rpcFrame, nameDefinition, 11, 'a', 'b', 'c'})));
+    // Varint cut off after a continuation byte
+    EXPECT_TRUE(rejects(frame({rpcFrame, 0x80})));
+    // Parameter count missing
+    EXPECT_TRUE(rejects(frame({rpcFrame, nameLiteral, 2, 'x'})));
+    // String parameter shorter than its length
+    EXPECT_TRUE(rejects(frame({rpcFrame, nameLiteral, 2, 'x', 1, stringParam, 0x20, 'a'})));
+}
+
+TEST_F(CompactPeerTest, oversizedFrames)
+{
+    // Frames larger than 64 MiB are refused before reading them
+    EXPECT_TRUE(rejects(frame({rpcFrame}), 0x7fffffff));
+    // Name claiming to be 4 GiB long
+    EXPECT_TRUE(rejects(frame({rpcFrame, nameLiteral, 0xff, 0xff, 0xff, 0xff, 0x0f})));
+    // More parameters than bytes left
+    EXPECT_TRUE(rejects(frame({rpcFrame, nameLiteral, 2, 'x', 0x7f, intParam, 0})));
+    // Varint longer than 64 bits
+    EXPECT_TRUE(rejects(frame({rpcFrame, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01})));
+}
+
+TEST_F(CompactPeerTest, maliciousFrames)
+{
+    // Reference to a name that was never defined
+    EXPECT_TRUE(rejects(frame({rpcFrame, 7, 0})));
+    // Unknown parameter type
+    EXPECT_TRUE(rejects(frame({rpcFrame, nameLiteral, 2, 'x', 1, 0x7e})));
+    // Trailing garbage
+    EXPECT_TRUE(rejects(frame({rpcFrame, nameLiteral, 2, 'x', 0, 0})));
+    // DataStream fallback that doesn't deserialize
+    EXPECT_TRUE(rejects(frame({rpcFrame, nameLiteral, 2, 'x', 1, variantParam, 4, 0xff, 0xff, 0xff})));
+
+    // Lists nested deeper than the reader allows
+    QByteArray nested = frame({rpcFrame, nameLiteral, 2, 'x', 1});
+    for (int i = 0; i < 40; ++i)
+        nested += frame({variantListParam, 1});
+    nested += frame({intParam, 0});
+    EXPECT_TRUE(rejects(nested));
+}
+
+#include "compactpeertest.moc"
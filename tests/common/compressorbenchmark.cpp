@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "compressor.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTest>
+#include <QtEndian>
+#include <QVariantMap>
+
+#include "testglobal.h"
+
+namespace {
+
+/// Size of a frame, in the ballpark of the InitData of a big channel
+constexpr int frameSize{8 * 1024 * 1024};
+
+/// Number of frames sent per measurement
+constexpr int frameCount{8};
+
+/// Builds a serialized list of user records, resembling the InitData frame of a big channel
+QByteArray initDataFrame()
+{
+    QByteArray frame;
+    QDataStream stream(&frame, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_2);
+    for (int i = 0; frame.size() < frameSize; ++i) {
+        QVariantMap user{{"nick", QString("user%1").arg(i)},
+                         {"user", QString("~ident%1").arg(i % 97)},
+                         {"host", QString("%1.dyn.example.com").arg(i * 7919 % 10007)},
+                         {"realName", QString("Some User %1").arg(i % 13)},
+                         {"away", i % 5 == 0},
+                         {"userModes", QString("iwx")}};
+        stream << QVariant(user);
+    }
+    return frame;
+}
+
+}  // namespace
+
+class CompressorBenchmark : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_TRUE(_server.listen(QHostAddress::LocalHost));
+        _clientSocket.connectToHost(QHostAddress::LocalHost, _server.serverPort());
+        ASSERT_TRUE(_clientSocket.waitForConnected(5000));
+        ASSERT_TRUE(_server.waitForNewConnection(5000));
+        _serverSocket = _server.nextPendingConnection();
+        ASSERT_NE(nullptr, _serverSocket);
+    }
+
+    /**
+     * Sends length-prefixed frames through a pair of compressors, framing them on the receiving side
+     * the same way RemotePeer does.
+     *
+     * @returns The throughput in MiB/s of uncompressed data
+     */
+    double measureThroughput(Compressor::CompressionLevel level, Compressor::Algorithm algorithm)
+    {
+        Compressor sender{&_clientSocket, level, algorithm};
+        Compressor receiver{_serverSocket, level, algorithm};
+
+        const QByteArray frame = initDataFrame();
+        int received = 0;
+        quint32 msgSize = 0;
+        QObject::connect(&receiver, &Compressor::error, &receiver, [](Compressor::Error error) {
+            ADD_FAILURE() << "Compressor error " << error;
+        });
+        QObject::connect(&receiver, &Compressor::readyRead, &receiver, [&]() {
+            while (true) {
+                if (msgSize == 0) {
+                    if (receiver.bytesAvailable() < 4)
+                        return;
+                    receiver.read(reinterpret_cast<char*>(&msgSize), 4);
+                    msgSize = qFromBigEndian<quint32>(msgSize);
+                }
+                if (receiver.bytesAvailable() < msgSize)
+                    return;
+                QByteArray msg = receiver.readView(msgSize);
+                EXPECT_TRUE(msg == frame);
+                msgSize = 0;
+                ++received;
+            }
+        });
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < frameCount; ++i) {
+            auto size = qToBigEndian<quint32>(frame.size());
+            sender.write(reinterpret_cast<const char*>(&size), 4, Compressor::NoFlush);
+            sender.write(frame.constData(), frame.size());
+        }
+        EXPECT_TRUE(QTest::qWaitFor([&]() { return received == frameCount; }, 120000));
+
+        return double(frameCount) * frame.size() / (1024 * 1024) / (timer.nsecsElapsed() / 1e9);
+    }
+
+protected:
+    QTcpServer _server;
+    QTcpSocket _clientSocket;
+    QTcpSocket* _serverSocket{nullptr};
+};
+
+TEST_F(CompressorBenchmark, uncompressedThroughput)
+{
+    qInfo() << "Uncompressed:" << measureThroughput(Compressor::NoCompression, Compressor::Zlib) << "MiB/s";
+}
+
+TEST_F(CompressorBenchmark, zlibThroughput)
+{
+    qInfo() << "zlib:" << measureThroughput(Compressor::BestCompression, Compressor::Zlib) << "MiB/s";
+}
+
+TEST_F(CompressorBenchmark, zstdThroughput)
+{
+    if (!Compressor::isAvailable(Compressor::Zstd))
+        GTEST_SKIP() << "Built without zstd support";
+
+    qInfo() << "zstd:" << measureThroughput(Compressor::BestCompression, Compressor::Zstd) << "MiB/s";
+}
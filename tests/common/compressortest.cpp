@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "compressor.h"
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTest>
+
+#include "testglobal.h"
+
+namespace {
+
+/// Builds a payload that compresses well, but in which every offset can be told apart
+QByteArray payload(int size, char tag)
+{
+    QByteArray data;
+    for (int i = 0; data.size() < size; ++i)
+        data += tag + QByteArray::number(i) + ' ';
+    return data.left(size);
+}
+
+}  // namespace
+
+class CompressorTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_TRUE(_server.listen(QHostAddress::LocalHost));
+        _clientSocket.connectToHost(QHostAddress::LocalHost, _server.serverPort());
+        ASSERT_TRUE(_clientSocket.waitForConnected(5000));
+        ASSERT_TRUE(_server.waitForNewConnection(5000));
+        _serverSocket = _server.nextPendingConnection();
+        ASSERT_NE(nullptr, _serverSocket);
+    }
+
+    /// Sends two payloads through a pair of compressors, and reads them back with a mix of read() and readView()
+    void roundTrip(Compressor::CompressionLevel level, Compressor::Algorithm algorithm)
+    {
+        Compressor sender{&_clientSocket, level, algorithm};
+        Compressor receiver{_serverSocket, level, algorithm};
+        QObject::connect(&receiver, &Compressor::error, &receiver, [](Compressor::Error error) {
+            ADD_FAILURE() << "Compressor error " << error;
+        });
+
+        const QByteArray first = payload(4000, 'a');
+        sender.write(first.constData(), first.size());
+        ASSERT_TRUE(QTest::qWaitFor([&]() { return receiver.bytesAvailable() == first.size(); }, 5000));
+
+        // Requests that can't be served must not consume anything
+        EXPECT_TRUE(receiver.readView(0).isEmpty());
+        EXPECT_TRUE(receiver.readView(first.size() + 1).isEmpty());
+        EXPECT_EQ(first.size(), receiver.bytesAvailable());
+
+        // Views and copies continue where the previous read left off
+        EXPECT_EQ(first.left(100), receiver.readView(100));
+        EXPECT_EQ(first.size() - 100, receiver.bytesAvailable());
+
+        QByteArray copied(50, '\0');
+        EXPECT_EQ(50, receiver.read(copied.data(), copied.size()));
+        EXPECT_EQ(first.mid(100, 50), copied);
+
+        EXPECT_EQ(first.mid(150, 1000), receiver.readView(1000));
+        EXPECT_EQ(first.size() - 1150, receiver.bytesAvailable());
+
+        // Leave some data unread, so the next payload is appended behind it
+        const QByteArray second = payload(3000, 'b');
+        sender.write(second.constData(), second.size());
+        const qint64 expected = first.size() - 1150 + second.size();
+        ASSERT_TRUE(QTest::qWaitFor([&]() { return receiver.bytesAvailable() == expected; }, 5000));
+
+        EXPECT_EQ(first.mid(1150), receiver.readView(first.size() - 1150));
+        EXPECT_EQ(second, receiver.readView(second.size()));
+        EXPECT_EQ(0, receiver.bytesAvailable());
+        EXPECT_TRUE(receiver.readView(1).isEmpty());
+    }
+
+protected:
+    QTcpServer _server;
+    QTcpSocket _clientSocket;
+    QTcpSocket* _serverSocket{nullptr};
+};
+
+TEST_F(CompressorTest, uncompressedRoundTrip)
+{
+    roundTrip(Compressor::NoCompression, Compressor::Zlib);
+}
+
+TEST_F(CompressorTest, zlibRoundTrip)
+{
+    roundTrip(Compressor::BestCompression, Compressor::Zlib);
+}
+
+TEST_F(CompressorTest, zstdRoundTrip)
+{
+    if (!Compressor::isAvailable(Compressor::Zstd))
+        GTEST_SKIP() << "Built without zstd support";
+
+    roundTrip(Compressor::BestCompression, Compressor::Zstd);
+}
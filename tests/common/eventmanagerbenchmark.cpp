@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "eventmanager.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QObject>
+
+#include "event.h"
+#include "ircevent.h"
+#include "testglobal.h"
+
+namespace {
+
+/// Number of events dispatched per measurement
+constexpr int eventCount{500000};
+
+class TestEventManager : public EventManager
+{
+    Q_OBJECT
+
+protected:
+    Network* networkById(NetworkId) const override { return nullptr; }
+};
+
+/// Registers handlers the way the core's event processors do, including group handlers, numerics and a filter
+class Handlers : public QObject
+{
+    Q_OBJECT
+
+public:
+    int handled{0};
+
+public slots:
+    void processIrcEventPrivmsg(IrcEvent*) { ++handled; }
+    void processIrcEventJoin(IrcEvent*) { ++handled; }
+    void processIrcEvent353(IrcEventNumeric*) { ++handled; }
+    void processIrcEventNumeric(IrcEventNumeric*) { ++handled; }
+};
+
+class GroupHandlers : public QObject
+{
+    Q_OBJECT
+
+public:
+    int handled{0};
+
+public slots:
+    void processIrcEvent(IrcEvent*) { ++handled; }
+    bool filterIrcEvent(IrcEvent*) { return true; }
+};
+
+}  // namespace
+
+TEST(EventManagerBenchmark, dispatch)
+{
+    TestEventManager manager;
+    Handlers handlers;
+    GroupHandlers groupHandlers;
+    manager.registerObject(&handlers, EventManager::HighPriority);
+    manager.registerObject(&groupHandlers, EventManager::LowPriority);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < eventCount; ++i) {
+        switch (i % 3) {
+        case 0:
+            manager.postEvent(new IrcEvent(EventManager::IrcEventPrivmsg, nullptr, {}, "nick!user@host", {"#chan", "hello"}));
+            break;
+        case 1:
+            manager.postEvent(new IrcEvent(EventManager::IrcEventJoin, nullptr, {}, "nick!user@host", {"#chan"}));
+            break;
+        default:
+            manager.postEvent(new IrcEventNumeric(353, nullptr, {}, "irc.example.net", "nick", {"=", "#chan", "nick"}));
+        }
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    // The specific numeric handler supersedes the generic one of the same object
+    EXPECT_EQ(handlers.handled, eventCount);
+    EXPECT_EQ(groupHandlers.handled, eventCount);
+    // Dispatched events are deleted, and their memory is kept for reuse
+    EXPECT_EQ(Event::liveCount(), 0u);
+    EXPECT_GT(Event::pooledCount(), 0u);
+    qInfo() << "dispatch:" << qRound64(eventCount / (elapsed / 1e9)) << "events/s";
+}
+
+#include "eventmanagerbenchmark.moc"
@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "ircdecoder.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QList>
+
+#include "irctag.h"
+#include "irctags.h"
+#include "testglobal.h"
+
+namespace {
+
+/// Number of times the corpus is parsed per measurement
+constexpr int rounds{20000};
+
+/// Hand-written lines modelled on typical server traffic during connect and regular chatter
+const char* const corpus[] = {
+    ":irc.example.net 001 quassel :Welcome to the Example Internet Relay Chat Network quassel",
+    ":irc.example.net 005 quassel CHANTYPES=# EXCEPTS INVEX CHANMODES=eIbq,k,flj,CFLMPQScgimnprstuz CHANLIMIT=#:250 PREFIX=(ov)@+ "
+    "MAXLIST=bqeI:100 MODES=4 NETWORK=Example STATUSMSG=@+ CALLERID=g CASEMAPPING=rfc1459 :are supported by this server",
+    ":irc.example.net 353 quassel = #quassel :quassel @ChanServ +alice bob carol dave_ eve[away] frank|work grace heidi ivan judy "
+    "mallory niaj olivia peggy rupert sybil trent victor walter",
+    ":irc.example.net 366 quassel #quassel :End of /NAMES list.",
+    ":irc.example.net 352 quassel #quassel ~alice 203.0.113.7 irc.example.net alice H :0 Alice Example",
+    "@time=2025-03-14T09:26:53.589Z;account=alice :alice!~alice@203.0.113.7 PRIVMSG #quassel :morning! did anyone try the new build?",
+    "@time=2025-03-14T09:26:55.102Z :bob!bob@user/bob PRIVMSG #quassel :yes, backlog fetching feels a lot snappier",
+    "@time=2025-03-14T09:27:01.311Z;account=carol;msgid=Yx1pQ7rA :carol!~c@2001:db8::42 PRIVMSG #quassel :\x01" "ACTION waves\x01",
+    ":dave_!~dave@198.51.100.23 JOIN #quassel",
+    "@time=2025-03-14T09:27:04.000Z;account=dave :dave_!~dave@198.51.100.23 JOIN #quassel dave :Dave Example",
+    ":eve!eve@gateway/web/eve PART #quassel :Leaving",
+    ":frank|work!~frank@192.0.2.99 QUIT :Ping timeout: 252 seconds",
+    ":ChanServ!ChanServ@services.example.net MODE #quassel +o alice",
+    ":grace!~grace@203.0.113.80 NICK :grace_",
+    ":NickServ!NickServ@services.example.net NOTICE quassel :You are now identified for quassel.",
+    "@batch=4Fz7;time=2025-03-14T09:20:00.000Z :heidi!~h@203.0.113.81 PRIVMSG #quassel :playback line from the bouncer",
+    ":heidi!~h@203.0.113.81 AWAY :Gone to lunch",
+    ":ivan!~ivan@198.51.100.4 TOPIC #quassel :Quassel IRC | Stable release out now | Be nice",
+    "@+draft/typing=active;time=2025-03-14T09:27:10.500Z :judy!~judy@192.0.2.1 TAGMSG #quassel",
+    "PING :irc.example.net",
+};
+
+QList<QByteArray> corpus()
+{
+    QList<QByteArray> lines;
+    for (const char* line : corpus) {
+        lines.append(QByteArray(line));
+    }
+    return lines;
+}
+
+QString decode(const QByteArray& data)
+{
+    return QString::fromUtf8(data);
+}
+
+/**
+ * Parses the corpus repeatedly
+ *
+ * @returns The number of lines parsed per second
+ */
+template<typename Parse>
+double measureLinesPerSecond(Parse&& parse)
+{
+    const QList<QByteArray> lines = corpus();
+    qsizetype checksum = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < rounds; ++i) {
+        for (const QByteArray& line : lines) {
+            checksum += parse(line);
+        }
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    // Make sure the work isn't optimized away
+    EXPECT_GT(checksum, 0);
+    return double(rounds) * lines.size() / (elapsed / 1e9);
+}
+
+}  // namespace
+
+TEST(IrcDecoderBenchmark, parseMessage)
+{
+    double rate = measureLinesPerSecond([](const QByteArray& line) {
+        QHash<IrcTagKey, QString> tags;
+        QString prefix;
+        QString cmd;
+        QList<QByteArray> params;
+        IrcDecoder::parseMessage(decode, line, tags, prefix, cmd, params);
+        return cmd.size() + params.size();
+    });
+    qInfo() << "parseMessage:" << qRound64(rate) << "lines/s";
+}
+
+TEST(IrcDecoderBenchmark, parseView)
+{
+    double rate = measureLinesPerSecond([](const QByteArray& line) {
+        IrcMessageView view = IrcDecoder::parseView(line);
+        return view.command().size() + view.paramCount();
+    });
+    qInfo() << "parseView:" << qRound64(rate) << "lines/s";
+}
+
+TEST(IrcDecoderBenchmark, parseViewAndReadFields)
+{
+    // Decodes what IrcParser reads for every line
+    double rate = measureLinesPerSecond([](const QByteArray& line) {
+        IrcMessageView view = IrcDecoder::parseView(line);
+        QString prefix = view.decodedPrefix(decode);
+        QString cmd = view.decodedCommand(decode);
+        QString time = view.tagValue(IrcTags::SERVER_TIME, decode);
+        return prefix.size() + cmd.size() + time.size() + view.paramCount();
+    });
+    qInfo() << "parseView with field access:" << qRound64(rate) << "lines/s";
+}
@@ -228,3 +228,32 @@ TEST(IrcDecoderTest, tag_values)
     EXPECT_EQ(parse("@tag1=value\\1 COMMAND"), IrcMessage({{IrcTagKey("tag1"), "value1"}}, "", "COMMAND"));
     EXPECT_EQ(parse("@tag1=value1\\ COMMAND"), IrcMessage({{IrcTagKey("tag1"), "value1"}}, "", "COMMAND"));
 }
+
+TEST(IrcDecoderTest, view_fragments)
+{
+    IrcMessageView view = IrcDecoder::parseView("@+example.com/a=b\\sc;k :nick!user@host PRIVMSG #chan :hello  world ");
+    EXPECT_EQ(view.prefix(), "nick!user@host");
+    EXPECT_EQ(view.command(), "PRIVMSG");
+    ASSERT_EQ(view.paramCount(), 2);
+    EXPECT_EQ(view.param(0), "#chan");
+    EXPECT_EQ(view.param(1), "hello  world ");
+    EXPECT_EQ(view.rawParam(1), "hello  world ");
+    // Raw parameters refer to the message instead of copying it
+    EXPECT_EQ(view.rawParam(0).constData(), view.raw().constData() + view.raw().indexOf("#chan"));
+    EXPECT_EQ(view.tagCount(), 2);
+}
+
+TEST(IrcDecoderTest, view_tag_lookup)
+{
+    auto decode = [](const QByteArray& data) { return QString::fromUtf8(data); };
+    IrcMessageView view = IrcDecoder::parseView("@+example.com/a=b\\sc;k;time=1;time=2 foo");
+    EXPECT_TRUE(view.hasTag(IrcTagKey("example.com", "a", true)));
+    EXPECT_FALSE(view.hasTag(IrcTagKey("example.com", "a")));
+    EXPECT_FALSE(view.hasTag(IrcTagKey("a")));
+    EXPECT_EQ(view.tagValue(IrcTagKey("example.com", "a", true), decode), "b c");
+    EXPECT_TRUE(view.hasTag(IrcTagKey("k")));
+    EXPECT_TRUE(view.tagValue(IrcTagKey("k"), decode).isEmpty());
+    EXPECT_TRUE(view.tagValue(IrcTagKey("missing"), decode).isNull());
+    // Later tags override earlier ones
+    EXPECT_EQ(view.tagValue(IrcTagKey("time"), decode), "2");
+}
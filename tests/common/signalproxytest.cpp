@@ -6,6 +6,7 @@
 #include <utility>
 
 #include <QByteArray>
+#include <QHash>
 #include <QTest>
 
 #include "invocationspy.h"
@@ -147,6 +148,8 @@ public:
 
     QString syncedString() const { return _syncedString; }
 
+    int keyedValue(int key) const { return _keyedValues.value(key); }
+
 public slots:
     QByteArray initFooData() const { return _fooData; }
 
@@ -183,6 +186,12 @@ public slots:
         emit syncMethodCalled(intArg, stringArg);
     }
 
+    void setKeyedValue(int key, int value)
+    {
+        _keyedValues[key] = value;
+        SYNC_COALESCED(ARG(key), ARG(value));
+    }
+
     int requestInt(const QString& stringArg, int intArg)
     {
         REQUEST(ARG(stringArg), ARG(intArg));
@@ -229,6 +238,7 @@ private:
     QByteArray _fooData{"FOO"};
     int _syncedInt{};
     QString _syncedString;
+    QHash<int, int> _keyedValues;
 };
 
 TEST_F(SignalProxyTest, syncableObject)
@@ -373,4 +383,52 @@ TEST_F(SignalProxyTest, syncableObject)
     EXPECT_EQ("Hi Universe", clientObject.stringProperty());
 }
 
+TEST_F(SignalProxyTest, coalescedSync)
+{
+    {
+        InSequence s;
+
+        EXPECT_CALL(*_clientPeer, Dispatches(InitRequest(Eq("SyncObj"), Eq("Foo"))));
+        EXPECT_CALL(*_serverPeer, Dispatches(InitData(Eq("SyncObj"), Eq("Foo"), _)));
+
+        // Superseded calls are dropped, calls for other keys are kept
+        EXPECT_CALL(*_serverPeer, Dispatches(SyncMessage(Eq("SyncObj"), Eq("Foo"), Eq("setKeyedValue"), ElementsAre(1, 12))));
+        EXPECT_CALL(*_serverPeer, Dispatches(SyncMessage(Eq("SyncObj"), Eq("Foo"), Eq("setKeyedValue"), ElementsAre(2, 21))));
+
+        // Regular calls on the same object send pending calls first
+        EXPECT_CALL(*_serverPeer, Dispatches(SyncMessage(Eq("SyncObj"), Eq("Foo"), Eq("setKeyedValue"), ElementsAre(1, 13))));
+        EXPECT_CALL(*_serverPeer, Dispatches(SyncMessage(Eq("SyncObj"), Eq("Foo"), Eq("setIntProperty"), ElementsAre(5))));
+    }
+
+    SignalSpy spy;
+
+    SyncObj clientObject;
+    SyncObj serverObject;
+    serverObject.setObjectName("Foo");
+    clientObject.setObjectName("Foo");
+
+    spy.connect(&serverObject, &SyncableObject::initDone);
+    _serverProxy.synchronize(&serverObject);
+    ASSERT_TRUE(spy.wait());
+    spy.connect(&clientObject, &SyncableObject::initDone);
+    _clientProxy.synchronize(&clientObject);
+    ASSERT_TRUE(spy.wait());
+
+    // -- Coalescing window
+
+    serverObject.setKeyedValue(1, 11);
+    serverObject.setKeyedValue(2, 21);
+    serverObject.setKeyedValue(1, 12);
+    EXPECT_TRUE(QTest::qWaitFor([&]() { return clientObject.keyedValue(1) == 12 && clientObject.keyedValue(2) == 21; }));
+
+    // -- Ordering
+
+    spy.connect(&clientObject, &SyncObj::intPropertyChanged);
+    serverObject.setKeyedValue(1, 13);
+    serverObject.setIntProperty(5);
+    ASSERT_TRUE(spy.wait());
+    EXPECT_EQ(13, clientObject.keyedValue(1));
+    EXPECT_EQ(5, clientObject.intProperty());
+}
+
 #include "signalproxytest.moc"
@@ -0,0 +1,48 @@
+// SPDX-FileCopyrightText: 2005-2025 Quassel Project <devel@quassel-irc.org>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "backlogpruner.h"
+#include "testglobal.h"
+
+namespace {
+
+void expectPolicy(const BacklogPruner::Policy& policy, int maxAge, int maxRows)
+{
+    EXPECT_EQ(maxAge, policy.maxAge);
+    EXPECT_EQ(maxRows, policy.maxRows);
+}
+
+}  // namespace
+
+TEST(BacklogPrunerTest, defaultPolicy)
+{
+    const BacklogPruner::Policy defaultPolicy{30, 1000};
+    expectPolicy(BacklogPruner::policy({}, BufferInfo::ChannelBuffer, defaultPolicy), 30, 1000);
+    expectPolicy(BacklogPruner::policy({}, BufferInfo::QueryBuffer, defaultPolicy), 30, 1000);
+}
+
+TEST(BacklogPrunerTest, userPolicy)
+{
+    const BacklogPruner::Policy defaultPolicy{30, 1000};
+    const QVariantMap settings{{"MaxAge", 90},
+                               {"ChannelBuffer", QVariantMap{{"MaxRows", 5000}}},
+                               {"QueryBuffer", QVariantMap{{"MaxAge", 0}, {"MaxRows", 0}}}};
+
+    // Keys missing from the user's policy fall back to the core-wide one
+    expectPolicy(BacklogPruner::policy(settings, BufferInfo::StatusBuffer, defaultPolicy), 90, 1000);
+    // Buffer types override the user's policy
+    expectPolicy(BacklogPruner::policy(settings, BufferInfo::ChannelBuffer, defaultPolicy), 90, 5000);
+    expectPolicy(BacklogPruner::policy(settings, BufferInfo::QueryBuffer, defaultPolicy), 0, 0);
+    EXPECT_FALSE(BacklogPruner::policy(settings, BufferInfo::QueryBuffer, defaultPolicy).isEnabled());
+}
+
+TEST(BacklogPrunerTest, sanitizeSettings)
+{
+    const QVariantMap settings{{"MaxAge", -5},
+                               {"Unknown", 1},
+                               {"StatusBuffer", QVariantMap{{"MaxRows", 100}, {"Unknown", 1}}},
+                               {"ChannelBuffer", QVariantMap{{"Unknown", 1}}},
+                               {"InvalidBuffer", QVariantMap{{"MaxRows", 100}}}};
+    const QVariantMap expected{{"MaxAge", 0}, {"StatusBuffer", QVariantMap{{"MaxRows", 100}}}};
+    EXPECT_EQ(expected, BacklogPruner::sanitizeSettings(settings));
+}